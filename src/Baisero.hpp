@@ -2,8 +2,11 @@
 #define _BAISERO_HPP_
 
 #include<cmath>
-#include<cstdlib>
 #include<vector>
+#include<stdint.h>
+#include"KTools.hpp"
+#include"Matrix.hpp"
+#include"QuantileSketch.hpp"
 
 /** @brief Namespace with ad-hoc and non-general-purpose tools, which may be useful only in specific settings.
  */
@@ -12,7 +15,13 @@ namespace baisero {
     /** @brief Selects Sigma parameter for a RbfKernel when used inside a PathKernel.
      *
      *  This method receives a list of sequences (which are going to be ideally fed into the PathKernel)
-     *  and outputs an educated estimate of which \f$ \sigma \f$ to use for the underlying RbfKernel.
+     *  and outputs an educated estimate of which \f$ \sigma \f$ to use for the underlying RbfKernel,
+     *  i.e. the median Euclidean distance between N random pairs of symbols.
+     *  Each symbol is drawn by picking a (non-empty) sequence uniformly at random, and then a symbol of that sequence uniformly at random.
+     *
+     *  Random numbers come from a counter-based generator (SplitMix64 on the seed and the sample index), hence the result depends on the seed only, and not on the number of threads.
+     *  Pairs are sampled concurrently, on up to ktools::numThreads() threads, and their distances are summarized in QuantileSketch instances:
+     *  memory does not depend on N (only on the number of symbols, through a table of pointers), and the median is exact up to the relative accuracy of the sketch (1%).
      *
      *  Purpose:
      *  -   Useful only when using the PathKernel on the RbfKernel.
@@ -21,50 +30,182 @@ namespace baisero {
      *  @param[in] slist
      *          A list of sequences.
      *  @param[in] N
-     *          The number of iterations for the educated guess.
+     *          The number of sampled pairs of symbols.
      *          Defaults to 0.
-     *          If non-positive, it is derived from the data itself.
+     *          If non-positive, it is derived from the data itself, as the square root of the total number of symbols.
+     *  @param[in] seed
+     *          Seed of the random generator.
      *  @returns
      *          The proposed \f$\sigma\f$.
      */
     template<typename SYM_TYPE>
-    double selectSigma(const std::vector<std::vector<std::vector<SYM_TYPE> > > &slist,int N=0);
+    double selectSigma(const std::vector<std::vector<std::vector<SYM_TYPE> > > &slist,int N=0,uint64_t seed=5489);
+
+    /** @brief Computes quantiles of the Euclidean distances between all pairs of symbols, as candidate Sigma parameters for a RbfKernel when used inside a PathKernel.
+     *
+     *  Exact counterpart of selectSigma: every pair of distinct symbols of the list (over all the sequences) is considered once, and several quantiles are read in one pass,
+     *  e.g. `{0.1,0.5,0.9}` for the 10th percentile, the median and the 90th percentile.
+     *
+     *  Distances are computed by blocks of symbols with the norm expansion \f$ |a-b|^2 = |a|^2 + |b|^2 - 2 a \cdot b \f$, where the dot products of each block are a small matrix product, evaluated by 4 x 8 tiles held in registers over panels of dimensions held in cache,
+     *  and negative rounding residues are clamped to 0. Blocks are processed concurrently, on up to ktools::numThreads() threads, and their distances are summarized in QuantileSketch instances,
+     *  hence quantiles are exact up to the relative accuracy of the sketch, and memory is linear in the number of symbols.
+     *  The cost is quadratic in the number of symbols.
+     *
+     *  @param[in] slist
+     *          A list of sequences.
+     *  @param[in] quantiles
+     *          Quantiles to compute, in \f$ [0,1] \f$.
+     *  @param[out] sigmas
+     *          The distance quantiles, in the order of `quantiles`.
+     *  @param[in] accuracy
+     *          Relative accuracy of the quantiles (defaults to 1%).
+     */
+    template<typename SYM_TYPE>
+    void sigmaQuantiles(const std::vector<std::vector<std::vector<SYM_TYPE> > > &slist,const std::vector<double> &quantiles,std::vector<double> &sigmas,double accuracy=0.01);
 }
 
 namespace baisero {
-    template<typename SYM_TYPE>
-    double selectSigma(const std::vector<std::vector<std::vector<SYM_TYPE> > > &slist,int N) {
-        std::vector<double> symDist(N);
-        int sA,sB,symA,symB;
-        size_t listSize=slist.size();
-        size_t symDim=slist[0][0].size();
 
-        if(N<=0) {
-            N=0;
-            for(size_t i=0;i<slist.size();i++) {
-                N+=slist[i].size();
+    namespace detail {
+
+        /** @brief Output of the SplitMix64 generator for state x, used as a counter-based generator. */
+        inline uint64_t splitmix64(uint64_t x) {
+            x+=0x9E3779B97F4A7C15ULL;
+            x=(x^(x>>30))*0xBF58476D1CE4E5B9ULL;
+            x=(x^(x>>27))*0x94D049BB133111EBULL;
+            return x^(x>>31);
+        }
+
+        /** @brief Maps random number r to \f$ [0,n) \f$ by multiplication of its high 32 bits, which avoids a division (for \f$ n < 2^{32} \f$). */
+        inline size_t randomIndex(uint64_t r,size_t n) {
+            return size_t(((r>>32)*uint64_t(n))>>32);
+        }
+
+        /** @brief Accumulates into the NR x NC tile `c` (leading dimension ldc) the dot products of the columns \f$ [i,i+NR) \f$ and \f$ [j,j+NC) \f$ of `xt`, over its rows \f$ [d_0,d_1) \f$.
+         *
+         *  Full 4 x 8 tiles are accumulated in registers, one outer product per row of `xt`; edge tiles fall back to a plain loop, in the same order.
+         */
+        inline void dotTile(const Matrix<double> &xt,size_t i,size_t j,size_t NR,size_t NC,size_t d0,size_t d1,double *c,size_t ldc) {
+            if(NR==4&&NC==8) {
+                double acc[4][8];
+                for(size_t r=0;r<4;r++)
+                    for(size_t s=0;s<8;s++)
+                        acc[r][s]=c[r*ldc+s];
+                for(size_t d=d0;d<d1;d++) {
+                    const double *a=xt[d]+i,*b=xt[d]+j;
+                    for(size_t r=0;r<4;r++)
+                        for(size_t s=0;s<8;s++)
+                            acc[r][s]+=a[r]*b[s];
+                }
+                for(size_t r=0;r<4;r++)
+                    for(size_t s=0;s<8;s++)
+                        c[r*ldc+s]=acc[r][s];
+                return;
+            }
+            for(size_t d=d0;d<d1;d++) {
+                const double *a=xt[d]+i,*b=xt[d]+j;
+                for(size_t r=0;r<NR;r++)
+                    for(size_t s=0;s<NC;s++)
+                        c[r*ldc+s]+=a[r]*b[s];
             }
-            N=std::floor(std::sqrt(N));
         }
+    }
 
-        for(int i=0;i<N;i++) {
-            sA=rand()%listSize;
-            symA=rand()%slist[sA].size();
+    template<typename SYM_TYPE>
+    double selectSigma(const std::vector<std::vector<std::vector<SYM_TYPE> > > &slist,int N,uint64_t seed) {
+        // Number of samples per parallel task, and per group within a task.
+        const size_t B=1<<14,G=64;
+        // flat table of symbol pointers, with the offset of each non-empty sequence
+        std::vector<const SYM_TYPE*> syms;
+        std::vector<size_t> offsets;
+        size_t symDim=0;
+        for(size_t i=0;i<slist.size();i++) {
+            if(slist[i].empty())
+                continue;
+            if(syms.empty())
+                symDim=slist[i][0].size();
+            offsets.push_back(syms.size());
+            for(size_t j=0;j<slist[i].size();j++)
+                syms.push_back(slist[i][j].data());
+        }
+        if(syms.empty())
+            throw "Input set doesn't contain any symbol.";
+        offsets.push_back(syms.size());
+        size_t nseqs=offsets.size()-1;
+        size_t samples=N>0?size_t(N):size_t(std::floor(std::sqrt(double(syms.size()))));
 
-            sB=rand()%listSize;
-            symB=rand()%slist[sA].size();
-            
-            SYM_TYPE sum=SYM_TYPE(0);
-            for(size_t d=0;d<symDim;d++) {
-                sum+=(slist[sA][symA][d]-slist[sB][symB][d])*(slist[sA][symA][d]-slist[sB][symB][d]);
+        uint64_t key=detail::splitmix64(seed);
+        std::vector<QuantileSketch> sketches(ktools::numThreads());
+        ktools::detail::parallelFor((samples+B-1)/B,[&](size_t t,size_t tid) {
+            const SYM_TYPE *a[G],*b[G];
+            double d[G];
+            for(size_t i0=t*B;i0<std::min(t*B+B,samples);i0+=G) {
+                size_t n=std::min(G,std::min(t*B+B,samples)-i0);
+                // pointers first, then distances, so that the memory accesses of a group overlap
+                for(size_t g=0;g<n;g++) {
+                    uint64_t c=key+4*uint64_t(i0+g);
+                    size_t sA=detail::randomIndex(detail::splitmix64(c),nseqs);
+                    size_t sB=detail::randomIndex(detail::splitmix64(c+2),nseqs);
+                    a[g]=syms[offsets[sA]+detail::randomIndex(detail::splitmix64(c+1),offsets[sA+1]-offsets[sA])];
+                    b[g]=syms[offsets[sB]+detail::randomIndex(detail::splitmix64(c+3),offsets[sB+1]-offsets[sB])];
+                }
+                for(size_t g=0;g<n;g++)
+                    d[g]=std::sqrt(ktools::detail::sqDistance(a[g],b[g],symDim));
+                for(size_t g=0;g<n;g++)
+                    sketches[tid].add(d[g]);
             }
-            symDist[i]=std::sqrt(sum);
+        });
+        for(size_t tid=1;tid<sketches.size();tid++)
+            sketches[0].merge(sketches[tid]);
+        return sketches[0].quantile(0.5);
+    }
+
+    template<typename SYM_TYPE>
+    void sigmaQuantiles(const std::vector<std::vector<std::vector<SYM_TYPE> > > &slist,const std::vector<double> &quantiles,std::vector<double> &sigmas,double accuracy) {
+        // Number of symbols per block, and of dimensions per panel of the block product.
+        const size_t B=128,K=256;
+        size_t M=0,symDim=0;
+        for(size_t i=0;i<slist.size();i++) {
+            if(M==0&&!slist[i].empty())
+                symDim=slist[i][0].size();
+            M+=slist[i].size();
         }
-        std::vector<double>::iterator first=symDist.begin();
-        std::vector<double>::iterator last=symDist.end();
-        std::vector<double>::iterator median=first+(last-first)/2;
-        nth_element(first,median,last);
-        return *median;
+        if(M<2)
+            throw "Input set doesn't contain at least two symbols.";
+        // symbols by column, one row per dimension, and their squared norms
+        Matrix<double> xt(symDim,M);
+        std::vector<double> n(M,0);
+        for(size_t i=0,m=0;i<slist.size();i++)
+            for(size_t j=0;j<slist[i].size();j++,m++)
+                for(size_t d=0;d<symDim;d++) {
+                    xt[d][m]=double(slist[i][j][d]);
+                    n[m]+=xt[d][m]*xt[d][m];
+                }
+
+        std::vector<QuantileSketch> sketches(ktools::numThreads(),QuantileSketch(accuracy));
+        std::vector<Matrix<double> > dots(sketches.size(),Matrix<double>(B,B));
+        ktools::detail::lowerBlocks(M,B,[&](size_t i0,size_t i1,size_t j0,size_t j1,size_t tid) {
+            Matrix<double> &g=dots[tid];
+            g.fill(0.0);
+            // panels of dimensions, such that the block columns of xt stay in cache across the 4 x 8 tiles
+            for(size_t d0=0;d0<symDim;d0+=K)
+                for(size_t i=i0;i<i1;i+=4)
+                    // only the tiles with some column before their last row
+                    for(size_t j=j0;j<std::min(j1,i+3);j+=8)
+                        detail::dotTile(xt,i,j,std::min<size_t>(4,i1-i),std::min<size_t>(8,j1-j),d0,std::min(d0+K,symDim),&g[i-i0][j-j0],g.ld());
+            for(size_t i=std::max(i0,j0+1);i<i1;i++) {
+                size_t nj=std::min(i,j1)-j0;
+                double *r=g[i-i0];
+                ktools::detail::distRow(r,&n[j0],n[i],nj);
+                for(size_t j=0;j<nj;j++)
+                    sketches[tid].add(r[j]);
+            }
+        });
+        for(size_t tid=1;tid<sketches.size();tid++)
+            sketches[0].merge(sketches[tid]);
+        sigmas.resize(quantiles.size());
+        for(size_t k=0;k<quantiles.size();k++)
+            sigmas[k]=sketches[0].quantile(quantiles[k]);
     }
 
 }
@@ -0,0 +1,156 @@
+#ifndef _BINARY_WRITER_HPP_
+#define _BINARY_WRITER_HPP_
+
+#include<fstream>
+#include<string>
+#include<vector>
+#include<stdint.h>
+#include"Matrix.hpp"
+
+/** @brief Binary Writer class.
+ *
+ *  Writes a kernel matrix in a compact binary format, one block of rows at a time.
+ *  Rows are appended through write(), typically from ktools::stream, so that no full kernel matrix is ever held in memory.
+ *
+ *  File format
+ *  -----------
+ *
+ *  A header of four 64-bit unsigned integers (magic number, element size, number of rows, number of columns), followed by the elements row by row, without padding, as values of type T in the native byte order.
+ *  The number of rows is only known, and thus written, when the file is closed.
+ *  Storing a matrix of doubles with T = float halves the file.
+ *
+ *  Files are read back by read().
+ */
+template<typename T>
+class BinaryWriter {
+    protected:
+        /** @brief Output file. */
+        std::ofstream _ofs;
+
+        /** @brief Conversion buffer of the current block of rows. */
+        std::vector<T> _buf;
+
+        /** @brief Number of rows written so far. */
+        uint64_t _NR;
+
+        /** @brief Number of columns, set by the first block of rows. */
+        uint64_t _NC;
+
+    public:
+        /** @brief Magic number at the start of the file ("TKLGRAM"). */
+        static const uint64_t MAGIC=0x004D4152474C4B54ULL;
+
+        /** @brief Creates (or overwrites) the output file.
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         */
+        BinaryWriter(const std::string &fname);
+
+        /** @brief Closes the file, see close(). */
+        ~BinaryWriter();
+
+        /** @brief Appends a block of rows.
+         *
+         *  @param[in] rows
+         *          Block of rows of the kernel matrix. All blocks must have the same number of columns.
+         */
+        template<typename RET_TYPE>
+        void write(const MatrixView<RET_TYPE> &rows);
+
+        /** @brief Completes the header and closes the file. Does nothing if already closed. */
+        void close();
+
+        /** @brief Number of rows written so far. */
+        size_t rows() const;
+
+        /** @brief Reads a file written by a BinaryWriter with the same element type.
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         *  @param[out] m
+         *          Matrix in which the elements are read. Resized accordingly.
+         */
+        template<typename RET_TYPE>
+        static void read(const std::string &fname,Matrix<RET_TYPE> &m);
+};
+
+template<typename T>
+const uint64_t BinaryWriter<T>::MAGIC;
+
+template<typename T>
+BinaryWriter<T>::BinaryWriter(const std::string &fname): _ofs(fname.c_str(),std::ios::out|std::ios::trunc|std::ios::binary),_NR(0),_NC(0) {
+    if(!_ofs.is_open())
+        throw "Output file cannot be created.";
+    uint64_t h[4]={MAGIC,sizeof(T),0,0};
+    _ofs.write((char*)h,sizeof(h));
+}
+
+template<typename T>
+BinaryWriter<T>::~BinaryWriter() {
+    try {
+        close();
+    }
+    catch(...) {
+    }
+}
+
+template<typename T>
+template<typename RET_TYPE>
+void BinaryWriter<T>::write(const MatrixView<RET_TYPE> &rows) {
+    if(!_ofs.is_open())
+        throw "Output file is closed.";
+    if(_NR>0&&rows.cols()!=_NC)
+        throw "Row block size does not match the previous rows.";
+    _NC=rows.cols();
+    _buf.resize(rows.rows()*_NC);
+    for(size_t i=0;i<rows.rows();i++)
+        for(size_t j=0;j<_NC;j++)
+            _buf[i*_NC+j]=T(rows[i][j]);
+    if(!_buf.empty())
+        _ofs.write((char*)&_buf[0],_buf.size()*sizeof(T));
+    _NR+=rows.rows();
+    if(!_ofs)
+        throw "Output file cannot be written.";
+}
+
+template<typename T>
+void BinaryWriter<T>::close() {
+    if(!_ofs.is_open())
+        return;
+    _ofs.seekp(2*sizeof(uint64_t));
+    _ofs.write((char*)&_NR,sizeof(_NR));
+    _ofs.write((char*)&_NC,sizeof(_NC));
+    _ofs.close();
+    if(!_ofs)
+        throw "Output file cannot be written.";
+}
+
+template<typename T>
+size_t BinaryWriter<T>::rows() const {
+    return _NR;
+}
+
+template<typename T>
+template<typename RET_TYPE>
+void BinaryWriter<T>::read(const std::string &fname,Matrix<RET_TYPE> &m) {
+    std::ifstream ifs(fname.c_str(),std::ios::in|std::ios::binary);
+    if(!ifs.is_open())
+        throw "Input file cannot be opened.";
+    uint64_t h[4];
+    ifs.read((char*)h,sizeof(h));
+    if(!ifs||h[0]!=MAGIC||h[1]!=sizeof(T))
+        throw "Input file is not valid.";
+    m.resize(h[2],h[3]);
+    std::vector<T> row(h[3]);
+    for(size_t i=0;i<h[2];i++) {
+        if(!row.empty())
+            ifs.read((char*)&row[0],row.size()*sizeof(T));
+        if(!ifs)
+            throw "Input file is not valid.";
+        for(size_t j=0;j<row.size();j++)
+            m[i][j]=RET_TYPE(row[j]);
+    }
+}
+
+#endif // _BINARY_WRITER_HPP_
@@ -9,13 +9,58 @@
 #ifndef _KTOOLS_HPP_
 #define _KTOOLS_HPP_
 
+#include<algorithm>
+#include<atomic>
+#include<chrono>
 #include<cmath>
+#include<cstring>
+#include<exception>
+#include<limits>
+#include<random>
+#include<thread>
+#include<type_traits>
+#include<stdint.h>
 #include<vector>
 
+// Leaf kernels on double and float arrays (ktools::detail::sqDistance, weightedSum, scaleRow and distRow) are:
+// - inline in header-only builds, with SSE2 or AVX intrinsics when enabled at compile time (TKL_SSE2, TKL_AVX);
+// - defined once by the libtkl build (TKL_LIBRARY_BUILD), as plain loops compiled for several instruction sets
+//   (x86-64-v4 with AVX-512, x86-64-v3 with AVX2 and FMA, and the baseline), selected at load time where GCC supports it;
+// - only declared in programs linked against libtkl (TKL_LIBRARY).
+#if defined(TKL_LIBRARY_BUILD)
+#if defined(__GNUC__)&&!defined(__clang__)&&defined(__x86_64__)&&defined(__ELF__)
+#define TKL_LEAF __attribute__((target_clones("arch=x86-64-v4","arch=x86-64-v3","default")))
+#else
+#define TKL_LEAF
+#endif
+#elif defined(TKL_LIBRARY)
+#define TKL_LEAF
+#else
+#define TKL_LEAF inline
+#if defined(__AVX__)
+#define TKL_AVX
+#include<immintrin.h>
+#elif defined(__SSE2__)
+#define TKL_SSE2
+#include<emmintrin.h>
+#endif
+#endif
+#include"KernelTraits.hpp"
+#include"Matrix.hpp"
+#include"PackedMatrix.hpp"
+#include"TiledMatrix.hpp"
+
 /** @brief Namespace with useful tools for the elaboration of kernels and kernel matrices.
  *
  *  Contains methods for the elaboration of normalized kernels, normalized kernel matrices, distance matrices, and other simple matrix analysis and manipulation tools.
  *
+ *  Matrix methods operate on Matrix (or MatrixView) instances. The overloads on nested std::vector matrices work on them in place, through pointers to their rows.
+ *
+ *  Methods which receive a kernel instance consult its KernelTraits to skip redundant work:
+ *  no self-kernel is evaluated for kernels with unit diagonal, a single one is evaluated for stationary kernels,
+ *  and negative rounding residues are clamped to 0 before taking the square root of distances of positive semi-definite kernels.
+ *
+ *  The most expensive matrix checks are multi-threaded, using up to numThreads() threads.
  */
 namespace ktools {
 
@@ -24,13 +69,47 @@ namespace ktools {
     /////////////////////////
 
     /** @brief Transforms a square kernel matrix into a normalized kernel matrix.
-     *  
+     *
+     *  The reciprocal square roots of the diagonal are computed once, and each off-diagonal value of the lower triangle is scaled by two of them, then mirrored into the upper triangle.
+     *  Rows are scaled with SIMD instructions (SSE2 or AVX, when enabled at compile time), and the lower triangle is processed in square blocks, concurrently on up to numThreads() threads.
+     *  Zero values are left untouched.
+     *
+     *  @param[in] nkm
+     *          Kernel matrix to normalize.
+     */
+    template<typename RET_TYPE>
+    void kern2norm(const MatrixView<RET_TYPE> &nkm);
+
+    /** @brief Transforms a square kernel matrix into a normalized kernel matrix.
+     *
+     *  Adapter over the Matrix version.
+     *
      *  @param[in] nkm
      *          Kernel matrix to normalize.
      */
     template<typename RET_TYPE>
     void kern2norm(std::vector<std::vector<RET_TYPE> > &nkm);
 
+    /** @brief Transforms a packed kernel matrix into a normalized kernel matrix, in place.
+     *
+     *  Each off-diagonal value is visited once, instead of twice as in the Matrix version. Rows are processed concurrently, as in the Matrix version.
+     *
+     *  @param[in] nkm
+     *          Kernel matrix to normalize.
+     */
+    template<typename RET_TYPE>
+    void kern2norm(PackedMatrix<RET_TYPE> &nkm);
+
+    /** @brief Transforms a square tiled kernel matrix into a normalized kernel matrix, in place.
+     *
+     *  The diagonal is read first, then the tiles are streamed in tile row order (see forEachTile).
+     *
+     *  @param[in] nkm
+     *          Kernel matrix to normalize.
+     */
+    template<typename RET_TYPE>
+    void kern2norm(TiledMatrix<RET_TYPE> &nkm);
+
     /** @brief Evaluates the normalized kernel function \f$ \tilde k_{SK}(x,y) \f$ relative to non-normalized kernel `sk` and stores the result in reference parameter nk.
      *
      *  Alternative method to elaborate normalized kernels, which does not require to instantiate NormKernel. Defined as
@@ -68,6 +147,9 @@ namespace ktools {
      *
      *  After evaluation, `nkm[i][j]` is set to the normalized kernel value computed on `xlist[i]` and `ylist[j]`.
      *
+     *  The self-kernels are computed once up front (only once if `xlist` and `ylist` are the same object).
+     *  The kernel matrix is then evaluated in blocks, concurrently on up to numThreads() threads, through the list overload of `sk` on each block, and each block is normalized while it is in cache.
+     *
      *  @param[in] sk
      *          Kernel instance to normalize.
      *  @param[in] xlist
@@ -75,27 +157,70 @@ namespace ktools {
      *  @param[in] ylist
      *          Second list (std::vector) of inputs suitable for `sk`.
      *  @param[out] nkm
-     *          Reference to a matrix (std::vector<std::vector>) variable in which the normalized kernel values are stored.
+     *          Reference to a matrix (Matrix) variable in which the normalized kernel values are stored.
      */
     template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &nkm);
+
+    /** @brief Adapter of `ktools::norm(sk,xlist,ylist,nkm)` on nested std::vector matrices. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
     void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &nkm);
 
+    /** @brief Evaluates the normalized kernel function \f$ \tilde k_{SK}(x_i,y_j) \f$ with \f$ x_i\in \f$ `xlist` and \f$ y_j\in \f$ `ylist`, relative to non-normalized kernel instance `sk` and to precomputed self-kernels, and stores the result in reference matrix parameter nkm.
+     *
+     *  Same as `ktools::norm(sk,xlist,ylist,nkm)`, except that the self-kernels \f$ k_{SK}(x_i,x_i) \f$ and \f$ k_{SK}(y_j,y_j) \f$ are not computed but provided.
+     *
+     *  @param[in] sk
+     *          Kernel instance to normalize.
+     *  @param[in] xlist
+     *          First list (std::vector) of inputs suitable for `sk`.
+     *  @param[in] ylist
+     *          Second list (std::vector) of inputs suitable for `sk`.
+     *  @param[in] xkv
+     *          Self-kernels of the inputs in `xlist`, as computed by `sk(xlist,xkv)`.
+     *  @param[in] ykv
+     *          Self-kernels of the inputs in `ylist`, as computed by `sk(ylist,ykv)`.
+     *  @param[out] nkm
+     *          Reference to a matrix (Matrix) variable in which the normalized kernel values are stored.
+     */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,Matrix<RET_TYPE> &nkm);
+
+    /** @brief Adapter of `ktools::norm(sk,xlist,ylist,xkv,ykv,nkm)` on nested std::vector matrices. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,std::vector<std::vector<RET_TYPE> > &nkm);
+
     /** @brief Evaluates the normalized kernel function \f$ \tilde k_{SK}(x_i,x_j) \f$ with \f$ x_i,x_j\in \f$ `xlist`, relative to non-normalized kernel instance `sk`, and stores the result in reference matrix parameter nkm.
      *
      *  After evaluation, `nkm[i][j]` is set to the normalized kernel value computed on `xlist[i]` and `xlist[j]`.
      *
      *  Equivalent, albeit optimised, to calling the more explicit version `ktools::norm(sk,xlist,xlist,km)`.
      *
+     *  The self-kernels are computed once up front. The lower triangle of the kernel matrix is then evaluated in blocks, concurrently on up to numThreads() threads,
+     *  through the list overloads of `sk` on each block (the symmetric one on diagonal blocks), and each block is normalized while it is in cache.
+     *
      *  @param[in] sk
      *          Kernel instance to normalize.
      *  @param[in] xlist
      *          List (std::vector) of inputs suitable for `sk`.
      *  @param[out] nkm
-     *          Reference to a matrix (std::vector<std::vector>) variable in which the normalized kernel values are stored.
+     *          Reference to a matrix (Matrix) variable in which the normalized kernel values are stored.
      */
     template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &nkm);
+
+    /** @brief Adapter of `ktools::norm(sk,xlist,nkm)` on nested std::vector matrices. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
     void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &nkm);
 
+    /** @brief Same as the Matrix version, with the result stored in a packed symmetric matrix (PackedMatrix). */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &nkm);
+
+    /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads of `sk`. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,TiledMatrix<RET_TYPE> &nkm);
+
     /** @brief Evaluates the normalized kernel \f$ \tilde k_{SK}(x_i,x_i) \f$ with \f$ x_i\in \f$ `xlist`, relative to non-normalized kernel instance `sk`, and stores the result in reference vector parameter nkv.
      *
      *  Equivalent to:
@@ -119,13 +244,47 @@ namespace ktools {
     ////////////////////
 
     /** @brief Transforms a square kernel matrix into a distance matrix.
-     *  
+     *
+     *  The lower triangle is processed in square blocks, concurrently on up to numThreads() threads, and each block is mirrored into the upper triangle.
+     *  Square roots are taken with SIMD instructions (SSE2 or AVX, when enabled at compile time), after clamping negative rounding residues to 0.
+     *
+     *  @param[in] dm
+     *          Kernel matrix to transform.
+     */
+    template<typename RET_TYPE>
+    void kern2dist(const MatrixView<RET_TYPE> &dm);
+
+    /** @brief Transforms a square kernel matrix into a distance matrix.
+     *
+     *  Adapter over the Matrix version.
+     *
      *  @param[in] dm
      *          Kernel matrix to transform.
      */
     template<typename RET_TYPE>
     void kern2dist(std::vector<std::vector<RET_TYPE> > &dm);
 
+    /** @brief Transforms a packed kernel matrix into a distance matrix, in place.
+     *
+     *  Each off-diagonal value is visited once, instead of twice as in the Matrix version. Rows are processed concurrently, as in the Matrix version.
+     *
+     *  @param[in] dm
+     *          Kernel matrix to transform.
+     */
+    template<typename RET_TYPE>
+    void kern2dist(PackedMatrix<RET_TYPE> &dm);
+
+    /** @brief Transforms a square tiled kernel matrix into a distance matrix, in place.
+     *
+     *  The diagonal is read first, then the tiles are streamed in tile row order (see forEachTile).
+     *  As in the Matrix version, the kernel values are symmetrized: each tile is processed along with its mirror tile, if stored.
+     *
+     *  @param[in] dm
+     *          Kernel matrix to transform.
+     */
+    template<typename RET_TYPE>
+    void kern2dist(TiledMatrix<RET_TYPE> &dm);
+
     /** @brief Evaluates the distance function \f$ d_{SK}(x,y) \f$ relative to kernel `sk` and stores the result in reference parameter d.
      *
      *  Distance defined as \f$ d_{SK}(x,y) = \sqrt{k_{SK}(x,x) + k_{SK}(y,y) -2k_{SK}(x,y)} \f$.
@@ -161,6 +320,9 @@ namespace ktools {
      *
      *  After evaluation, `dm[i][j]` is set to the distance value computed between `xlist[i]` and `ylist[j]`.
      *
+     *  The self-kernels are computed once up front (only once if `xlist` and `ylist` are the same object).
+     *  The kernel matrix is then evaluated in blocks, concurrently on up to numThreads() threads, through the list overload of `sk` on each block, and each block is turned into distances while it is in cache.
+     *
      *  @param[in] sk
      *          Kernel instance with which to elaborate the distance.
      *  @param[in] xlist
@@ -168,27 +330,70 @@ namespace ktools {
      *  @param[in] ylist
      *          Second list (std::vector) of inputs suitable for `sk`.
      *  @param[out] dm
-     *          Reference to a matrix (std::vector<std::vector>) variable in which the distance values are stored.
+     *          Reference to a matrix (Matrix) variable in which the distance values are stored.
      */
     template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &dm);
+
+    /** @brief Adapter of `ktools::dist(sk,xlist,ylist,dm)` on nested std::vector matrices. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
     void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &dm);
 
+    /** @brief Evaluates the distance function \f$ d_{SK}(x_i,y_j) \f$ with \f$ x_i\in \f$ `xlist` and \f$ y_j\in \f$ `ylist`, relative to kernel instance `sk` and to precomputed self-kernels, and stores the result in reference matrix parameter dm.
+     *
+     *  Same as `ktools::dist(sk,xlist,ylist,dm)`, except that the self-kernels \f$ k_{SK}(x_i,x_i) \f$ and \f$ k_{SK}(y_j,y_j) \f$ are not computed but provided.
+     *
+     *  @param[in] sk
+     *          Kernel instance with which to elaborate the distance.
+     *  @param[in] xlist
+     *          First list (std::vector) of inputs suitable for `sk`.
+     *  @param[in] ylist
+     *          Second list (std::vector) of inputs suitable for `sk`.
+     *  @param[in] xkv
+     *          Self-kernels of the inputs in `xlist`, as computed by `sk(xlist,xkv)`.
+     *  @param[in] ykv
+     *          Self-kernels of the inputs in `ylist`, as computed by `sk(ylist,ykv)`.
+     *  @param[out] dm
+     *          Reference to a matrix (Matrix) variable in which the distance values are stored.
+     */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,Matrix<RET_TYPE> &dm);
+
+    /** @brief Adapter of `ktools::dist(sk,xlist,ylist,xkv,ykv,dm)` on nested std::vector matrices. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,std::vector<std::vector<RET_TYPE> > &dm);
+
     /** @brief Evaluates the distance function \f$ d_{SK}(x_i,x_j) \f$ with \f$ x_i,x_j\in \f$ `xlist`, relative to on-normalized kernel instance `sk`, and stores the result in reference matrix parameter km.
      *
      *  After evaluation, `nkm[i][j]` is set to the normalized kernel value computed on `xlist[i]` and `xlist[j]`.
      *
      *  Equivalent, albeit optimised, to calling the more explicit version `ktools::norm(sk,xlist,xlist,km)`.
      *
+     *  The self-kernels are computed once up front. The lower triangle of the kernel matrix is then evaluated in blocks, concurrently on up to numThreads() threads,
+     *  through the list overloads of `sk` on each block (the symmetric one on diagonal blocks), and each block is turned into distances while it is in cache.
+     *
      *  @param[in] sk
      *          Kernel instance with which to elaborate the distance.
      *  @param[in] xlist
      *          List (std::vector) of inputs suitable for `sk`.
      *  @param[out] dm
-     *          Reference to a matrix (std::vector<std::vector>) variable in which the distance values are stored.
+     *          Reference to a matrix (Matrix) variable in which the distance values are stored.
      */
     template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &dm);
+
+    /** @brief Adapter of `ktools::dist(sk,xlist,dm)` on nested std::vector matrices. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
     void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &dm);
 
+    /** @brief Same as the Matrix version, with the result stored in a packed symmetric matrix (PackedMatrix). */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &dm);
+
+    /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads of `sk`. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,TiledMatrix<RET_TYPE> &dm);
+
     /** @brief Evaluates the distance function \f$ d_{SK}(x_i,x_i) \f$ with \f$ x_i\in \f$ `xlist`, relative to kernel instance `sk`, and stores the result in reference vector parameter dv.
      *
      *  Equivalent to:
@@ -207,204 +412,1997 @@ namespace ktools {
     template<typename SK,typename DATA_TYPE,typename RET_TYPE>
     void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &dv);
 
-    /////////////////////////
-    // OTHER GENERIC TOOLS //
-    /////////////////////////
+    /////////////////////
+    // CENTERING TOOLS //
+    /////////////////////
 
-    /** @brief Resizes a matrix into \f$ NR \times NC \f$.
+    /** @brief Statistics of a training kernel matrix, required to center kernel values of test inputs consistently.
      *
-     *  @param[in] m
-     *          Matrix to resize.
-     *  @param[in] NR
-     *          Number of rows.
-     *  @param[in] NC
-     *          Number of columns.
+     *  Filled by ktools::center(km,stats), consumed by ktools::centerTest(kt,stats).
      */
-    template<typename RET_TYPE>
-    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t NR,size_t NC);
+    struct CenterStats {
+        /** @brief Mean of each row (equivalently, column) of the training kernel matrix. */
+        std::vector<double> means;
 
-    /** @brief Resizes a matrix to be square and into \f$ N \times N \f$.
+        /** @brief Mean of all the elements of the training kernel matrix. */
+        double grandMean;
+    };
+
+    /** @brief Centers a square kernel matrix in place, i.e. centers the inputs in the feature space.
      *
-     *  Equivalent to `ktools::resizeMat(m,N,N)`.
-     *  @param[in] m
-     *          Matrix to resize.
-     *  @param[in] N
-     *          Number of rows and columns.
+     *  Computes \f$ K \leftarrow (I - \frac{1}{N}\mathbf{1}\mathbf{1}^T) K (I - \frac{1}{N}\mathbf{1}\mathbf{1}^T) \f$, i.e.
+     *  \f[
+     *      K_{ij} \leftarrow K_{ij} - m_i - m_j + g,
+     *  \f]
+     *  where \f$ m_i \f$ is the mean of row \f$ i \f$ and \f$ g \f$ the mean of all elements.
+     *  The row means are computed in a single pass, and both passes run in parallel over blocks of rows, without any additional \f$ N \times N \f$ storage.
+     *
+     *  @param[in,out] km
+     *          Square symmetric kernel matrix to center.
      */
     template<typename RET_TYPE>
-    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t N);
+    void center(const MatrixView<RET_TYPE> &km);
 
-    /** @brief Verifies if matrix is square.
+    /** @brief Centers a square kernel matrix in place, and stores the statistics required to center test inputs.
      *
-     *  @param[in] m
-     *          Matrix to verify.
-     *  @returns
-     *          `true` if the matrix is square. `false` otherwise.
+     *  @param[in,out] km
+     *          Square symmetric kernel matrix to center.
+     *  @param[out] stats
+     *          Row means and grand mean of the matrix before centering.
      */
     template<typename RET_TYPE>
-    bool isSquare(const std::vector<std::vector<RET_TYPE> > &m);
+    void center(const MatrixView<RET_TYPE> &km,CenterStats &stats);
 
-    /** @brief Verifies if matrix is symmetric.
-     *
-     *  Internally also verifies that the matrix is square.
+    /** @brief Centers a square kernel matrix in place.
      *
-     *  @param[in] m
-     *          Matrix to verify.
-     *  @returns
-     *          `true` if the matrix is square and symmetric. `false` otherwise.
+     *  Same as the Matrix version, on nested std::vector matrices.
      */
     template<typename RET_TYPE>
-    bool isSymmetric(const std::vector<std::vector<RET_TYPE> > &m);
+    void center(std::vector<std::vector<RET_TYPE> > &km);
 
-    /** @brief Verifies if the distance matrix satisfies the triangle inequality.
-     *
-     *  The triangle inequality is defined as \f$ d(x_i,x_j) \le d(x_i,x_k) + d(x_k,x_j) \quad \forall x_i,x_j,x_k \f$.
+    /** @brief Centers a square kernel matrix in place, and stores the statistics required to center test inputs.
      *
-     *  Internally also verifies that the matrix is square and symmetric.
-     *
-     *  @param[in] dm
-     *          Matrix to verify.
-     *  @returns
-     *          `true` if the matrix satisfies the condition. `false` otherwise.
+     *  Same as the Matrix version, on nested std::vector matrices.
      */
     template<typename RET_TYPE>
-    bool respectsTriangleInequality(const std::vector<std::vector<RET_TYPE> > &dm);
+    void center(std::vector<std::vector<RET_TYPE> > &km,CenterStats &stats);
 
-    /** @brief Verifies if the kernel matrix satisfies the Cauchy-Schwarz inequality.
+    /** @brief Centers in place a test-vs-train kernel matrix, consistently with the centering of the training kernel matrix.
      *
-     *  The Cauchy-Schwarz inequality is defined as \f$ k(x_i,x_j)^2 \le k(x_i,x_i) k(x_j,x_j) \quad \forall x_i,x_j \f$.
+     *  With `kt[a][j]` the kernel value between test input \f$ a \f$ and training input \f$ j \f$, computes
+     *  \f[
+     *      K^t_{aj} \leftarrow K^t_{aj} - \frac{1}{N}\sum_l K^t_{al} - m_j + g,
+     *  \f]
+     *  where \f$ m_j \f$ and \f$ g \f$ are the training statistics.
      *
-     *  Internally also verifies that the matrix is square and symmetric.
+     *  @param[in,out] kt
+     *          Test-vs-train kernel matrix, with one column per training input.
+     *  @param[in] stats
+     *          Statistics of the training kernel matrix, as produced by ktools::center(km,stats).
+     */
+    template<typename RET_TYPE>
+    void centerTest(const MatrixView<RET_TYPE> &kt,const CenterStats &stats);
+
+    /** @brief Centers in place a test-vs-train kernel matrix, consistently with the centering of the training kernel matrix.
      *
-     *  @param[in] km
-     *          Matrix to verify.
-     *  @returns
-     *          `true` if the matrix satisfies the condition. `false` otherwise.
+     *  Same as the Matrix version, on nested std::vector matrices.
      */
     template<typename RET_TYPE>
-    bool respectsCauchySchwarz(const std::vector<std::vector<RET_TYPE> > &km);
-}
+    void centerTest(std::vector<std::vector<RET_TYPE> > &kt,const CenterStats &stats);
 
-namespace ktools {
+    ////////////////
+    // KERNEL PCA //
+    ////////////////
 
-    template<typename RET_TYPE>
-    void kern2norm(std::vector<std::vector<RET_TYPE> > &nkm) {
-        for(size_t i=0;i<nkm.size();i++) {
-            for(size_t j=0;j<i;j++) {
-                if(nkm[i][j]!=RET_TYPE(0)) {
-                    nkm[i][j]/=std::sqrt(nkm[i][i]*nkm[j][j]);
-                    nkm[j][i]=nkm[i][j];
-                }
-            }
-        }
-        for(size_t i=0;i<nkm.size();i++)
-            if(nkm[i][i]!=RET_TYPE(0))
-                nkm[i][i]=RET_TYPE(1);
-    }
+    /** @brief Kernel PCA model, i.e. the leading eigenpairs of a centered kernel matrix, together with the statistics required to project new inputs.
+     *
+     *  Filled by ktools::kpca, consumed by ktools::kpcaProject.
+     */
+    struct KpcaModel {
+        /** @brief Leading eigenvalues of the centered kernel matrix, in decreasing order. */
+        std::vector<double> eigenvalues;
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void norm(SK &sk,const DATA_TYPE &x,const DATA_TYPE &y,RET_TYPE &nk) {
-        sk(x,y,nk);
-        if(nk!=RET_TYPE(0)) {
-            RET_TYPE xk,yk;
-            sk(x,xk);
-            sk(y,yk);
-            nk/=std::sqrt(xk*yk);
-        }
-    }
+        /** @brief Corresponding unit eigenvectors, one per row. */
+        Matrix<double> eigenvectors;
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void norm(SK &sk,const DATA_TYPE &x,RET_TYPE &nk) {
-        sk(x,nk);
-        if(nk!=RET_TYPE(0))
-            nk=RET_TYPE(1);
-    }
+        /** @brief Centering statistics of the (never materialized) training kernel matrix. */
+        CenterStats stats;
+    };
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &nkm) {
-        std::vector<RET_TYPE> xkv,ykv;
-        sk(xlist,ylist,nkm);
-        sk(xlist,xkv);
-        sk(ylist,ykv);
-        for(size_t i=0;i<xkv.size();i++)
-            for(size_t j=0;j<ykv.size();j++)
-                if(nkm[i][j]!=RET_TYPE(0))
-                    nkm[i][j]/=std::sqrt(xkv[i]*ykv[j]);
-    }
+    /** @brief Matrix-free kernel PCA: computes the leading eigenpairs of the centered kernel matrix on `xlist`, without storing the kernel matrix.
+     *
+     *  Runs a randomized subspace iteration on a block of \f$ L = K + \f$ `oversampling` vectors, followed by a Rayleigh-Ritz projection.
+     *  Each of the `iters+2` products with the centered kernel matrix is streamed: rows of the kernel matrix are evaluated on demand, tile by tile, on all threads.
+     *  Optionally, the first `cacheBytes` bytes worth of row tiles are kept in memory and reused by the later products, which then skip the kernel evaluations.
+     *
+     *  The kernel instance is evaluated concurrently, after ktools::prepare(sk,xlist).
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of training inputs.
+     *  @param[in] K
+     *          Number of eigenpairs.
+     *  @param[out] model
+     *          The computed eigenpairs and centering statistics.
+     *  @param[in] cacheBytes
+     *          Memory budget for cached row tiles, in bytes (defaults to 0, i.e. no caching).
+     *  @param[in] iters
+     *          Number of subspace iterations (defaults to 2).
+     *  @param[in] oversampling
+     *          Number of additional vectors in the iterated block (defaults to 10).
+     *  @param[in] seed
+     *          Seed of the random starting block.
+     */
+    template<typename SK,typename DATA_TYPE>
+    void kpca(SK &sk,const std::vector<DATA_TYPE> &xlist,size_t K,KpcaModel &model,size_t cacheBytes=0,size_t iters=2,size_t oversampling=10,uint64_t seed=5489);
 
+    /** @brief Projects inputs on the principal components of a kernel PCA model.
+     *
+     *  After evaluation, `proj[a][c]` is set to the coordinate of `ylist[a]` along the `c`-th principal component,
+     *  \f$ \sum_j \tilde{k}(y_a,x_j) u_{cj} / \sqrt{\lambda_c} \f$, where \f$ \tilde{k} \f$ is centered with the training statistics (see ktools::centerTest).
+     *  Components with non-positive eigenvalue are projected to 0.
+     *
+     *  @param[in] sk
+     *          Kernel instance used to compute the model.
+     *  @param[in] xlist
+     *          List (std::vector) of training inputs used to compute the model.
+     *  @param[in] model
+     *          Kernel PCA model.
+     *  @param[in] ylist
+     *          List (std::vector) of inputs to project.
+     *  @param[out] proj
+     *          Reference to a matrix (Matrix) variable in which the projections are stored.
+     */
     template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &nkm) {
-        sk(xlist,nkm);
-        kern2norm(nkm);
-    }
+    void kpcaProject(SK &sk,const std::vector<DATA_TYPE> &xlist,const KpcaModel &model,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &proj);
 
+    /** @brief Projects inputs on the principal components of a kernel PCA model.
+     *
+     *  Same as the Matrix version, with the result stored in a nested std::vector matrix.
+     */
     template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &nkv) {
-        sk(xlist,nkv);
-        for(size_t i=0;i<nkv.size();i++)
-            if(nkv!=RET_TYPE(0))
-                nkv=RET_TYPE(1);
-    }
-
-    template<typename RET_TYPE>
-    void kern2dist(std::vector<std::vector<RET_TYPE> > &dm) {
-        for(size_t i=0;i<dm.size();i++)
-            for(size_t j=0;j<i;j++)
-                dm[i][j]=dm[j][i]=std::sqrt(dm[i][i]+dm[j][j]-dm[i][j]-dm[j][i]);
-        for(size_t i=0;i<dm.size();i++)
-            dm[i][i]=RET_TYPE(0);
-    }
+    void kpcaProject(SK &sk,const std::vector<DATA_TYPE> &xlist,const KpcaModel &model,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &proj);
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void dist(SK &sk,const DATA_TYPE &x,const DATA_TYPE &y,RET_TYPE &d) {
-        RET_TYPE xk,yk;
-        sk(x,y,d);
-        sk(x,xk);
-        sk(y,yk);
-        d=std::sqrt(xk+yk-2*d);
-    }
+    /////////////////////////////
+    // KERNEL RIDGE REGRESSION //
+    /////////////////////////////
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void dist(SK &sk,const DATA_TYPE &x,RET_TYPE &d) {
-        d=RET_TYPE(0);
-    }
+    /** @brief Preconditioners of ktools::krr. */
+    enum KrrPreconditioner {
+        /** @brief No preconditioner. */
+        KRR_NONE,
+        /** @brief Nyström approximation of the kernel matrix on uniformly sampled landmarks. */
+        KRR_NYSTROM,
+        /** @brief Pivoted (incomplete) Cholesky approximation of the kernel matrix, i.e. a Nyström approximation on greedily chosen landmarks. */
+        KRR_CHOLESKY
+    };
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &dm) {
-        std::vector<RET_TYPE> xkv,ykv;
-        sk(xlist,ylist,dm);
-        sk(xlist,xkv);
-        sk(ylist,ykv);
-        for(size_t i=0;i<xkv.size();i++)
-            for(size_t j=0;j<ykv.size();j++)
-                dm[i][j]=std::sqrt(xkv[i]+ykv[j]-2*dm[i][j]);
-    }
+    /** @brief Matrix-free kernel ridge regression: solves \f$ (K + \lambda I) \alpha = y \f$, where \f$ K \f$ is the kernel matrix on `xlist`, without storing the kernel matrix.
+     *
+     *  Runs the preconditioned conjugate gradient method. Each iteration costs one product with the kernel matrix, streamed as in ktools::kpca:
+     *  rows of the kernel matrix are evaluated on demand, tile by tile, on all threads, and the first `cacheBytes` bytes worth of row tiles are kept in memory and reused.
+     *
+     *  The preconditioner is \f$ P = L L^T + \lambda I \f$, where \f$ L L^T \f$ is a rank-`rank` approximation of \f$ K \f$ (see KrrPreconditioner), applied in \f$ O(N r) \f$ through the Woodbury identity.
+     *  Building it costs `rank` columns of the kernel matrix. Memory is \f$ O(N r) \f$, plus the cached tiles.
+     *
+     *  The kernel instance is evaluated concurrently, after ktools::prepare(sk,xlist).
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of training inputs.
+     *  @param[in] y
+     *          Training targets.
+     *  @param[in] lambda
+     *          Regularization, must be positive.
+     *  @param[in,out] alpha
+     *          Dual coefficients. Used as the starting point if it already has one element per input, and started from 0 otherwise.
+     *  @param[in] precond
+     *          Preconditioner (defaults to KRR_CHOLESKY).
+     *  @param[in] rank
+     *          Rank of the preconditioner (defaults to 100).
+     *  @param[in] cacheBytes
+     *          Memory budget for cached row tiles, in bytes (defaults to 0, i.e. no caching).
+     *  @param[in] tol
+     *          Tolerance on the residual norm, relative to the norm of `y` (defaults to 1e-6).
+     *  @param[in] maxIter
+     *          Maximum number of iterations (defaults to 1000).
+     *  @param[in] seed
+     *          Seed of the landmark sampling of KRR_NYSTROM.
+     *  @returns
+     *          The number of iterations.
+     */
+    template<typename SK,typename DATA_TYPE>
+    size_t krr(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<double> &y,double lambda,std::vector<double> &alpha,KrrPreconditioner precond=KRR_CHOLESKY,size_t rank=100,size_t cacheBytes=0,double tol=1e-6,size_t maxIter=1000,uint64_t seed=5489);
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &dm) {
-        sk(xlist,dm);
-        kern2dist(dm);
-    }
+    /** @brief Predicts the targets of new inputs with a kernel ridge regression model.
+     *
+     *  After evaluation, `f[a]` is set to \f$ \sum_j k(y_a,x_j) \alpha_j \f$. Queries are evaluated in parallel.
+     *
+     *  @param[in] sk
+     *          Kernel instance used to compute the model.
+     *  @param[in] xlist
+     *          List (std::vector) of training inputs used to compute the model.
+     *  @param[in] alpha
+     *          Dual coefficients computed by ktools::krr.
+     *  @param[in] ylist
+     *          List (std::vector) of query inputs.
+     *  @param[out] f
+     *          Reference to a vector (std::vector) variable in which the predictions are stored.
+     */
+    template<typename SK,typename DATA_TYPE>
+    void krrPredict(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<double> &alpha,const std::vector<DATA_TYPE> &ylist,std::vector<double> &f);
 
-    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
-    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &dv) {
-        for(size_t i=0;i<dv.size();i++)
-            dv=RET_TYPE(0);
-    }
+    //////////////////////
+    // CLUSTERING TOOLS //
+    //////////////////////
 
+    /** @brief k-medoids clustering on a distance matrix.
+     *
+     *  Starts from K random medoids, and improves them with FasterPAM swaps: each non-medoid candidate is evaluated against all medoids at once in \f$ O(N) \f$,
+     *  and the best swap for that candidate is applied eagerly as soon as it reduces the total deviation.
+     *  Candidates are evaluated in parallel batches against the current medoids; batch results after an applied swap are discarded and re-evaluated.
+     *  The iteration stops when a full pass over the candidates applies no swap, or after `maxIter` passes.
+     *
+     *  @param[in] dm
+     *          Square distance matrix.
+     *  @param[in] K
+     *          Number of clusters.
+     *  @param[out] medoids
+     *          Indexes of the K medoids.
+     *  @param[out] labels
+     *          For each input, the position in `medoids` of its nearest medoid.
+     *  @param[in] maxIter
+     *          Maximum number of passes over the candidates (defaults to 100).
+     *  @param[in] seed
+     *          Seed of the random initialization.
+     *  @returns
+     *          The total deviation, i.e. the sum of the distances of all inputs to their nearest medoid.
+     */
     template<typename RET_TYPE>
-    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t NR,size_t NC) {
-        m.resize(NR);
-        for(size_t i=0;i<NR;i++)
-            m[i].resize(NC);
-    }
+    double kmedoids(const MatrixView<RET_TYPE> &dm,size_t K,std::vector<size_t> &medoids,std::vector<size_t> &labels,size_t maxIter=100,uint64_t seed=5489);
 
+    /** @brief k-medoids clustering on a distance matrix.
+     *
+     *  Same as the Matrix version, on nested std::vector matrices.
+     */
     template<typename RET_TYPE>
-    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t N) {
-        resizeMat(m,N,N);
-    }
+    double kmedoids(const std::vector<std::vector<RET_TYPE> > &dm,size_t K,std::vector<size_t> &medoids,std::vector<size_t> &labels,size_t maxIter=100,uint64_t seed=5489);
 
-    template<typename RET_TYPE>
+    /** @brief k-medoids clustering on the inputs in `xlist`, with the kernel distance (see ktools::dist) computed lazily.
+     *
+     *  Same as the distance matrix version, without ever materializing the distance matrix: the self-kernels are computed once,
+     *  and each candidate evaluation computes one row of distances on demand. Memory is \f$ O(NK) \f$.
+     *
+     *  The kernel instance is evaluated concurrently, after ktools::prepare(sk,xlist).
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of inputs.
+     *  @param[in] K
+     *          Number of clusters.
+     *  @param[out] medoids
+     *          Indexes of the K medoids.
+     *  @param[out] labels
+     *          For each input, the position in `medoids` of its nearest medoid.
+     *  @param[in] maxIter
+     *          Maximum number of passes over the candidates (defaults to 100).
+     *  @param[in] seed
+     *          Seed of the random initialization.
+     *  @returns
+     *          The total deviation, i.e. the sum of the distances of all inputs to their nearest medoid.
+     */
+    template<typename SK,typename DATA_TYPE>
+    double kmedoids(SK &sk,const std::vector<DATA_TYPE> &xlist,size_t K,std::vector<size_t> &medoids,std::vector<size_t> &labels,size_t maxIter=100,uint64_t seed=5489);
+
+    ///////////////////////
+    // INCREMENTAL TOOLS //
+    ///////////////////////
+
+    /** @brief Extends a kernel matrix with the rows and columns of new inputs.
+     *
+     *  `km` and `kv` hold the kernel matrix and the self-kernels of the first `km.rows()` inputs of `xlist`, e.g. as computed by a previous call.
+     *  The remaining inputs of `xlist` are new: only their self-kernels and their kernel values against all the inputs are evaluated,
+     *  i.e. \f$ N_{new}(N_{new}+1)/2 + N_{old}N_{new} \f$ kernel evaluations instead of \f$ N(N+1)/2 \f$.
+     *  New rows are computed concurrently, on up to numThreads() threads.
+     *  The old rows are not moved unless the capacity of `km` is exceeded (see Matrix::reserve), in which case it is grown geometrically, by half, so that repeated extensions copy it only a logarithmic number of times.
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of all the inputs, the old ones first.
+     *  @param[in,out] km
+     *          Kernel matrix of the old inputs, extended to all the inputs.
+     *  @param[in,out] kv
+     *          Self-kernels of the old inputs, extended to all the inputs.
+     */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv);
+
+    /** @brief Extends a kernel matrix and its normalized version with the rows and columns of new inputs.
+     *
+     *  Same as `ktools::extend(sk,xlist,km,kv)`, with the normalized kernel matrix `nkm` (see ktools::norm) of the old inputs extended as well, at no further kernel evaluation.
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of all the inputs, the old ones first.
+     *  @param[in,out] km
+     *          Kernel matrix of the old inputs, extended to all the inputs.
+     *  @param[in,out] kv
+     *          Self-kernels of the old inputs, extended to all the inputs.
+     *  @param[in,out] nkm
+     *          Normalized kernel matrix of the old inputs, extended to all the inputs.
+     */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv,Matrix<RET_TYPE> &nkm);
+
+    /** @brief Same as the Matrix version, on a packed symmetric matrix (PackedMatrix), which grows in place: the old rows are not moved unless the capacity is exceeded (see PackedMatrix::reserve). */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv);
+
+    /** @brief Same as the Matrix version, on packed symmetric matrices (PackedMatrix), which grow in place. */
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv,PackedMatrix<RET_TYPE> &nkm);
+
+    //////////////////////
+    // OUT-OF-CORE TOOLS //
+    //////////////////////
+
+    /** @brief Streams over the stored tiles of a tiled matrix, with bounded memory.
+     *
+     *  Calls `f(ti,tj,tile)` for each stored tile (ti,tj), where `tile` is the MatrixView returned by `m.tile(ti,tj)`.
+     *  All the tiles are visited concurrently, on up to numThreads() threads, and handed out in tile row order.
+     *  Each tile row is released (see TiledMatrix::release) as soon as all its tiles are done, hence only the few tile rows being visited are resident.
+     *
+     *  @param[in] m
+     *          Tiled matrix.
+     *  @param[in] f
+     *          Function called on each tile.
+     */
+    template<typename RET_TYPE,typename F>
+    void forEachTile(TiledMatrix<RET_TYPE> &m,F f);
+
+    /** @brief Streams the kernel matrix \f$ k_{SK}(x_i,y_j) \f$ on `xlist` and `ylist` to a writer (e.g. LibsvmWriter or BinaryWriter), one block of rows at a time.
+     *
+     *  Each block of rows is computed through the list overload `sk(xblock,ylist,km)`, and passed to `w.write(view)` on a separate thread while the next block is computed.
+     *  Each `xblock` is a copy of a range of `xlist`, released (see ktools::release) as soon as its rows are computed.
+     *  Hence formatting and writing overlap with the kernel evaluations, and at most two blocks of rows are held in memory.
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of inputs suitable for `sk`, one per row.
+     *  @param[in] ylist
+     *          List (std::vector) of inputs suitable for `sk`, one per column.
+     *  @param[in] w
+     *          Writer, i.e. any instance with a method `write(const MatrixView<double> &rows)`.
+     *  @param[in] blockRows
+     *          Number of rows of each block.
+     */
+    template<typename SK,typename DATA_TYPE,typename WRITER>
+    void stream(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,WRITER &w,size_t blockRows=256);
+
+    /** @brief Streams the kernel matrix \f$ k_{SK}(x_i,x_j) \f$ on `xlist` to a writer. Equivalent to `ktools::stream(sk,xlist,xlist,w,blockRows)`. */
+    template<typename SK,typename DATA_TYPE,typename WRITER>
+    void stream(SK &sk,const std::vector<DATA_TYPE> &xlist,WRITER &w,size_t blockRows=256);
+
+    /////////////////////////
+    // OTHER GENERIC TOOLS //
+    /////////////////////////
+
+    /** @brief Resizes a matrix into \f$ NR \times NC \f$.
+     *
+     *  @param[in] m
+     *          Matrix to resize.
+     *  @param[in] NR
+     *          Number of rows.
+     *  @param[in] NC
+     *          Number of columns.
+     */
+    template<typename RET_TYPE>
+    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t NR,size_t NC);
+
+    /** @brief Resizes a matrix to be square and into \f$ N \times N \f$.
+     *
+     *  Equivalent to `ktools::resizeMat(m,N,N)`.
+     *  @param[in] m
+     *          Matrix to resize.
+     *  @param[in] N
+     *          Number of rows and columns.
+     */
+    template<typename RET_TYPE>
+    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t N);
+
+    /** @brief Resizes a matrix into \f$ NR \times NC \f$.
+     *
+     *  Equivalent to `m.resize(NR,NC)`.
+     *
+     *  @param[in] m
+     *          Matrix to resize.
+     *  @param[in] NR
+     *          Number of rows.
+     *  @param[in] NC
+     *          Number of columns.
+     */
+    template<typename RET_TYPE>
+    void resizeMat(Matrix<RET_TYPE> &m,size_t NR,size_t NC);
+
+    /** @brief Resizes a matrix to be square and into \f$ N \times N \f$.
+     *
+     *  Equivalent to `m.resize(N,N)`.
+     *
+     *  @param[in] m
+     *          Matrix to resize.
+     *  @param[in] N
+     *          Number of rows and columns.
+     */
+    template<typename RET_TYPE>
+    void resizeMat(Matrix<RET_TYPE> &m,size_t N);
+
+    /** @brief Resizes a packed symmetric matrix into \f$ N \times N \f$.
+     *
+     *  Equivalent to `m.resize(N)`.
+     *
+     *  @param[in] m
+     *          Matrix to resize.
+     *  @param[in] N
+     *          Number of rows and columns.
+     */
+    template<typename RET_TYPE>
+    void resizeMat(PackedMatrix<RET_TYPE> &m,size_t N);
+
+    /** @brief Copies a nested std::vector matrix into a Matrix.
+     *
+     *  @param[in] src
+     *          Matrix to copy. All rows must have the same size.
+     *  @param[out] dst
+     *          Matrix in which the elements are copied. Resized accordingly.
+     */
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const std::vector<std::vector<SRC_TYPE> > &src,Matrix<RET_TYPE> &dst);
+
+    /** @brief Copies a Matrix (or MatrixView) into a nested std::vector matrix.
+     *
+     *  @param[in] src
+     *          Matrix to copy.
+     *  @param[out] dst
+     *          Matrix in which the elements are copied. Resized accordingly.
+     */
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const MatrixView<SRC_TYPE> &src,std::vector<std::vector<RET_TYPE> > &dst);
+
+    /** @brief Copies a Matrix (or MatrixView) into a Matrix, possibly of a different element type.
+     *
+     *  @param[in] src
+     *          Matrix to copy.
+     *  @param[out] dst
+     *          Matrix in which the elements are copied. Resized accordingly.
+     */
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const MatrixView<SRC_TYPE> &src,Matrix<RET_TYPE> &dst);
+
+    /** @brief Unpacks a packed symmetric matrix into a Matrix, possibly of a different element type.
+     *
+     *  @param[in] src
+     *          Matrix to copy.
+     *  @param[out] dst
+     *          Matrix in which the elements are copied. Resized accordingly.
+     */
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const PackedMatrix<SRC_TYPE> &src,Matrix<RET_TYPE> &dst);
+
+    /** @brief Packs the lower triangle of a square Matrix (or MatrixView) into a packed symmetric matrix, possibly of a different element type.
+     *
+     *  The upper triangle is ignored, i.e. the matrix is assumed to be symmetric.
+     *
+     *  @param[in] src
+     *          Matrix to copy.
+     *  @param[out] dst
+     *          Matrix in which the elements are copied. Resized accordingly.
+     */
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const MatrixView<SRC_TYPE> &src,PackedMatrix<RET_TYPE> &dst);
+
+    /** @brief Verifies if matrix is square.
+     *
+     *  @param[in] m
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix is square. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool isSquare(const std::vector<std::vector<RET_TYPE> > &m);
+
+    /** @brief Verifies if matrix is square.
+     *
+     *  @param[in] m
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix is square. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool isSquare(const MatrixView<RET_TYPE> &m);
+
+    /** @brief Verifies if matrix is symmetric.
+     *
+     *  Internally also verifies that the matrix is square.
+     *
+     *  @param[in] m
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix is square and symmetric. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool isSymmetric(const std::vector<std::vector<RET_TYPE> > &m);
+
+    /** @brief Verifies if matrix is symmetric.
+     *
+     *  Internally also verifies that the matrix is square.
+     *
+     *  @param[in] m
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix is square and symmetric. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool isSymmetric(const MatrixView<RET_TYPE> &m);
+
+    /** @brief Verifies if the distance matrix satisfies the triangle inequality.
+     *
+     *  The triangle inequality is defined as \f$ d(x_i,x_j) \le d(x_i,x_k) + d(x_k,x_j) \quad \forall x_i,x_j,x_k \f$,
+     *  i.e. \f$ D \f$ must not be greater than its min-plus product with itself, \f$ (D \otimes D)_{ij} = \min_k (D_{ik} + D_{kj}) \f$.
+     *  The min-plus product is evaluated block by block, in parallel, and the verification stops as soon as any violation is found.
+     *
+     *  Internally also verifies that the matrix is square and symmetric.
+     *
+     *  @param[in] dm
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix satisfies the condition. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool respectsTriangleInequality(const std::vector<std::vector<RET_TYPE> > &dm);
+
+    /** @brief Verifies if the distance matrix satisfies the triangle inequality.
+     *
+     *  Matrix version of `ktools::respectsTriangleInequality(dm)`.
+     *
+     *  @param[in] dm
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix satisfies the condition. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool respectsTriangleInequality(const MatrixView<RET_TYPE> &dm);
+
+    /** @brief Estimates the fraction of triplets which violate the triangle inequality in the distance matrix.
+     *
+     *  Triplets \f$ (i,j,k) \f$ are sampled uniformly at random (with replacement), on all threads, until the time budget expires,
+     *  and the fraction of sampled triplets for which \f$ d(x_i,x_j) > d(x_i,x_k) + d(x_k,x_j) \f$ is returned.
+     *  Meant for matrices too large for the exact verification, or when a violation rate is more informative than a yes/no answer.
+     *
+     *  @param[in] dm
+     *          Square matrix to verify.
+     *  @param[in] seconds
+     *          Time budget, in seconds.
+     *  @param[out] samples
+     *          Number of triplets actually sampled.
+     *  @param[in] seed
+     *          Seed of the random generators. Results are reproducible only when both the seed and the number of samples match.
+     *  @returns
+     *          The fraction of sampled triplets which violate the condition.
+     */
+    template<typename RET_TYPE>
+    double triangleViolationRate(const MatrixView<RET_TYPE> &dm,double seconds,size_t &samples,uint64_t seed=5489);
+
+    /** @brief Estimates the fraction of triplets which violate the triangle inequality in the distance matrix.
+     *
+     *  Same as the Matrix version, on nested std::vector matrices.
+     */
+    template<typename RET_TYPE>
+    double triangleViolationRate(const std::vector<std::vector<RET_TYPE> > &dm,double seconds,size_t &samples,uint64_t seed=5489);
+
+    /** @brief Verifies if the kernel matrix satisfies the Cauchy-Schwarz inequality.
+     *
+     *  The Cauchy-Schwarz inequality is defined as \f$ k(x_i,x_j)^2 \le k(x_i,x_i) k(x_j,x_j) \quad \forall x_i,x_j \f$.
+     *
+     *  Internally also verifies that the matrix is square and symmetric.
+     *
+     *  @param[in] km
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix satisfies the condition. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool respectsCauchySchwarz(const std::vector<std::vector<RET_TYPE> > &km);
+
+    /** @brief Verifies if the kernel matrix satisfies the Cauchy-Schwarz inequality.
+     *
+     *  Matrix version of `ktools::respectsCauchySchwarz(km)`.
+     *
+     *  @param[in] km
+     *          Matrix to verify.
+     *  @returns
+     *          `true` if the matrix satisfies the condition. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool respectsCauchySchwarz(const MatrixView<RET_TYPE> &km);
+
+    /** @brief Verifies if the kernel matrix is positive semi-definite.
+     *
+     *  Runs a blocked Cholesky factorization with complete (diagonal) pivoting, which stops as soon as the largest remaining pivot falls below `tol` times the largest diagonal entry.
+     *  The matrix is positive semi-definite if the remaining Schur complement is negligible, i.e. if none of its entries exceeds the same threshold in absolute value.
+     *  The cost is \f$ O(N^2 r) \f$, where \f$ r \f$ is the numerical rank, and the trailing updates run in parallel.
+     *
+     *  Internally also verifies that the matrix is square and symmetric.
+     *
+     *  @param[in] km
+     *          Matrix to verify.
+     *  @param[in] tol
+     *          Tolerance, relative to the largest diagonal entry.
+     *  @returns
+     *          `true` if the matrix satisfies the condition. `false` otherwise.
+     */
+    template<typename RET_TYPE>
+    bool isPositiveSemiDefinite(const MatrixView<RET_TYPE> &km,double tol=1e-10);
+
+    /** @brief Verifies if the kernel matrix is positive semi-definite.
+     *
+     *  Same as the Matrix version, on nested std::vector matrices.
+     */
+    template<typename RET_TYPE>
+    bool isPositiveSemiDefinite(const std::vector<std::vector<RET_TYPE> > &km,double tol=1e-10);
+
+    /** @brief Estimates the smallest eigenvalue of a symmetric matrix.
+     *
+     *  Runs the Lanczos iteration, with full reorthogonalization, from a random starting vector, and returns the smallest Ritz value.
+     *  The iteration stops when the smallest Ritz value changes by less than `tol` (relative to the largest Ritz value) in between two checks, or after `maxIter` iterations.
+     *  Each iteration costs one matrix-vector product, evaluated in parallel.
+     *
+     *  @param[in] km
+     *          Square symmetric matrix.
+     *  @param[in] maxIter
+     *          Maximum number of Lanczos iterations, at least 1.
+     *  @param[in] tol
+     *          Convergence tolerance.
+     *  @param[in] seed
+     *          Seed of the random starting vector.
+     *  @returns
+     *          The estimate of the smallest eigenvalue, which is never smaller than the actual one.
+     */
+    template<typename RET_TYPE>
+    double smallestEigenvalue(const MatrixView<RET_TYPE> &km,size_t maxIter=300,double tol=1e-10,uint64_t seed=5489);
+
+    /** @brief Estimates the smallest eigenvalue of a symmetric matrix.
+     *
+     *  Same as the Matrix version, on nested std::vector matrices.
+     */
+    template<typename RET_TYPE>
+    double smallestEigenvalue(const std::vector<std::vector<RET_TYPE> > &km,size_t maxIter=300,double tol=1e-10,uint64_t seed=5489);
+
+    /** @brief Repairs a symmetric matrix into a positive semi-definite one, by clipping its eigenvalues.
+     *
+     *  Computes the full eigendecomposition \f$ K = \sum_i \lambda_i u_i u_i^T \f$ (Householder tridiagonalization and implicit QL iterations),
+     *  and replaces each eigenvalue \f$ \lambda_i < \lambda_{min} \f$ by \f$ \lambda_{min} \f$, which is the closest such matrix in Frobenius norm.
+     *  Only the clipped components are added back to the matrix, \f$ K \leftarrow K + \sum_{\lambda_i < \lambda_{min}} (\lambda_{min}-\lambda_i) u_i u_i^T \f$.
+     *
+     *  @param[in,out] km
+     *          Square symmetric matrix to repair.
+     *  @param[in] minEig
+     *          Minimum eigenvalue \f$ \lambda_{min} \f$ (defaults to 0).
+     *  @returns
+     *          The number of clipped eigenvalues.
+     */
+    template<typename RET_TYPE>
+    size_t clipEigenvalues(const MatrixView<RET_TYPE> &km,double minEig=0);
+
+    /** @brief Repairs a symmetric matrix into a positive semi-definite one, by clipping its eigenvalues.
+     *
+     *  Same as the Matrix version, on nested std::vector matrices.
+     */
+    template<typename RET_TYPE>
+    size_t clipEigenvalues(std::vector<std::vector<RET_TYPE> > &km,double minEig=0);
+
+    /** @brief Computes a 64-bit content hash (FNV-1a) of a kernel input.
+     *
+     *  Basic types are hashed through their binary representation, while std::vector inputs are hashed element by element (together with their size), recursively.
+     *  Equal inputs always produce equal hashes, and therefore the hash can be used to identify inputs by content, e.g. to cache self-kernel values.
+     *
+     *  @param[in] x
+     *          Input to hash. Must be a basic type, or a (possibly nested) std::vector of basic types.
+     *  @param[in] h
+     *          Initial value of the hash, to chain multiple inputs.
+     *  @returns
+     *          The hash value.
+     */
+    template<typename DATA_TYPE>
+    uint64_t hash(const DATA_TYPE &x,uint64_t h=14695981039346656037ULL);
+
+    /** @brief Computes a 64-bit content hash (FNV-1a) of a std::vector input.
+     *
+     *  @param[in] x
+     *          Input to hash.
+     *  @param[in] h
+     *          Initial value of the hash, to chain multiple inputs.
+     *  @returns
+     *          The hash value.
+     */
+    template<typename DATA_TYPE>
+    uint64_t hash(const std::vector<DATA_TYPE> &x,uint64_t h=14695981039346656037ULL);
+
+    /** @brief Computes a 64-bit hash of the parameters of a kernel instance, which identifies its kernel function.
+     *
+     *  Returns `sk.fingerprint()` if the kernel class provides such a method (as all the kernels of this library do, e.g. from \f$ \sigma \f$ for the RbfKernel,
+     *  or from \f$ C_{HV} \f$, \f$ C_D \f$ and the symbol kernel for the PathKernel), and 0 otherwise.
+     *  Used to verify that kernel values saved on disk were computed with the same kernel function, e.g. by NormRefSet and VpTree.
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @returns
+     *          The fingerprint, or 0 if the kernel class does not provide one.
+     */
+    template<typename SK>
+    uint64_t fingerprint(const SK &sk);
+
+    ////////////////////
+    // PARALLEL TOOLS //
+    ////////////////////
+
+    /** @brief Number of threads used by the multi-threaded tools.
+     *
+     *  @returns
+     *          The number of threads set by setNumThreads(), or the number of hardware threads by default.
+     */
+    size_t numThreads();
+
+    /** @brief Sets the number of threads used by the multi-threaded tools.
+     *
+     *  @param[in] n
+     *          Number of threads. 0 restores the default, i.e. the number of hardware threads.
+     */
+    void setNumThreads(size_t n);
+
+    /** @brief Prepares a kernel instance for concurrent evaluations on the inputs in `xlist`.
+     *
+     *  The multi-threaded tools evaluate the kernel from several threads at once, hence kernels which update internal state on evaluation must do so beforehand.
+     *  Calls `sk.prepare(xlist)` if the kernel class provides such a method (e.g. PathKernel, which extends its weight matrix to the longest sequence), and does nothing otherwise.
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of inputs on which the kernel is going to be evaluated.
+     */
+    template<typename SK,typename DATA_TYPE>
+    void prepare(SK &sk,const std::vector<DATA_TYPE> &xlist);
+
+    /** @brief Notifies a kernel instance that the inputs in `xlist` are about to be destroyed.
+     *
+     *  The tools which evaluate the kernel on temporary copies of the inputs (e.g. the blocks of ktools::stream) release them before they go out of scope,
+     *  so that kernels which identify inputs by address (e.g. NormKernel with an identity self-kernel cache) do not mistake later inputs at the same address for them.
+     *  Calls `sk.release(xlist)` if the kernel class provides such a method, and does nothing otherwise.
+     *
+     *  @param[in] sk
+     *          Kernel instance.
+     *  @param[in] xlist
+     *          List (std::vector) of inputs about to be destroyed.
+     */
+    template<typename SK,typename DATA_TYPE>
+    void release(SK &sk,const std::vector<DATA_TYPE> &xlist);
+}
+
+namespace ktools {
+
+    namespace detail {
+
+        /** @brief Storage of the number of threads set by setNumThreads(). */
+        inline size_t& threadSetting() {
+            static size_t n=0;
+            return n;
+        }
+
+        /** @brief Whether the calling thread is a worker thread of parallelFor. */
+        inline bool& inWorker() {
+            thread_local bool w=false;
+            return w;
+        }
+
+        /** @brief Runs `f(t,tid)` for all tasks \f$ t \in [0,N) \f$ on up to numThreads() threads, with dynamic scheduling.
+         *
+         *  `tid` identifies the executing thread, in \f$ [0,numThreads()) \f$. The first exception thrown by any task is rethrown once all threads have joined.
+         *  Nested calls, from within a task (e.g. a kernel list overload evaluated on a block of a larger matrix), run their tasks serially on the calling thread.
+         */
+        template<typename F>
+        void parallelFor(size_t N,F f) {
+            size_t T=std::min(numThreads(),N);
+            if(T<=1||inWorker()) {
+                for(size_t t=0;t<N;t++)
+                    f(t,size_t(0));
+                return;
+            }
+            std::atomic<size_t> next(0);
+            std::atomic<bool> failed(false);
+            std::exception_ptr error;
+            std::vector<std::thread> threads;
+            for(size_t tid=0;tid<T;tid++) {
+                threads.push_back(std::thread([&,tid]() {
+                    inWorker()=true;
+                    try {
+                        for(size_t t=next++;t<N&&!failed;t=next++)
+                            f(t,tid);
+                    }
+                    catch(...) {
+                        if(!failed.exchange(true))
+                            error=std::current_exception();
+                    }
+                }));
+            }
+            for(size_t tid=0;tid<T;tid++)
+                threads[tid].join();
+            if(error)
+                std::rethrow_exception(error);
+        }
+    }
+
+    namespace detail {
+
+        /** @brief Min-plus update of a row, \f$ m_j \leftarrow \min(m_j, a + b_j) \f$.
+         *
+         *  Branch-free and unrolled by 4 with all loads ahead of the stores, so that the compiler emits packed SIMD min instructions even without loop vectorization.
+         */
+        template<typename VAL_TYPE,typename RET_TYPE>
+        void minPlusRow(const VAL_TYPE a,const RET_TYPE *b,VAL_TYPE *m,size_t n) {
+            size_t j=0;
+            for(;j+4<=n;j+=4) {
+                VAL_TYPE v0=a+b[j],v1=a+b[j+1],v2=a+b[j+2],v3=a+b[j+3];
+                VAL_TYPE m0=m[j],m1=m[j+1],m2=m[j+2],m3=m[j+3];
+                m[j]=v0<m0?v0:m0;
+                m[j+1]=v1<m1?v1:m1;
+                m[j+2]=v2<m2?v2:m2;
+                m[j+3]=v3<m3?v3:m3;
+            }
+            for(;j<n;j++) {
+                VAL_TYPE v=a+b[j];
+                m[j]=v<m[j]?v:m[j];
+            }
+        }
+
+        /** @brief Squared Euclidean distance between two arrays of n elements, in double precision.
+         *
+         *  Accumulated in 4 independent lanes, so that the compiler emits packed SIMD instructions.
+         */
+        template<typename VAL_TYPE>
+        double sqDistance(const VAL_TYPE *a,const VAL_TYPE *b,size_t n) {
+            double s0=0,s1=0,s2=0,s3=0;
+            size_t d=0;
+            for(;d+4<=n;d+=4) {
+                double d0=double(a[d])-double(b[d]),d1=double(a[d+1])-double(b[d+1]);
+                double d2=double(a[d+2])-double(b[d+2]),d3=double(a[d+3])-double(b[d+3]);
+                s0+=d0*d0;
+                s1+=d1*d1;
+                s2+=d2*d2;
+                s3+=d3*d3;
+            }
+            for(;d<n;d++) {
+                double d0=double(a[d])-double(b[d]);
+                s0+=d0*d0;
+            }
+            return (s0+s1)+(s2+s3);
+        }
+
+        /** @brief Weighted sum of a row of n symbol kernel values, \f$ \sum_j s_j (w_j + v_{n-1-j}) / 2 \f$, where `v` is read backwards (see PathKernel).
+         *
+         *  Accumulated in 4 independent lanes, so that the compiler emits packed SIMD instructions.
+         */
+        template<typename RET_TYPE>
+        double weightedSum(const RET_TYPE *s,const double *w,const double *v,size_t n) {
+            double s0=0,s1=0,s2=0,s3=0;
+            size_t j=0;
+            for(;j+4<=n;j+=4) {
+                s0+=s[j]*(w[j]+v[n-1-j]);
+                s1+=s[j+1]*(w[j+1]+v[n-2-j]);
+                s2+=s[j+2]*(w[j+2]+v[n-3-j]);
+                s3+=s[j+3]*(w[j+3]+v[n-4-j]);
+            }
+            for(;j<n;j++)
+                s0+=s[j]*(w[j]+v[n-1-j]);
+            return ((s0+s1)+(s2+s3))/2;
+        }
+
+        /** @brief Scales a row of kernel values, \f$ k_j \leftarrow a k_j r_j \f$, leaving zero values untouched. */
+        template<typename RET_TYPE>
+        void scaleRow(RET_TYPE *k,const RET_TYPE *r,RET_TYPE a,size_t n) {
+            for(size_t j=0;j<n;j++)
+                if(k[j]!=RET_TYPE(0))
+                    k[j]=k[j]*a*r[j];
+        }
+
+        /** @brief Turns a row of kernel values into distances, \f$ k_j \leftarrow \sqrt{\max(a + d_j - 2 k_j, 0)} \f$. */
+        template<typename RET_TYPE>
+        void distRow(RET_TYPE *k,const RET_TYPE *d,RET_TYPE a,size_t n) {
+            for(size_t j=0;j<n;j++) {
+                RET_TYPE s=a+d[j]-2*k[j];
+                k[j]=RET_TYPE(std::sqrt(s<RET_TYPE(0)?RET_TYPE(0):s));
+            }
+        }
+
+#if !defined(TKL_LIBRARY)||defined(TKL_LIBRARY_BUILD)
+        /** @brief Same as the generic version (see TKL_LEAF). */
+        TKL_LEAF double sqDistance(const double *a,const double *b,size_t n) {
+            double s0=0,s1=0,s2=0,s3=0;
+            size_t d=0;
+            for(;d+4<=n;d+=4) {
+                double d0=a[d]-b[d],d1=a[d+1]-b[d+1],d2=a[d+2]-b[d+2],d3=a[d+3]-b[d+3];
+                s0+=d0*d0;
+                s1+=d1*d1;
+                s2+=d2*d2;
+                s3+=d3*d3;
+            }
+            for(;d<n;d++)
+                s0+=(a[d]-b[d])*(a[d]-b[d]);
+            return (s0+s1)+(s2+s3);
+        }
+
+        /** @brief Same as the generic version (see TKL_LEAF). */
+        TKL_LEAF double sqDistance(const float *a,const float *b,size_t n) {
+            double s0=0,s1=0,s2=0,s3=0;
+            size_t d=0;
+            for(;d+4<=n;d+=4) {
+                double d0=double(a[d])-b[d],d1=double(a[d+1])-b[d+1],d2=double(a[d+2])-b[d+2],d3=double(a[d+3])-b[d+3];
+                s0+=d0*d0;
+                s1+=d1*d1;
+                s2+=d2*d2;
+                s3+=d3*d3;
+            }
+            for(;d<n;d++)
+                s0+=(double(a[d])-b[d])*(double(a[d])-b[d]);
+            return (s0+s1)+(s2+s3);
+        }
+
+        /** @brief Same as the generic version (see TKL_LEAF). */
+        TKL_LEAF double weightedSum(const double *s,const double *w,const double *v,size_t n) {
+            double s0=0,s1=0,s2=0,s3=0;
+            size_t j=0;
+            for(;j+4<=n;j+=4) {
+                s0+=s[j]*(w[j]+v[n-1-j]);
+                s1+=s[j+1]*(w[j+1]+v[n-2-j]);
+                s2+=s[j+2]*(w[j+2]+v[n-3-j]);
+                s3+=s[j+3]*(w[j+3]+v[n-4-j]);
+            }
+            for(;j<n;j++)
+                s0+=s[j]*(w[j]+v[n-1-j]);
+            return ((s0+s1)+(s2+s3))/2;
+        }
+
+        /** @brief Same as the generic version, with the values converted to double by chunks first, so that the sum vectorizes as the double version (see TKL_LEAF). */
+        TKL_LEAF double weightedSum(const float *s,const double *w,const double *v,size_t n) {
+            const size_t B=64;
+            double buf[B],sum=0;
+            for(size_t j0=0;j0<n;j0+=B) {
+                size_t m=std::min(B,n-j0);
+                for(size_t j=0;j<m;j++)
+                    buf[j]=s[j0+j];
+                // chunk [j0,j0+m) reads v backwards from index n-1-j0
+                sum+=weightedSum<double>(buf,w+j0,v+(n-j0-m),m);
+            }
+            return sum;
+        }
+
+        /** @brief Same as the generic version, with SSE2 or AVX instructions when enabled at compile time (see TKL_LEAF). */
+        TKL_LEAF void scaleRow(double *k,const double *r,double a,size_t n) {
+            size_t j=0;
+#if defined(TKL_AVX)
+            __m256d va=_mm256_set1_pd(a),z=_mm256_setzero_pd();
+            for(;j+4<=n;j+=4) {
+                __m256d kj=_mm256_loadu_pd(k+j);
+                __m256d p=_mm256_mul_pd(_mm256_mul_pd(kj,va),_mm256_loadu_pd(r+j));
+                _mm256_storeu_pd(k+j,_mm256_and_pd(p,_mm256_cmp_pd(kj,z,_CMP_NEQ_UQ)));
+            }
+#elif defined(TKL_SSE2)
+            __m128d va=_mm_set1_pd(a),z=_mm_setzero_pd();
+            for(;j+2<=n;j+=2) {
+                __m128d kj=_mm_loadu_pd(k+j);
+                __m128d p=_mm_mul_pd(_mm_mul_pd(kj,va),_mm_loadu_pd(r+j));
+                _mm_storeu_pd(k+j,_mm_and_pd(p,_mm_cmpneq_pd(kj,z)));
+            }
+#endif
+            // unconditional product and store, as the masks above (zeros are stored as +0), so that the loop vectorizes in the libtkl build, where it covers the whole row
+            for(;j<n;j++) {
+                double p=k[j]*a*r[j];
+                k[j]=k[j]!=0?p:0;
+            }
+        }
+
+        /** @brief Same as the generic version, with SSE2 or AVX instructions when enabled at compile time (see TKL_LEAF). */
+        TKL_LEAF void scaleRow(float *k,const float *r,float a,size_t n) {
+            size_t j=0;
+#if defined(TKL_AVX)
+            __m256 va=_mm256_set1_ps(a),z=_mm256_setzero_ps();
+            for(;j+8<=n;j+=8) {
+                __m256 kj=_mm256_loadu_ps(k+j);
+                __m256 p=_mm256_mul_ps(_mm256_mul_ps(kj,va),_mm256_loadu_ps(r+j));
+                _mm256_storeu_ps(k+j,_mm256_and_ps(p,_mm256_cmp_ps(kj,z,_CMP_NEQ_UQ)));
+            }
+#elif defined(TKL_SSE2)
+            __m128 va=_mm_set1_ps(a),z=_mm_setzero_ps();
+            for(;j+4<=n;j+=4) {
+                __m128 kj=_mm_loadu_ps(k+j);
+                __m128 p=_mm_mul_ps(_mm_mul_ps(kj,va),_mm_loadu_ps(r+j));
+                _mm_storeu_ps(k+j,_mm_and_ps(p,_mm_cmpneq_ps(kj,z)));
+            }
+#endif
+            // unconditional product and store, as the masks above (zeros are stored as +0), so that the loop vectorizes in the libtkl build, where it covers the whole row
+            for(;j<n;j++) {
+                float p=k[j]*a*r[j];
+                k[j]=k[j]!=0?p:0;
+            }
+        }
+
+        /** @brief Same as the generic version, with SSE2 or AVX instructions when enabled at compile time (see TKL_LEAF). */
+        TKL_LEAF void distRow(double *k,const double *d,double a,size_t n) {
+            size_t j=0;
+#if defined(TKL_AVX)
+            __m256d va=_mm256_set1_pd(a),z=_mm256_setzero_pd();
+            for(;j+4<=n;j+=4) {
+                __m256d kj=_mm256_loadu_pd(k+j);
+                __m256d s=_mm256_sub_pd(_mm256_add_pd(va,_mm256_loadu_pd(d+j)),_mm256_add_pd(kj,kj));
+                _mm256_storeu_pd(k+j,_mm256_sqrt_pd(_mm256_max_pd(z,s)));
+            }
+#elif defined(TKL_SSE2)
+            __m128d va=_mm_set1_pd(a),z=_mm_setzero_pd();
+            for(;j+2<=n;j+=2) {
+                __m128d kj=_mm_loadu_pd(k+j);
+                __m128d s=_mm_sub_pd(_mm_add_pd(va,_mm_loadu_pd(d+j)),_mm_add_pd(kj,kj));
+                _mm_storeu_pd(k+j,_mm_sqrt_pd(_mm_max_pd(z,s)));
+            }
+#endif
+            for(;j<n;j++) {
+                double s=a+d[j]-2*k[j];
+                k[j]=std::sqrt(s<0?0:s);
+            }
+        }
+
+        /** @brief Same as the generic version, with SSE2 or AVX instructions when enabled at compile time (see TKL_LEAF). */
+        TKL_LEAF void distRow(float *k,const float *d,float a,size_t n) {
+            size_t j=0;
+#if defined(TKL_AVX)
+            __m256 va=_mm256_set1_ps(a),z=_mm256_setzero_ps();
+            for(;j+8<=n;j+=8) {
+                __m256 kj=_mm256_loadu_ps(k+j);
+                __m256 s=_mm256_sub_ps(_mm256_add_ps(va,_mm256_loadu_ps(d+j)),_mm256_add_ps(kj,kj));
+                _mm256_storeu_ps(k+j,_mm256_sqrt_ps(_mm256_max_ps(z,s)));
+            }
+#elif defined(TKL_SSE2)
+            __m128 va=_mm_set1_ps(a),z=_mm_setzero_ps();
+            for(;j+4<=n;j+=4) {
+                __m128 kj=_mm_loadu_ps(k+j);
+                __m128 s=_mm_sub_ps(_mm_add_ps(va,_mm_loadu_ps(d+j)),_mm_add_ps(kj,kj));
+                _mm_storeu_ps(k+j,_mm_sqrt_ps(_mm_max_ps(z,s)));
+            }
+#endif
+            for(;j<n;j++) {
+                float s=a+d[j]-2*k[j];
+                k[j]=std::sqrt(s<0?0:s);
+            }
+        }
+#else
+        // defined in libtkl
+        double sqDistance(const double *a,const double *b,size_t n);
+        double sqDistance(const float *a,const float *b,size_t n);
+        double weightedSum(const double *s,const double *w,const double *v,size_t n);
+        double weightedSum(const float *s,const double *w,const double *v,size_t n);
+        void scaleRow(double *k,const double *r,double a,size_t n);
+        void scaleRow(float *k,const float *r,float a,size_t n);
+        void distRow(double *k,const double *d,double a,size_t n);
+        void distRow(float *k,const float *d,float a,size_t n);
+#endif
+
+        /** @brief Pointers to the rows of a nested std::vector matrix, so that the row-wise helpers work on it in place. */
+        template<typename RET_TYPE>
+        void rowPointers(std::vector<std::vector<RET_TYPE> > &m,std::vector<RET_TYPE*> &rows) {
+            rows.resize(m.size());
+            for(size_t i=0;i<m.size();i++)
+                rows[i]=m[i].data();
+        }
+
+        /** @brief Read-only version of rowPointers. */
+        template<typename RET_TYPE>
+        void rowPointers(const std::vector<std::vector<RET_TYPE> > &m,std::vector<const RET_TYPE*> &rows) {
+            rows.resize(m.size());
+            for(size_t i=0;i<m.size();i++)
+                rows[i]=m[i].data();
+        }
+
+        /** @brief Reciprocal square roots of the diagonal `d` of a kernel matrix. */
+        template<typename RET_TYPE>
+        void rsqrtDiagonal(const std::vector<RET_TYPE> &d,std::vector<RET_TYPE> &r) {
+            r.resize(d.size());
+            for(size_t i=0;i<d.size();i++)
+                r[i]=RET_TYPE(1/std::sqrt(d[i]));
+        }
+
+        /** @brief Runs `f(i0,i1,j0,j1,tid)` for all the square blocks \f$ [i_0,i_1) \times [j_0,j_1) \f$ of size B which intersect the lower triangle of an \f$ N \times N \f$ matrix, concurrently, where `tid` identifies the executing thread (see parallelFor). */
+        template<typename F>
+        void lowerBlocks(size_t N,size_t B,F f) {
+            size_t NB=(N+B-1)/B;
+            parallelFor(NB*(NB+1)/2,[&](size_t t,size_t tid) {
+                size_t bi=size_t((std::sqrt(8.0*t+1)-1)/2);
+                while(bi*(bi+1)/2>t)
+                    bi--;
+                while((bi+1)*(bi+2)/2<=t)
+                    bi++;
+                size_t bj=t-bi*(bi+1)/2;
+                f(bi*B,std::min(bi*B+B,N),bj*B,std::min(bj*B+B,N),tid);
+            });
+        }
+    }
+
+    inline size_t numThreads() {
+        if(detail::threadSetting()>0)
+            return detail::threadSetting();
+        size_t n=std::thread::hardware_concurrency();
+        return n>0?n:1;
+    }
+
+    inline void setNumThreads(size_t n) {
+        detail::threadSetting()=n;
+    }
+
+    namespace detail {
+
+        /** @brief Calls `sk.prepare(xlist)`, selected when the kernel class provides such a method. */
+        template<typename SK,typename DATA_TYPE>
+        auto prepareImpl(SK &sk,const std::vector<DATA_TYPE> &xlist,int) -> decltype(sk.prepare(xlist),void()) {
+            sk.prepare(xlist);
+        }
+
+        /** @brief Does nothing, selected when the kernel class does not provide a prepare method. */
+        template<typename SK,typename DATA_TYPE>
+        void prepareImpl(SK &sk,const std::vector<DATA_TYPE> &xlist,long) {
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE>
+    void prepare(SK &sk,const std::vector<DATA_TYPE> &xlist) {
+        detail::prepareImpl(sk,xlist,0);
+    }
+
+    namespace detail {
+
+        /** @brief Calls `sk.release(xlist)`, selected when the kernel class provides such a method. */
+        template<typename SK,typename DATA_TYPE>
+        auto releaseImpl(SK &sk,const std::vector<DATA_TYPE> &xlist,int) -> decltype(sk.release(xlist),void()) {
+            sk.release(xlist);
+        }
+
+        /** @brief Does nothing, selected when the kernel class does not provide a release method. */
+        template<typename SK,typename DATA_TYPE>
+        void releaseImpl(SK &sk,const std::vector<DATA_TYPE> &xlist,long) {
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE>
+    void release(SK &sk,const std::vector<DATA_TYPE> &xlist) {
+        detail::releaseImpl(sk,xlist,0);
+    }
+
+    namespace detail {
+
+        /** @brief Normalizes in place the N×N kernel matrix nkm, given by its rows: a MatrixView, or a std::vector of row pointers (see rowPointers). */
+        template<typename RET_TYPE,typename ROWS>
+        void kern2normRows(const ROWS &nkm,size_t N) {
+            std::vector<RET_TYPE> d(N),r;
+            for(size_t i=0;i<N;i++)
+                d[i]=nkm[i][i];
+            rsqrtDiagonal(d,r);
+            lowerBlocks(N,64,[&](size_t i0,size_t i1,size_t j0,size_t j1,size_t) {
+                for(size_t i=std::max(i0,j0+1);i<i1;i++) {
+                    size_t n=std::min(i,j1)-j0;
+                    scaleRow(nkm[i]+j0,&r[j0],r[i],n);
+                    for(size_t j=j0;j<j0+n;j++)
+                        nkm[j][i]=nkm[i][j];
+                }
+            });
+            for(size_t i=0;i<N;i++)
+                if(d[i]!=RET_TYPE(0))
+                    nkm[i][i]=RET_TYPE(1);
+        }
+    }
+
+    template<typename RET_TYPE>
+    void kern2norm(const MatrixView<RET_TYPE> &nkm) {
+        if(!isSquare(nkm))
+            throw "Kernel matrix is not square.";
+        detail::kern2normRows<RET_TYPE>(nkm,nkm.rows());
+    }
+
+    template<typename RET_TYPE>
+    void kern2norm(std::vector<std::vector<RET_TYPE> > &nkm) {
+        if(!isSquare(nkm))
+            throw "Kernel matrix is not square.";
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(nkm,rows);
+        detail::kern2normRows<RET_TYPE>(rows,nkm.size());
+    }
+
+    template<typename RET_TYPE>
+    void kern2norm(PackedMatrix<RET_TYPE> &nkm) {
+        const size_t B=64;
+        size_t N=nkm.size();
+        std::vector<RET_TYPE> d(N),r;
+        for(size_t i=0;i<N;i++)
+            d[i]=nkm(i,i);
+        detail::rsqrtDiagonal(d,r);
+        detail::parallelFor((N+B-1)/B,[&](size_t t,size_t) {
+            for(size_t i=t*B;i<std::min(t*B+B,N);i++)
+                detail::scaleRow(nkm.row(i),&r[0],r[i],i);
+        });
+        for(size_t i=0;i<N;i++)
+            if(d[i]!=RET_TYPE(0))
+                nkm(i,i)=RET_TYPE(1);
+    }
+
+    namespace detail {
+
+        /** @brief Evaluates the self-kernels of `xlist`, exploiting the KernelTraits of `sk`. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void selfKernels(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &kv) {
+            if(KernelTraits<SK>::unitDiagonal)
+                kv.assign(xlist.size(),RET_TYPE(1));
+            else if(KernelTraits<SK>::stationary&&!xlist.empty()) {
+                RET_TYPE k;
+                sk(xlist[0],k);
+                kv.assign(xlist.size(),k);
+            }
+            else
+                sk(xlist,kv);
+        }
+
+        /** @brief Square root of a squared distance, clamping negative rounding residues to 0 for positive semi-definite kernels. */
+        template<typename SK,typename RET_TYPE>
+        RET_TYPE sqrtDist(RET_TYPE d2) {
+            if(KernelTraits<SK>::positive&&d2<RET_TYPE(0))
+                return RET_TYPE(0);
+            return RET_TYPE(std::sqrt(d2));
+        }
+
+        /** @brief Row i of a matrix, of which the fused evaluations and ktools::extend may only write the lower part (columns 0 to i). */
+        template<typename RET_TYPE>
+        RET_TYPE* lowerRow(Matrix<RET_TYPE> &m,size_t i) {
+            return m[i];
+        }
+
+        /** @brief Row i of a matrix given by its row pointers (see rowPointers). */
+        template<typename RET_TYPE>
+        RET_TYPE* lowerRow(std::vector<RET_TYPE*> &m,size_t i) {
+            return m[i];
+        }
+
+        /** @brief Row i of a packed symmetric matrix. */
+        template<typename RET_TYPE>
+        RET_TYPE* lowerRow(PackedMatrix<RET_TYPE> &m,size_t i) {
+            return m.row(i);
+        }
+
+        /** @brief Number of rows of a square matrix. */
+        template<typename RET_TYPE>
+        size_t squareSize(const Matrix<RET_TYPE> &m) {
+            if(!isSquare(m.view()))
+                throw "Kernel matrix is not square.";
+            return m.rows();
+        }
+
+        /** @brief Number of rows of a packed symmetric matrix. */
+        template<typename RET_TYPE>
+        size_t squareSize(const PackedMatrix<RET_TYPE> &m) {
+            return m.size();
+        }
+
+        /** @brief Copies the lower triangle of rows \f$ [N0,N) \f$ onto the upper triangle. */
+        template<typename RET_TYPE>
+        void mirrorRows(Matrix<RET_TYPE> &m,size_t N0) {
+            for(size_t i=N0;i<m.rows();i++)
+                for(size_t j=0;j<i;j++)
+                    m[j][i]=m[i][j];
+        }
+
+        /** @brief Nothing to do, packed symmetric matrices only store the lower triangle. */
+        template<typename RET_TYPE>
+        void mirrorRows(PackedMatrix<RET_TYPE>&,size_t) {
+        }
+
+        /** @brief Resizes a square matrix into \f$ N \times N \f$ for ktools::extend, with its capacity grown geometrically (by half) when exceeded, so that repeated extensions reallocate and copy it only a logarithmic number of times. */
+        template<typename RET_TYPE>
+        void growMat(Matrix<RET_TYPE> &m,size_t N) {
+            if(N>m.capacity()||Matrix<RET_TYPE>::leading(N)>m.ld()) {
+                size_t G=std::max(N,m.rows()+m.rows()/2);
+                m.reserve(G,G);
+            }
+            m.resize(N,N);
+        }
+
+        /** @brief Resizes a packed symmetric matrix into \f$ N \times N \f$ for ktools::extend, whose storage (a std::vector) grows geometrically already. */
+        template<typename RET_TYPE>
+        void growMat(PackedMatrix<RET_TYPE> &m,size_t N) {
+            m.resize(N);
+        }
+
+        /** @brief Evaluates the block \f$ [i_0,i_1) \times [j_0,j_1) \f$ of the kernel matrix on `xlist` and `ylist` into `t`, through the list overloads of `sk`.
+         *
+         *  The inputs of the block are copied into `xb` and `yb`, which are reused from block to block, and released (see ktools::release) once evaluated.
+         *  With `self`, diagonal blocks (\f$ i_0 = j_0 \f$) are evaluated through the symmetric list overload.
+         */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void gramBlock(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,bool self,size_t i0,size_t i1,size_t j0,size_t j1,std::vector<DATA_TYPE> &xb,std::vector<DATA_TYPE> &yb,Matrix<RET_TYPE> &t) {
+            bool diagonal=self&&i0==j0;
+            xb.assign(xlist.begin()+i0,xlist.begin()+i1);
+            if(!diagonal)
+                yb.assign(ylist.begin()+j0,ylist.begin()+j1);
+            try {
+                if(diagonal)
+                    sk(xb,t);
+                else
+                    sk(xb,yb,t);
+            }
+            catch(...) {
+                release(sk,xb);
+                if(!diagonal)
+                    release(sk,yb);
+                throw;
+            }
+            release(sk,xb);
+            if(!diagonal)
+                release(sk,yb);
+        }
+
+        /** @brief Runs `f(i0,j0,t)` on each block `t` of size B of the lower triangle of the kernel matrix on `xlist` (see gramBlock), concurrently, while the block is in cache. */
+        template<typename RET_TYPE,typename SK,typename DATA_TYPE,typename F>
+        void lowerGramBlocks(SK &sk,const std::vector<DATA_TYPE> &xlist,size_t B,F f) {
+            size_t T=numThreads();
+            std::vector<std::vector<DATA_TYPE> > xb(T),yb(T);
+            std::vector<Matrix<RET_TYPE> > t(T);
+            prepare(sk,xlist);
+            lowerBlocks(xlist.size(),B,[&](size_t i0,size_t i1,size_t j0,size_t j1,size_t tid) {
+                gramBlock(sk,xlist,xlist,true,i0,i1,j0,j1,xb[tid],yb[tid],t[tid]);
+                f(i0,j0,t[tid]);
+            });
+        }
+
+        /** @brief Runs `f(i0,j0,t)` on each block `t` of size B of the kernel matrix on `xlist` and `ylist` (see gramBlock), concurrently, while the block is in cache. */
+        template<typename RET_TYPE,typename SK,typename DATA_TYPE,typename F>
+        void crossGramBlocks(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,size_t B,F f) {
+            size_t T=numThreads();
+            size_t NBJ=(ylist.size()+B-1)/B;
+            std::vector<std::vector<DATA_TYPE> > xb(T),yb(T);
+            std::vector<Matrix<RET_TYPE> > t(T);
+            prepare(sk,xlist);
+            if(&xlist!=&ylist)
+                prepare(sk,ylist);
+            parallelFor((xlist.size()+B-1)/B*NBJ,[&](size_t b,size_t tid) {
+                size_t i0=b/NBJ*B,j0=b%NBJ*B;
+                gramBlock(sk,xlist,ylist,false,i0,std::min(i0+B,xlist.size()),j0,std::min(j0+B,ylist.size()),xb[tid],yb[tid],t[tid]);
+                f(i0,j0,t[tid]);
+            });
+        }
+
+        /** @brief Turns a row of kernel values into distances, as distRow, with negative squared distances handled as in sqrtDist. */
+        template<typename SK,typename RET_TYPE>
+        void distRow(RET_TYPE *k,const RET_TYPE *d,RET_TYPE a,size_t n) {
+            if(KernelTraits<SK>::positive) {
+                distRow(k,d,a,n);
+                return;
+            }
+            for(size_t j=0;j<n;j++)
+                k[j]=sqrtDist<SK>(a+d[j]-2*k[j]);
+        }
+
+        /** @brief Normalizes a row of kernel values, \f$ k_j \leftarrow k_j / \sqrt{a d_j} \f$, leaving zero values untouched.
+         *
+         *  For positive semi-definite kernels, this is scaleRow on the reciprocal square roots `ra` and `rd` of `a` and `d`.
+         *  Other kernels may have negative self-kernels, hence the product is formed first.
+         */
+        template<typename SK,typename RET_TYPE>
+        void normRow(RET_TYPE *k,const RET_TYPE *d,const RET_TYPE *rd,RET_TYPE a,RET_TYPE ra,size_t n) {
+            if(KernelTraits<SK>::positive) {
+                scaleRow(k,rd,ra,n);
+                return;
+            }
+            for(size_t j=0;j<n;j++)
+                if(k[j]!=RET_TYPE(0))
+                    k[j]/=std::sqrt(a*d[j]);
+        }
+
+        /** @brief Fused evaluation of the normalized kernel matrix on `xlist`, given the self-kernels `kv`, into the lower triangle of `nkm` (see lowerRow), and into its upper triangle as well with `mirror`.
+         *
+         *  Blocks of the kernel matrix are evaluated concurrently (see lowerGramBlocks), and normalized while they are in cache.
+         */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE,typename M>
+        void normLower(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,M &nkm,bool mirror) {
+            std::vector<RET_TYPE> r;
+            rsqrtDiagonal(kv,r);
+            lowerGramBlocks<RET_TYPE>(sk,xlist,64,[&](size_t i0,size_t j0,Matrix<RET_TYPE> &t) {
+                for(size_t a=0;a<t.rows();a++) {
+                    size_t i=i0+a;
+                    size_t n=std::min(t.cols(),i-j0);
+                    normRow<SK>(t[a],&kv[j0],&r[j0],kv[i],r[i],n);
+                    std::copy(t[a],t[a]+n,lowerRow(nkm,i)+j0);
+                    if(mirror)
+                        for(size_t j=0;j<n;j++)
+                            lowerRow(nkm,j0+j)[i]=t[a][j];
+                }
+            });
+            for(size_t i=0;i<xlist.size();i++)
+                lowerRow(nkm,i)[i]=kv[i]!=RET_TYPE(0)?RET_TYPE(1):RET_TYPE(0);
+        }
+
+        /** @brief Fused evaluation of the distance matrix on `xlist`, given the self-kernels `kv`, as normLower. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE,typename M>
+        void distLower(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,M &dm,bool mirror) {
+            lowerGramBlocks<RET_TYPE>(sk,xlist,64,[&](size_t i0,size_t j0,Matrix<RET_TYPE> &t) {
+                for(size_t a=0;a<t.rows();a++) {
+                    size_t i=i0+a;
+                    size_t n=std::min(t.cols(),i-j0);
+                    distRow<SK>(t[a],&kv[j0],kv[i],n);
+                    std::copy(t[a],t[a]+n,lowerRow(dm,i)+j0);
+                    if(mirror)
+                        for(size_t j=0;j<n;j++)
+                            lowerRow(dm,j0+j)[i]=t[a][j];
+                }
+            });
+            for(size_t i=0;i<xlist.size();i++)
+                lowerRow(dm,i)[i]=RET_TYPE(0);
+        }
+
+        /** @brief Checks the inputs of a fused evaluation on `xlist`. */
+        template<typename DATA_TYPE,typename RET_TYPE>
+        void checkSym(const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv) {
+            if(xlist.empty())
+                throw "Input set doesn't contain any element.";
+            if(kv.size()!=xlist.size())
+                throw "Self-kernel vector size does not match the input set size.";
+        }
+
+        /** @brief Fused evaluation of the normalized kernel matrix on `xlist`, given the self-kernels `kv`. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void normSym(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,Matrix<RET_TYPE> &nkm) {
+            checkSym(xlist,kv);
+            resizeMat(nkm,xlist.size());
+            normLower(sk,xlist,kv,nkm,true);
+        }
+
+        /** @brief Fused evaluation of the distance matrix on `xlist`, given the self-kernels `kv`. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void distSym(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,Matrix<RET_TYPE> &dm) {
+            checkSym(xlist,kv);
+            resizeMat(dm,xlist.size());
+            distLower(sk,xlist,kv,dm,true);
+        }
+
+        /** @brief Fused evaluation of the packed normalized kernel matrix on `xlist`, given the self-kernels `kv`. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void normSym(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,PackedMatrix<RET_TYPE> &nkm) {
+            checkSym(xlist,kv);
+            nkm.resize(xlist.size());
+            normLower(sk,xlist,kv,nkm,false);
+        }
+
+        /** @brief Fused evaluation of the packed distance matrix on `xlist`, given the self-kernels `kv`. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void distSym(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,PackedMatrix<RET_TYPE> &dm) {
+            checkSym(xlist,kv);
+            dm.resize(xlist.size());
+            distLower(sk,xlist,kv,dm,false);
+        }
+
+        /** @brief Fused evaluation of the nested std::vector normalized kernel matrix on `xlist`, given the self-kernels `kv`, in place. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void normSym(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,std::vector<std::vector<RET_TYPE> > &nkm) {
+            checkSym(xlist,kv);
+            resizeMat(nkm,xlist.size());
+            std::vector<RET_TYPE*> rows;
+            rowPointers(nkm,rows);
+            normLower(sk,xlist,kv,rows,true);
+        }
+
+        /** @brief Fused evaluation of the nested std::vector distance matrix on `xlist`, given the self-kernels `kv`, in place. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void distSym(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<RET_TYPE> &kv,std::vector<std::vector<RET_TYPE> > &dm) {
+            checkSym(xlist,kv);
+            resizeMat(dm,xlist.size());
+            std::vector<RET_TYPE*> rows;
+            rowPointers(dm,rows);
+            distLower(sk,xlist,kv,rows,true);
+        }
+
+        /** @brief Checks the inputs of a fused evaluation on `xlist` and `ylist`. */
+        template<typename DATA_TYPE,typename RET_TYPE>
+        void checkCross(const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv) {
+            if(xlist.empty()||ylist.empty())
+                throw "Input set doesn't contain any element.";
+            if(xkv.size()!=xlist.size()||ykv.size()!=ylist.size())
+                throw "Self-kernel vector size does not match the input set size.";
+        }
+
+        /** @brief Fused evaluation of the normalized kernel matrix on `xlist` and `ylist`, given the self-kernels `xkv` and `ykv`, into the rows of `nkm` (see lowerRow).
+         *
+         *  Blocks of the kernel matrix are evaluated concurrently (see crossGramBlocks), and normalized while they are in cache.
+         */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE,typename M>
+        void normCross(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,M &nkm) {
+            std::vector<RET_TYPE> xr,yr;
+            rsqrtDiagonal(xkv,xr);
+            rsqrtDiagonal(ykv,yr);
+            crossGramBlocks<RET_TYPE>(sk,xlist,ylist,64,[&](size_t i0,size_t j0,Matrix<RET_TYPE> &t) {
+                for(size_t a=0;a<t.rows();a++) {
+                    normRow<SK>(t[a],&ykv[j0],&yr[j0],xkv[i0+a],xr[i0+a],t.cols());
+                    std::copy(t[a],t[a]+t.cols(),lowerRow(nkm,i0+a)+j0);
+                }
+            });
+        }
+
+        /** @brief Fused evaluation of the distance matrix on `xlist` and `ylist`, given the self-kernels `xkv` and `ykv`, as normCross. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE,typename M>
+        void distCross(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,M &dm) {
+            crossGramBlocks<RET_TYPE>(sk,xlist,ylist,64,[&](size_t i0,size_t j0,Matrix<RET_TYPE> &t) {
+                for(size_t a=0;a<t.rows();a++) {
+                    distRow<SK>(t[a],&ykv[j0],xkv[i0+a],t.cols());
+                    std::copy(t[a],t[a]+t.cols(),lowerRow(dm,i0+a)+j0);
+                }
+            });
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const DATA_TYPE &x,const DATA_TYPE &y,RET_TYPE &nk) {
+        sk(x,y,nk);
+        if(KernelTraits<SK>::unitDiagonal)
+            return;
+        if(nk!=RET_TYPE(0)) {
+            RET_TYPE xk,yk;
+            sk(x,xk);
+            if(KernelTraits<SK>::stationary)
+                yk=xk;
+            else
+                sk(y,yk);
+            nk/=std::sqrt(xk*yk);
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const DATA_TYPE &x,RET_TYPE &nk) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            nk=RET_TYPE(1);
+            return;
+        }
+        sk(x,nk);
+        if(nk!=RET_TYPE(0))
+            nk=RET_TYPE(1);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &nkm) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            sk(xlist,ylist,nkm);
+            return;
+        }
+        std::vector<RET_TYPE> xkv,ykv;
+        detail::selfKernels(sk,xlist,xkv);
+        if(&xlist==&ylist)
+            ykv=xkv;
+        else
+            detail::selfKernels(sk,ylist,ykv);
+        norm(sk,xlist,ylist,xkv,ykv,nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &nkm) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            sk(xlist,ylist,nkm);
+            return;
+        }
+        std::vector<RET_TYPE> xkv,ykv;
+        detail::selfKernels(sk,xlist,xkv);
+        if(&xlist==&ylist)
+            ykv=xkv;
+        else
+            detail::selfKernels(sk,ylist,ykv);
+        norm(sk,xlist,ylist,xkv,ykv,nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,Matrix<RET_TYPE> &nkm) {
+        detail::checkCross(xlist,ylist,xkv,ykv);
+        resizeMat(nkm,xlist.size(),ylist.size());
+        detail::normCross(sk,xlist,ylist,xkv,ykv,nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,std::vector<std::vector<RET_TYPE> > &nkm) {
+        detail::checkCross(xlist,ylist,xkv,ykv);
+        resizeMat(nkm,xlist.size(),ylist.size());
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(nkm,rows);
+        detail::normCross(sk,xlist,ylist,xkv,ykv,rows);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &nkm) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            sk(xlist,nkm);
+            return;
+        }
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::normSym(sk,xlist,kv,nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &nkm) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            sk(xlist,nkm);
+            return;
+        }
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::normSym(sk,xlist,kv,nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &nkm) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            sk(xlist,nkm);
+            return;
+        }
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::normSym(sk,xlist,kv,nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &nkv) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            nkv.assign(xlist.size(),RET_TYPE(1));
+            return;
+        }
+        sk(xlist,nkv);
+        for(size_t i=0;i<nkv.size();i++)
+            if(nkv[i]!=RET_TYPE(0))
+                nkv[i]=RET_TYPE(1);
+    }
+
+    namespace detail {
+
+        /** @brief Turns in place the N×N kernel matrix dm into a distance matrix, given by its rows as in kern2normRows. */
+        template<typename RET_TYPE,typename ROWS>
+        void kern2distRows(const ROWS &dm,size_t N) {
+            const size_t B=64;
+            std::vector<RET_TYPE> d(N);
+            for(size_t i=0;i<N;i++)
+                d[i]=dm[i][i];
+            lowerBlocks(N,B,[&](size_t i0,size_t i1,size_t j0,size_t j1,size_t) {
+                RET_TYPE s[B];
+                for(size_t i=std::max(i0,j0+1);i<i1;i++) {
+                    size_t n=std::min(i,j1)-j0;
+                    // symmetrized value, so that d[i]+d[j]-2s = k(i,i)+k(j,j)-k(i,j)-k(j,i)
+                    for(size_t j=0;j<n;j++)
+                        s[j]=(dm[i][j0+j]+dm[j0+j][i])/2;
+                    distRow(s,&d[j0],d[i],n);
+                    for(size_t j=0;j<n;j++)
+                        dm[i][j0+j]=dm[j0+j][i]=s[j];
+                }
+            });
+            for(size_t i=0;i<N;i++)
+                dm[i][i]=RET_TYPE(0);
+        }
+    }
+
+    template<typename RET_TYPE>
+    void kern2dist(const MatrixView<RET_TYPE> &dm) {
+        if(!isSquare(dm))
+            throw "Kernel matrix is not square.";
+        detail::kern2distRows<RET_TYPE>(dm,dm.rows());
+    }
+
+    template<typename RET_TYPE>
+    void kern2dist(std::vector<std::vector<RET_TYPE> > &dm) {
+        if(!isSquare(dm))
+            throw "Kernel matrix is not square.";
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(dm,rows);
+        detail::kern2distRows<RET_TYPE>(rows,dm.size());
+    }
+
+    template<typename RET_TYPE>
+    void kern2dist(PackedMatrix<RET_TYPE> &dm) {
+        const size_t B=64;
+        size_t N=dm.size();
+        std::vector<RET_TYPE> d(N);
+        for(size_t i=0;i<N;i++)
+            d[i]=dm(i,i);
+        detail::parallelFor((N+B-1)/B,[&](size_t t,size_t) {
+            for(size_t i=t*B;i<std::min(t*B+B,N);i++)
+                detail::distRow(dm.row(i),&d[0],d[i],i);
+        });
+        for(size_t i=0;i<N;i++)
+            dm(i,i)=RET_TYPE(0);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const DATA_TYPE &x,const DATA_TYPE &y,RET_TYPE &d) {
+        RET_TYPE xk,yk;
+        sk(x,y,d);
+        if(KernelTraits<SK>::unitDiagonal)
+            xk=yk=RET_TYPE(1);
+        else {
+            sk(x,xk);
+            if(KernelTraits<SK>::stationary)
+                yk=xk;
+            else
+                sk(y,yk);
+        }
+        d=detail::sqrtDist<SK>(xk+yk-2*d);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const DATA_TYPE &x,RET_TYPE &d) {
+        d=RET_TYPE(0);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &dm) {
+        std::vector<RET_TYPE> xkv,ykv;
+        detail::selfKernels(sk,xlist,xkv);
+        if(&xlist==&ylist)
+            ykv=xkv;
+        else
+            detail::selfKernels(sk,ylist,ykv);
+        dist(sk,xlist,ylist,xkv,ykv,dm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &dm) {
+        std::vector<RET_TYPE> xkv,ykv;
+        detail::selfKernels(sk,xlist,xkv);
+        if(&xlist==&ylist)
+            ykv=xkv;
+        else
+            detail::selfKernels(sk,ylist,ykv);
+        dist(sk,xlist,ylist,xkv,ykv,dm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,Matrix<RET_TYPE> &dm) {
+        detail::checkCross(xlist,ylist,xkv,ykv);
+        resizeMat(dm,xlist.size(),ylist.size());
+        detail::distCross(sk,xlist,ylist,xkv,ykv,dm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,std::vector<std::vector<RET_TYPE> > &dm) {
+        detail::checkCross(xlist,ylist,xkv,ykv);
+        resizeMat(dm,xlist.size(),ylist.size());
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(dm,rows);
+        detail::distCross(sk,xlist,ylist,xkv,ykv,rows);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &dm) {
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::distSym(sk,xlist,kv,dm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &dm) {
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::distSym(sk,xlist,kv,dm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &dm) {
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::distSym(sk,xlist,kv,dm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &dv) {
+        dv.assign(xlist.size(),RET_TYPE(0));
+    }
+
+    namespace detail {
+
+        /** @brief Row means of an NR×NC matrix, computed in parallel over blocks of rows.
+         *
+         *  `rows[i]` is a pointer to the i-th row: `rows` is either a MatrixView or a std::vector of row pointers (e.g. into nested std::vector matrices).
+         */
+        template<typename ROWS>
+        void rowMeans(const ROWS &rows,size_t NR,size_t NC,std::vector<double> &means) {
+            const size_t B=64;
+            means.resize(NR);
+            parallelFor((NR+B-1)/B,[&](size_t t,size_t) {
+                for(size_t i=t*B;i<std::min(t*B+B,NR);i++) {
+                    double sum=0;
+                    for(size_t j=0;j<NC;j++)
+                        sum+=rows[i][j];
+                    means[i]=sum/NC;
+                }
+            });
+        }
+
+        /** @brief \f$ M_{ij} \leftarrow M_{ij} - (r_i + c_j) + g \f$, on an NR×NC matrix given by its rows (as in rowMeans), in parallel over blocks of rows.
+         *
+         *  The sum \f$ r_i + c_j \f$ is formed first, so that a symmetric matrix stays exactly symmetric when \f$ r = c \f$.
+         */
+        template<typename ROWS>
+        void centerRows(const ROWS &rows,size_t NR,size_t NC,const std::vector<double> &r,const std::vector<double> &c,double g) {
+            const size_t B=64;
+            parallelFor((NR+B-1)/B,[&](size_t t,size_t) {
+                for(size_t i=t*B;i<std::min(t*B+B,NR);i++) {
+                    auto mi=rows[i];
+                    double ri=r[i];
+                    for(size_t j=0;j<NC;j++)
+                        mi[j]=mi[j]-(ri+c[j])+g;
+                }
+            });
+        }
+
+        /** @brief Centers in place a non-empty N×N matrix given by its rows (as in rowMeans), see ktools::center. */
+        template<typename ROWS>
+        void centerSquare(const ROWS &rows,size_t N,CenterStats &stats) {
+            rowMeans(rows,N,N,stats.means);
+            stats.grandMean=0;
+            for(size_t i=0;i<N;i++)
+                stats.grandMean+=stats.means[i];
+            stats.grandMean/=N;
+            centerRows(rows,N,N,stats.means,stats.means,stats.grandMean);
+        }
+    }
+
+    template<typename RET_TYPE>
+    void center(const MatrixView<RET_TYPE> &km) {
+        CenterStats stats;
+        center(km,stats);
+    }
+
+    template<typename RET_TYPE>
+    void center(const MatrixView<RET_TYPE> &km,CenterStats &stats) {
+        if(!isSquare(km))
+            throw "Kernel matrix is not square.";
+        if(km.rows()==0)
+            throw "Kernel matrix is empty.";
+        detail::centerSquare(km,km.rows(),stats);
+    }
+
+    template<typename RET_TYPE>
+    void center(std::vector<std::vector<RET_TYPE> > &km) {
+        CenterStats stats;
+        center(km,stats);
+    }
+
+    template<typename RET_TYPE>
+    void center(std::vector<std::vector<RET_TYPE> > &km,CenterStats &stats) {
+        if(!isSquare(km))
+            throw "Kernel matrix is not square.";
+        if(km.size()==0)
+            throw "Kernel matrix is empty.";
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(km,rows);
+        detail::centerSquare(rows,km.size(),stats);
+    }
+
+    template<typename RET_TYPE>
+    void centerTest(const MatrixView<RET_TYPE> &kt,const CenterStats &stats) {
+        if(kt.cols()!=stats.means.size())
+            throw "Test kernel matrix size does not match the training set size.";
+        if(kt.cols()==0)
+            return;
+        std::vector<double> r;
+        detail::rowMeans(kt,kt.rows(),kt.cols(),r);
+        detail::centerRows(kt,kt.rows(),kt.cols(),r,stats.means,stats.grandMean);
+    }
+
+    template<typename RET_TYPE>
+    void centerTest(std::vector<std::vector<RET_TYPE> > &kt,const CenterStats &stats) {
+        size_t NR=kt.size();
+        size_t NC=NR>0?kt[0].size():0;
+        for(size_t i=0;i<NR;i++)
+            if(kt[i].size()!=NC)
+                throw "Input matrix is not rectangular.";
+        if(NC!=stats.means.size())
+            throw "Test kernel matrix size does not match the training set size.";
+        if(NC==0)
+            return;
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(kt,rows);
+        std::vector<double> r;
+        detail::rowMeans(rows,NR,NC,r);
+        detail::centerRows(rows,NR,NC,r,stats.means,stats.grandMean);
+    }
+
+    template<typename RET_TYPE>
+    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t NR,size_t NC) {
+        m.resize(NR);
+        for(size_t i=0;i<NR;i++)
+            m[i].resize(NC);
+    }
+
+    template<typename RET_TYPE>
+    void resizeMat(std::vector<std::vector<RET_TYPE> > &m,size_t N) {
+        resizeMat(m,N,N);
+    }
+
+    template<typename RET_TYPE>
+    void resizeMat(Matrix<RET_TYPE> &m,size_t NR,size_t NC) {
+        m.resize(NR,NC);
+    }
+
+    template<typename RET_TYPE>
+    void resizeMat(Matrix<RET_TYPE> &m,size_t N) {
+        m.resize(N,N);
+    }
+
+    template<typename RET_TYPE>
+    void resizeMat(PackedMatrix<RET_TYPE> &m,size_t N) {
+        m.resize(N);
+    }
+
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const std::vector<std::vector<SRC_TYPE> > &src,Matrix<RET_TYPE> &dst) {
+        size_t NR=src.size();
+        size_t NC=NR>0?src[0].size():0;
+        for(size_t i=0;i<NR;i++)
+            if(src[i].size()!=NC)
+                throw "Input matrix is not rectangular.";
+        dst.resize(NR,NC);
+        for(size_t i=0;i<NR;i++)
+            for(size_t j=0;j<NC;j++)
+                dst[i][j]=RET_TYPE(src[i][j]);
+    }
+
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const MatrixView<SRC_TYPE> &src,std::vector<std::vector<RET_TYPE> > &dst) {
+        resizeMat(dst,src.rows(),src.cols());
+        for(size_t i=0;i<src.rows();i++)
+            for(size_t j=0;j<src.cols();j++)
+                dst[i][j]=RET_TYPE(src[i][j]);
+    }
+
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const MatrixView<SRC_TYPE> &src,Matrix<RET_TYPE> &dst) {
+        dst.resize(src.rows(),src.cols());
+        for(size_t i=0;i<src.rows();i++)
+            for(size_t j=0;j<src.cols();j++)
+                dst[i][j]=RET_TYPE(src[i][j]);
+    }
+
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const PackedMatrix<SRC_TYPE> &src,Matrix<RET_TYPE> &dst) {
+        dst.resize(src.size(),src.size());
+        for(size_t i=0;i<src.size();i++) {
+            const SRC_TYPE *ri=src.row(i);
+            for(size_t j=0;j<=i;j++)
+                dst[i][j]=dst[j][i]=RET_TYPE(ri[j]);
+        }
+    }
+
+    template<typename SRC_TYPE,typename RET_TYPE>
+    void copyMat(const MatrixView<SRC_TYPE> &src,PackedMatrix<RET_TYPE> &dst) {
+        if(!isSquare(src))
+            throw "Input matrix is not square.";
+        dst.resize(src.rows());
+        for(size_t i=0;i<src.rows();i++) {
+            RET_TYPE *ri=dst.row(i);
+            for(size_t j=0;j<=i;j++)
+                ri[j]=RET_TYPE(src[i][j]);
+        }
+    }
+
+    template<typename RET_TYPE>
     bool isSquare(const std::vector<std::vector<RET_TYPE> > &m) {
         size_t N=m.size();
         for(size_t i=0;i<N;i++)
@@ -412,41 +2410,1426 @@ namespace ktools {
                 return false;
         return true;
     }
-    
+
+    template<typename RET_TYPE>
+    bool isSquare(const MatrixView<RET_TYPE> &m) {
+        return m.rows()==m.cols();
+    }
+    
+    namespace detail {
+
+        /** @brief Whether the N×N matrix m is symmetric, with m either a MatrixView or a nested std::vector matrix. */
+        template<typename M>
+        bool symmetric(const M &m,size_t N) {
+            for(size_t i=0;i<N;i++)
+                for(size_t j=0;j<i;j++)
+                    if(m[i][j]!=m[j][i])
+                        return false;
+            return true;
+        }
+
+        /** @brief Whether the N×N symmetric matrix km (as in symmetric) respects the Cauchy-Schwarz inequality. */
+        template<typename M>
+        bool cauchySchwarz(const M &km,size_t N) {
+            for(size_t i=0;i<N;i++)
+                for(size_t j=0;j<i;j++)
+                    if(km[i][j]*km[i][j]>km[i][i]*km[j][j])
+                        return false;
+            return true;
+        }
+    }
+
+    template<typename RET_TYPE>
+    bool isSymmetric(const std::vector<std::vector<RET_TYPE> > &m) {
+        if(!isSquare(m))
+            return false;
+        return detail::symmetric(m,m.size());
+    }
+
     template<typename RET_TYPE>
-    bool isSymmetric(const std::vector<std::vector<RET_TYPE> > &m) {
+    bool isSymmetric(const MatrixView<RET_TYPE> &m) {
         if(!isSquare(m))
             return false;
-        size_t N=m.size();
-        for(size_t i=0;i<N;i++)
-            for(size_t j=0;j<i;j++)
-                if(m[i][j]!=m[j][i])
-                    return false;
-        return true;
+        return detail::symmetric(m,m.rows());
+    }
+
+    namespace detail {
+
+        /** @brief Blocked min-plus check of the triangle inequality on the N×N symmetric matrix dm.
+         *
+         *  `dm[i]` is a pointer to the i-th row: `dm` is either a MatrixView or a std::vector of row pointers (see rowPointers).
+         */
+        template<typename VAL_TYPE,typename ROWS>
+        bool triangleInequality(const ROWS &dm,size_t N) {
+            // Tile sizes: a BI x BJ tile of the min-plus product is accumulated over BK rows of dm at a time.
+            const size_t BI=64,BJ=256,BK=128;
+            size_t NBI=(N+BI-1)/BI;
+            size_t NBJ=(N+BJ-1)/BJ;
+            std::atomic<bool> violated(false);
+            parallelFor(NBI*NBJ,[&](size_t t,size_t) {
+                size_t i0=t/NBJ*BI,i1=std::min(i0+BI,N);
+                size_t j0=t%NBJ*BJ,j1=std::min(j0+BJ,N);
+                size_t nj=j1-j0;
+                Matrix<VAL_TYPE> mp(i1-i0,nj);
+                for(size_t i=i0;i<i1;i++)
+                    std::copy(dm[i]+j0,dm[i]+j1,mp[i-i0]);
+                for(size_t k0=0;k0<N&&!violated;k0+=BK) {
+                    size_t k1=std::min(k0+BK,N);
+                    for(size_t i=i0;i<i1;i++) {
+                        VAL_TYPE *mpi=mp[i-i0];
+                        for(size_t k=k0;k<k1;k++) {
+                            const VAL_TYPE dik=dm[i][k];
+                            const VAL_TYPE *dkj=dm[k]+j0;
+                            minPlusRow(dik,dkj,mpi,nj);
+                        }
+                    }
+                    // mp only decreases, hence any violation found so far is final
+                    bool found=false;
+                    for(size_t i=i0;i<i1;i++)
+                        for(size_t j=0;j<nj;j++)
+                            found|=dm[i][j0+j]>mp[i-i0][j];
+                    if(found)
+                        violated=true;
+                }
+            });
+            return !violated;
+        }
     }
 
     template<typename RET_TYPE>
     bool respectsTriangleInequality(const std::vector<std::vector<RET_TYPE> > &dm) {
         if(!isSymmetric(dm))
             return false;
-        size_t N=dm.size();
-        for(size_t i=0;i<N;i++)
-            for(size_t j=0;j<N;j++)
-                for(size_t k=0;k<N;k++)
-                    if(dm[i][j]>dm[i][k]+dm[k][j])
-                        return false;
-        return true;
+        std::vector<const RET_TYPE*> rows;
+        detail::rowPointers(dm,rows);
+        return detail::triangleInequality<RET_TYPE>(rows,dm.size());
+    }
+
+    template<typename RET_TYPE>
+    bool respectsTriangleInequality(const MatrixView<RET_TYPE> &dm) {
+        if(!isSymmetric(dm))
+            return false;
+        return detail::triangleInequality<typename std::remove_const<RET_TYPE>::type>(dm,dm.rows());
+    }
+
+    namespace detail {
+
+        /** @brief Sampled triangle inequality violation rate of the non-empty N×N matrix dm, given by its rows as in triangleInequality, see ktools::triangleViolationRate. */
+        template<typename ROWS>
+        double violationRate(const ROWS &dm,size_t N,double seconds,size_t &samples,uint64_t seed) {
+            // Number of triplets sampled in between two checks of the clock.
+            const size_t BATCH=4096;
+            std::chrono::steady_clock::time_point end=std::chrono::steady_clock::now()+std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+            size_t T=numThreads();
+            std::vector<size_t> ns(T,0),nv(T,0);
+            parallelFor(T,[&](size_t t,size_t) {
+                std::mt19937_64 rng(seed+t);
+                std::uniform_int_distribution<size_t> idx(0,N-1);
+                do {
+                    for(size_t b=0;b<BATCH;b++) {
+                        size_t i=idx(rng),j=idx(rng),k=idx(rng);
+                        nv[t]+=dm[i][j]>dm[i][k]+dm[k][j];
+                    }
+                    ns[t]+=BATCH;
+                } while(std::chrono::steady_clock::now()<end);
+            });
+            size_t violations=0;
+            samples=0;
+            for(size_t t=0;t<T;t++) {
+                samples+=ns[t];
+                violations+=nv[t];
+            }
+            return double(violations)/samples;
+        }
+    }
+
+    template<typename RET_TYPE>
+    double triangleViolationRate(const std::vector<std::vector<RET_TYPE> > &dm,double seconds,size_t &samples,uint64_t seed) {
+        if(!isSquare(dm))
+            throw "Distance matrix is not square.";
+        if(dm.empty())
+            throw "Distance matrix is empty.";
+        std::vector<const RET_TYPE*> rows;
+        detail::rowPointers(dm,rows);
+        return detail::violationRate(rows,dm.size(),seconds,samples,seed);
+    }
+
+    template<typename RET_TYPE>
+    double triangleViolationRate(const MatrixView<RET_TYPE> &dm,double seconds,size_t &samples,uint64_t seed) {
+        if(!isSquare(dm))
+            throw "Distance matrix is not square.";
+        if(dm.rows()==0)
+            throw "Distance matrix is empty.";
+        return detail::violationRate(dm,dm.rows(),seconds,samples,seed);
     }
 
     template<typename RET_TYPE>
     bool respectsCauchySchwarz(const std::vector<std::vector<RET_TYPE> > &km) {
         if(!isSymmetric(km))
             return false;
-        for(size_t i=0;i<km.size();i++)
-            for(size_t j=0;j<i;j++)
-                if(km[i][j]*km[i][j]>km[i][i]*km[j][j])
-                    return false;
-        return true;
+        return detail::cauchySchwarz(km,km.size());
+    }
+
+    template<typename RET_TYPE>
+    bool respectsCauchySchwarz(const MatrixView<RET_TYPE> &km) {
+        if(!isSymmetric(km))
+            return false;
+        return detail::cauchySchwarz(km,km.rows());
+    }
+
+    namespace detail {
+
+        /** @brief Eigenvalues (and optionally eigenvectors) of a symmetric tridiagonal matrix, through implicit QL iterations with Wilkinson shifts.
+         *
+         *  On input, `d` holds the diagonal and `e[i]` the element in between rows `i` and `i+1` (`e[N-1]` is ignored).
+         *  On output, `d` holds the eigenvalues. If `zt` is not null, its rows are rotated along, so that starting from the identity they end up holding the eigenvectors.
+         *  The rotations are recorded, and applied at the end to blocks of columns of `zt` in parallel.
+         */
+        inline void tridiagonalEigen(std::vector<double> &d,std::vector<double> &e,Matrix<double> *zt) {
+            // Width of the column blocks of zt rotated in parallel.
+            const size_t B=64;
+            size_t N=d.size();
+            if(N==0)
+                return;
+            e[N-1]=0;
+            // rows, cosines and sines of all the rotations, in order: zt is not read by the iterations, hence it is rotated at the end
+            std::vector<size_t> ri;
+            std::vector<double> rc,rs;
+            for(size_t l=0;l<N;l++) {
+                for(size_t iter=0;;iter++) {
+                    size_t m=l;
+                    for(;m+1<N;m++)
+                        if(std::fabs(e[m])<=std::numeric_limits<double>::epsilon()*(std::fabs(d[m])+std::fabs(d[m+1])))
+                            break;
+                    if(m==l)
+                        break;
+                    if(iter==60)
+                        throw "Eigenvalue iteration does not converge.";
+                    double g=(d[l+1]-d[l])/(2*e[l]);
+                    double r=std::hypot(g,1.0);
+                    g=d[m]-d[l]+e[l]/(g+(g>=0?r:-r));
+                    double s=1,c=1,p=0;
+                    bool deflated=false;
+                    for(size_t i=m;i-->l;) {
+                        double f=s*e[i],b=c*e[i];
+                        e[i+1]=r=std::hypot(f,g);
+                        if(r==0) {
+                            d[i+1]-=p;
+                            e[m]=0;
+                            deflated=true;
+                            break;
+                        }
+                        s=f/r;
+                        c=g/r;
+                        g=d[i+1]-p;
+                        r=(d[i]-g)*s+2*c*b;
+                        p=s*r;
+                        d[i+1]=g+p;
+                        g=c*r-b;
+                        if(zt) {
+                            ri.push_back(i);
+                            rc.push_back(c);
+                            rs.push_back(s);
+                        }
+                    }
+                    if(deflated)
+                        continue;
+                    d[l]-=p;
+                    e[l]=g;
+                    e[m]=0;
+                }
+            }
+            // each rotation acts on two rows, independently on each column
+            if(zt)
+                parallelFor((N+B-1)/B,[&](size_t t,size_t) {
+                    size_t k0=t*B,k1=std::min(k0+B,N);
+                    for(size_t q=0;q<ri.size();q++) {
+                        double *zi=(*zt)[ri[q]],*zj=(*zt)[ri[q]+1];
+                        for(size_t k=k0;k<k1;k++) {
+                            double zk=zj[k];
+                            zj[k]=rs[q]*zi[k]+rc[q]*zk;
+                            zi[k]=rc[q]*zi[k]-rs[q]*zk;
+                        }
+                    }
+                });
+        }
+
+        /** @brief Dot product of two contiguous arrays of n elements. */
+        template<typename A_TYPE,typename B_TYPE>
+        double dot(const A_TYPE *a,const B_TYPE *b,size_t n) {
+            double s=0;
+            for(size_t i=0;i<n;i++)
+                s+=double(a[i])*double(b[i]);
+            return s;
+        }
+
+        /** @brief Householder tridiagonalization of a symmetric matrix, \f$ A = Q T Q^T \f$ with \f$ Q = H_0 H_1 \cdots H_{N-3} \f$.
+         *
+         *  On output, `d` and `e` hold the diagonal and sub-diagonal of \f$ T \f$ (as expected by tridiagonalEigen), row `k` of `h` holds the vector \f$ u_k \f$ of \f$ H_k = I - 2 u_k u_k^T / |u_k|^2 \f$ (from column `k+1` on), and `hn[k]` holds \f$ |u_k|^2 \f$.
+         *  The matrix `a` is overwritten. The two products with the trailing block at each step (the product with \f$ u_k \f$ and the rank-2 update) run in parallel on blocks of rows.
+         */
+        inline void tridiagonalize(Matrix<double> &a,Matrix<double> &h,std::vector<double> &hn,std::vector<double> &d,std::vector<double> &e) {
+            // Rows of the trailing block per parallel task, so that small trailing blocks run serially.
+            const size_t B=32;
+            size_t N=a.rows();
+            h.resize(N,N);
+            hn.assign(N,0);
+            d.resize(N);
+            e.assign(N,0);
+            std::vector<double> pv(N);
+            for(size_t k=0;k+2<N;k++) {
+                size_t n=N-k-1;
+                double *u=h[k]+k+1;
+                for(size_t i=0;i<n;i++)
+                    u[i]=a[k+1+i][k];
+                double x=std::sqrt(dot(u,u,n));
+                double alpha=u[0]>0?-x:x;
+                e[k]=alpha;
+                u[0]-=alpha;
+                hn[k]=dot(u,u,n);
+                if(hn[k]==0) {
+                    e[k]=a[k+1][k];
+                    continue;
+                }
+                // p = 2 A u / |u|^2, q = p - (u.p / |u|^2) u, and A -= u q^T + q u^T on the trailing block
+                double *p=&pv[0];
+                size_t NB=(n+B-1)/B;
+                parallelFor(NB,[&](size_t t,size_t) {
+                    for(size_t i=t*B;i<std::min(t*B+B,n);i++)
+                        p[i]=2*dot(a[k+1+i]+k+1,u,n)/hn[k];
+                });
+                double c=dot(u,p,n)/hn[k];
+                for(size_t i=0;i<n;i++)
+                    p[i]-=c*u[i];
+                parallelFor(NB,[&](size_t t,size_t) {
+                    for(size_t i=t*B;i<std::min(t*B+B,n);i++) {
+                        double *ai=a[k+1+i]+k+1;
+                        for(size_t j=0;j<n;j++)
+                            ai[j]-=u[i]*p[j]+p[i]*u[j];
+                    }
+                });
+            }
+            for(size_t i=0;i<N;i++)
+                d[i]=a[i][i];
+            if(N>1)
+                e[N-2]=a[N-1][N-2];
+        }
+
+        /** @brief Computes \f$ z \leftarrow Q z \f$ in place, with \f$ Q \f$ as stored by tridiagonalize. */
+        inline void householderApply(const Matrix<double> &h,const std::vector<double> &hn,double *z) {
+            size_t N=h.rows();
+            for(size_t k=N>2?N-2:0;k-->0;) {
+                if(hn[k]==0)
+                    continue;
+                const double *u=h[k]+k+1;
+                double f=2*dot(u,z+k+1,N-k-1)/hn[k];
+                for(size_t i=0;i<N-k-1;i++)
+                    z[k+1+i]-=f*u[i];
+            }
+        }
+
+        /** @brief Parallel product \f$ y = K x \f$, with the N×N matrix K given by its rows as in triangleInequality. */
+        template<typename ROWS>
+        void symv(const ROWS &km,size_t N,const double *x,double *y) {
+            const size_t B=64;
+            parallelFor((N+B-1)/B,[&](size_t t,size_t) {
+                for(size_t i=t*B;i<std::min(t*B+B,N);i++)
+                    y[i]=dot(km[i],x,N);
+            });
+        }
+    }
+
+    namespace detail {
+
+        /** @brief Pivoted, panel-blocked Cholesky factorization of the symmetric matrix a, which it overwrites: true if it completes down to a residual of at most `tol` times the largest diagonal element. */
+        inline bool psdFactorization(Matrix<double> &a,double tol) {
+            // Panel width: number of columns factorized in between two trailing updates.
+            const size_t B=32;
+            size_t N=a.rows();
+            double thr=0;
+            for(size_t i=0;i<N;i++)
+                thr=std::max(thr,std::fabs(a[i][i]));
+            thr*=tol;
+            // d holds the diagonal of the current Schur complement, p the current panel of the factor (one row per row of a).
+            std::vector<double> d(N);
+            for(size_t i=0;i<N;i++)
+                d[i]=a[i][i];
+            Matrix<double> p(N,B);
+            size_t k=0;
+            for(size_t p0=0;p0<N;p0+=B) {
+                size_t p1=std::min(p0+B,N);
+                for(k=p0;k<p1;k++) {
+                    size_t q=std::max_element(d.begin()+k,d.end())-d.begin();
+                    if(d[q]<=thr)
+                        break;
+                    if(q!=k) {
+                        std::swap(d[k],d[q]);
+                        std::swap_ranges(a[k],a[k]+N,a[q]);
+                        for(size_t i=0;i<N;i++)
+                            std::swap(a[i][k],a[i][q]);
+                        std::swap_ranges(p[k],p[k]+B,p[q]);
+                    }
+                    double lkk=std::sqrt(d[k]);
+                    p[k][k-p0]=lkk;
+                    for(size_t i=k+1;i<N;i++) {
+                        p[i][k-p0]=(a[i][k]-dot(p[i],p[k],k-p0))/lkk;
+                        d[i]-=p[i][k-p0]*p[i][k-p0];
+                    }
+                }
+                // trailing update with the k-p0 panel columns actually computed
+                size_t nc=k-p0;
+                parallelFor(N-k,[&](size_t t,size_t) {
+                    size_t i=k+t;
+                    for(size_t j=k;j<N;j++)
+                        a[i][j]-=dot(p[i],p[j],nc);
+                    a[i][i]=d[i];
+                });
+                if(k<p1)
+                    break;
+            }
+            for(size_t i=k;i<N;i++)
+                for(size_t j=k;j<N;j++)
+                    if(std::fabs(a[i][j])>thr)
+                        return false;
+            return true;
+        }
+    }
+
+    template<typename RET_TYPE>
+    bool isPositiveSemiDefinite(const std::vector<std::vector<RET_TYPE> > &km,double tol) {
+        if(!isSymmetric(km))
+            return false;
+        Matrix<double> a;
+        copyMat(km,a);
+        return detail::psdFactorization(a,tol);
+    }
+
+    template<typename RET_TYPE>
+    bool isPositiveSemiDefinite(const MatrixView<RET_TYPE> &km,double tol) {
+        if(!isSymmetric(km))
+            return false;
+        Matrix<double> a;
+        copyMat(km,a);
+        return detail::psdFactorization(a,tol);
+    }
+
+    namespace detail {
+
+        /** @brief Lanczos estimate of the smallest eigenvalue of the non-empty N×N symmetric matrix km, given by its rows as in symv, see ktools::smallestEigenvalue. */
+        template<typename ROWS>
+        double lanczosMin(const ROWS &km,size_t N,size_t maxIter,double tol,uint64_t seed) {
+            // Number of iterations in between two convergence checks.
+            const size_t CHECK=5;
+            size_t M=std::min(maxIter,N);
+            Matrix<double> v(M+1,N);
+            std::mt19937_64 rng(seed);
+            std::normal_distribution<double> gauss;
+            for(size_t i=0;i<N;i++)
+                v[0][i]=gauss(rng);
+            double nrm=std::sqrt(dot(v[0],v[0],N));
+            for(size_t i=0;i<N;i++)
+                v[0][i]/=nrm;
+            std::vector<double> alpha,beta,d,e;
+            double theta=0;
+            for(size_t j=0;j<M;j++) {
+                double *w=v[j+1];
+                symv(km,N,v[j],w);
+                alpha.push_back(dot(w,v[j],N));
+                for(size_t i=0;i<N;i++)
+                    w[i]-=alpha[j]*v[j][i]+(j>0?beta[j-1]*v[j-1][i]:0);
+                for(size_t r=0;r<=j;r++) {
+                    double c=dot(w,v[r],N);
+                    for(size_t i=0;i<N;i++)
+                        w[i]-=c*v[r][i];
+                }
+                beta.push_back(std::sqrt(dot(w,w,N)));
+                bool last=j+1==M||beta[j]<=std::numeric_limits<double>::epsilon()*std::fabs(alpha[j]);
+                if(last||(j+1)%CHECK==0) {
+                    d=alpha;
+                    e=beta;
+                    tridiagonalEigen(d,e,0);
+                    double prev=theta;
+                    theta=*std::min_element(d.begin(),d.end());
+                    double scale=std::max(std::fabs(*std::max_element(d.begin(),d.end())),std::fabs(theta));
+                    if(last||(j+1>CHECK&&std::fabs(theta-prev)<=tol*scale))
+                        break;
+                }
+                for(size_t i=0;i<N;i++)
+                    w[i]/=beta[j];
+            }
+            return theta;
+        }
+    }
+
+    template<typename RET_TYPE>
+    double smallestEigenvalue(const std::vector<std::vector<RET_TYPE> > &km,size_t maxIter,double tol,uint64_t seed) {
+        if(!isSquare(km))
+            throw "Kernel matrix is not square.";
+        if(km.empty())
+            throw "Kernel matrix is empty.";
+        if(maxIter==0)
+            throw "Iteration count is 0.";
+        std::vector<const RET_TYPE*> rows;
+        detail::rowPointers(km,rows);
+        return detail::lanczosMin(rows,km.size(),maxIter,tol,seed);
+    }
+
+    template<typename RET_TYPE>
+    double smallestEigenvalue(const MatrixView<RET_TYPE> &km,size_t maxIter,double tol,uint64_t seed) {
+        if(!isSquare(km))
+            throw "Kernel matrix is not square.";
+        if(km.rows()==0)
+            throw "Kernel matrix is empty.";
+        if(maxIter==0)
+            throw "Iteration count is 0.";
+        return detail::lanczosMin(km,km.rows(),maxIter,tol,seed);
+    }
+
+    namespace detail {
+
+        /** @brief Clips in place the eigenvalues of the non-empty N×N symmetric matrix km, given by its rows as in symv, see ktools::clipEigenvalues. */
+        template<typename RET_TYPE,typename ROWS>
+        size_t clipRows(const ROWS &km,size_t N,double minEig) {
+            Matrix<double> a(N,N);
+            for(size_t i=0;i<N;i++)
+                std::copy(km[i],km[i]+N,a[i]);
+            Matrix<double> h;
+            std::vector<double> hn,d,e;
+            tridiagonalize(a,h,hn,d,e);
+            Matrix<double> zt(N,N,0.0);
+            for(size_t i=0;i<N;i++)
+                zt[i][i]=1;
+            tridiagonalEigen(d,e,&zt);
+            std::vector<size_t> clip;
+            for(size_t i=0;i<N;i++)
+                if(d[i]<minEig)
+                    clip.push_back(i);
+            // back-transforms the eigenvectors to clip, u_i = Q z_i
+            parallelFor(clip.size(),[&](size_t c,size_t) {
+                householderApply(h,hn,zt[clip[c]]);
+            });
+            parallelFor(N,[&](size_t i,size_t) {
+                for(size_t c=0;c<clip.size();c++) {
+                    const double *z=zt[clip[c]];
+                    double w=(minEig-d[clip[c]])*z[i];
+                    for(size_t j=0;j<=i;j++)
+                        km[i][j]=RET_TYPE(km[i][j]+w*z[j]);
+                }
+            });
+            for(size_t i=0;i<N;i++)
+                for(size_t j=0;j<i;j++)
+                    km[j][i]=km[i][j];
+            return clip.size();
+        }
+    }
+
+    template<typename RET_TYPE>
+    size_t clipEigenvalues(std::vector<std::vector<RET_TYPE> > &km,double minEig) {
+        if(!isSymmetric(km))
+            throw "Kernel matrix is not symmetric.";
+        if(km.empty())
+            return 0;
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(km,rows);
+        return detail::clipRows<RET_TYPE>(rows,km.size(),minEig);
+    }
+
+    template<typename RET_TYPE>
+    size_t clipEigenvalues(const MatrixView<RET_TYPE> &km,double minEig) {
+        if(!isSymmetric(km))
+            throw "Kernel matrix is not symmetric.";
+        if(km.rows()==0)
+            return 0;
+        return detail::clipRows<RET_TYPE>(km,km.rows(),minEig);
+    }
+
+
+    namespace detail {
+
+        /** @brief Streamed product with a kernel matrix, \f$ Z_{li} = \sum_j k(x_i,x_j) Q_{lj} \f$, for all rows \f$ Q_l \f$ of `q`.
+         *
+         *  Rows of the kernel matrix are evaluated on demand in tiles of `B` rows, in parallel.
+         *  The first `ncache` tiles are stored in `cache` on first evaluation, and reused afterwards.
+         *  If `rowsums` is not null, it receives the row sums of the kernel matrix.
+         */
+        template<typename SK,typename DATA_TYPE>
+        void gramProduct(SK &sk,const std::vector<DATA_TYPE> &xlist,const Matrix<double> &q,Matrix<double> &z,std::vector<Matrix<double> > &cache,size_t ncache,size_t B,std::vector<double> *rowsums) {
+            size_t N=xlist.size(),L=q.rows();
+            size_t NT=(N+B-1)/B;
+            z.resize(L,N);
+            parallelFor(NT,[&](size_t t,size_t) {
+                size_t i0=t*B,i1=std::min(i0+B,N);
+                Matrix<double> local;
+                Matrix<double> *rows=&local;
+                if(t<ncache)
+                    rows=&cache[t];
+                if(rows->rows()==0) {
+                    rows->resize(i1-i0,N);
+                    for(size_t i=i0;i<i1;i++)
+                        for(size_t j=0;j<N;j++)
+                            sk(xlist[i],xlist[j],(*rows)[i-i0][j]);
+                }
+                for(size_t i=i0;i<i1;i++) {
+                    const double *ki=(*rows)[i-i0];
+                    for(size_t l=0;l<L;l++)
+                        z[l][i]=dot(ki,q[l],N);
+                    if(rowsums) {
+                        double sum=0;
+                        for(size_t j=0;j<N;j++)
+                            sum+=ki[j];
+                        (*rowsums)[i]=sum;
+                    }
+                }
+            });
+        }
+
+        /** @brief Orthonormalizes the rows of `q` (Gram-Schmidt, twice), replacing rows which turn out linearly dependent with random ones. */
+        inline void orthonormalizeRows(Matrix<double> &q,std::mt19937_64 &rng) {
+            std::normal_distribution<double> gauss;
+            size_t L=q.rows(),N=q.cols();
+            for(size_t l=0;l<L;l++) {
+                double *ql=q[l];
+                for(size_t attempt=0;;attempt++) {
+                    double n0=std::sqrt(dot(ql,ql,N));
+                    for(size_t pass=0;pass<2;pass++) {
+                        for(size_t r=0;r<l;r++) {
+                            double c=dot(ql,q[r],N);
+                            for(size_t j=0;j<N;j++)
+                                ql[j]-=c*q[r][j];
+                        }
+                    }
+                    double n1=std::sqrt(dot(ql,ql,N));
+                    if(n1>1e-10*n0&&n1>0) {
+                        for(size_t j=0;j<N;j++)
+                            ql[j]/=n1;
+                        break;
+                    }
+                    if(attempt==10)
+                        throw "Unable to orthonormalize the subspace basis.";
+                    for(size_t j=0;j<N;j++)
+                        ql[j]=gauss(rng);
+                }
+            }
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE>
+    void kpca(SK &sk,const std::vector<DATA_TYPE> &xlist,size_t K,KpcaModel &model,size_t cacheBytes,size_t iters,size_t oversampling,uint64_t seed) {
+        // Number of kernel matrix rows per tile.
+        const size_t B=64;
+        size_t N=xlist.size();
+        if(N==0)
+            throw "Input set doesn't contain any element.";
+        if(K==0||K>N)
+            throw "Number of components must be in between 1 and the input set size.";
+        size_t L=std::min(K+oversampling,N);
+        prepare(sk,xlist);
+        std::vector<Matrix<double> > cache((N+B-1)/B);
+        size_t ncache=std::min(cache.size(),cacheBytes/(B*N*sizeof(double)));
+        std::mt19937_64 rng(seed);
+        std::normal_distribution<double> gauss;
+        Matrix<double> q(L,N),z;
+        for(size_t l=0;l<L;l++)
+            for(size_t j=0;j<N;j++)
+                q[l][j]=gauss(rng);
+        std::vector<double> &m=model.stats.means;
+        m.resize(N);
+        double &g=model.stats.grandMean;
+        // centered product, Kc q = K q - 1 (m.q) - m (1.q) + g 1 (1.q)
+        auto product=[&](bool first) {
+            detail::gramProduct(sk,xlist,q,z,cache,ncache,B,first?&m:0);
+            if(first) {
+                g=0;
+                for(size_t i=0;i<N;i++) {
+                    m[i]/=N;
+                    g+=m[i];
+                }
+                g/=N;
+            }
+            for(size_t l=0;l<L;l++) {
+                double mq=detail::dot(&m[0],q[l],N);
+                double sq=0;
+                for(size_t j=0;j<N;j++)
+                    sq+=q[l][j];
+                for(size_t i=0;i<N;i++)
+                    z[l][i]+=(g-m[i])*sq-mq;
+            }
+        };
+        product(true);
+        for(size_t it=0;it<iters;it++) {
+            q.swap(z);
+            detail::orthonormalizeRows(q,rng);
+            product(false);
+        }
+        q.swap(z);
+        detail::orthonormalizeRows(q,rng);
+        product(false);
+        // Rayleigh-Ritz on T = Q Kc Q^T
+        Matrix<double> t(L,L);
+        for(size_t a=0;a<L;a++)
+            for(size_t b=0;b<=a;b++)
+                t[a][b]=t[b][a]=(detail::dot(q[a],z[b],N)+detail::dot(q[b],z[a],N))/2;
+        Matrix<double> h;
+        std::vector<double> hn,d,e;
+        detail::tridiagonalize(t,h,hn,d,e);
+        Matrix<double> st(L,L,0.0);
+        for(size_t a=0;a<L;a++)
+            st[a][a]=1;
+        detail::tridiagonalEigen(d,e,&st);
+        std::vector<size_t> order(L);
+        for(size_t a=0;a<L;a++)
+            order[a]=a;
+        std::sort(order.begin(),order.end(),[&](size_t a,size_t b) { return d[a]>d[b]; });
+        model.eigenvalues.resize(K);
+        model.eigenvectors.resize(K,N);
+        model.eigenvectors.fill(0);
+        for(size_t c=0;c<K;c++) {
+            double *sc=st[order[c]];
+            detail::householderApply(h,hn,sc);
+            model.eigenvalues[c]=d[order[c]];
+            double *u=model.eigenvectors[c];
+            for(size_t a=0;a<L;a++)
+                for(size_t j=0;j<N;j++)
+                    u[j]+=sc[a]*q[a][j];
+        }
+    }
+
+    namespace detail {
+
+        /** @brief Projects `ylist` on the components of `model`, fitted on `xlist`, into the already sized `proj`, given by its rows as in symv, see ktools::kpcaProject. */
+        template<typename RET_TYPE,typename SK,typename DATA_TYPE,typename ROWS>
+        void kpcaRows(SK &sk,const std::vector<DATA_TYPE> &xlist,const KpcaModel &model,const std::vector<DATA_TYPE> &ylist,const ROWS &proj) {
+            const size_t B=64;
+            size_t N=xlist.size(),M=ylist.size(),K=model.eigenvalues.size();
+            prepare(sk,xlist);
+            prepare(sk,ylist);
+            std::vector<double> w(K,0);
+            for(size_t c=0;c<K;c++)
+                if(model.eigenvalues[c]>0)
+                    w[c]=1/std::sqrt(model.eigenvalues[c]);
+            parallelFor((M+B-1)/B,[&](size_t t,size_t) {
+                size_t a0=t*B,a1=std::min(a0+B,M);
+                Matrix<double> kt(a1-a0,N);
+                for(size_t a=a0;a<a1;a++)
+                    for(size_t j=0;j<N;j++)
+                        sk(ylist[a],xlist[j],kt[a-a0][j]);
+                for(size_t a=a0;a<a1;a++) {
+                    double *ka=kt[a-a0];
+                    double r=0;
+                    for(size_t j=0;j<N;j++)
+                        r+=ka[j];
+                    r/=N;
+                    for(size_t j=0;j<N;j++)
+                        ka[j]=ka[j]-(r+model.stats.means[j])+model.stats.grandMean;
+                    for(size_t c=0;c<K;c++)
+                        proj[a][c]=RET_TYPE(w[c]*dot(ka,model.eigenvectors[c],N));
+                }
+            });
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void kpcaProject(SK &sk,const std::vector<DATA_TYPE> &xlist,const KpcaModel &model,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &proj) {
+        if(model.stats.means.size()!=xlist.size()||model.eigenvectors.cols()!=xlist.size())
+            throw "Kernel PCA model does not match the input set size.";
+        proj.resize(ylist.size(),model.eigenvalues.size());
+        detail::kpcaRows<RET_TYPE>(sk,xlist,model,ylist,proj.view());
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void kpcaProject(SK &sk,const std::vector<DATA_TYPE> &xlist,const KpcaModel &model,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &proj) {
+        if(model.stats.means.size()!=xlist.size()||model.eigenvectors.cols()!=xlist.size())
+            throw "Kernel PCA model does not match the input set size.";
+        resizeMat(proj,ylist.size(),model.eigenvalues.size());
+        std::vector<RET_TYPE*> rows;
+        detail::rowPointers(proj,rows);
+        detail::kpcaRows<RET_TYPE>(sk,xlist,model,ylist,rows);
+    }
+
+    namespace detail {
+
+        /** @brief Low-rank approximation \f$ K \approx L^T L \f$ of the kernel matrix on `xlist` by incomplete Cholesky factorization, with `kv` the diagonal of \f$ K \f$.
+         *
+         *  Each step adds one row to `l`, from one column of \f$ K \f$ evaluated in parallel.
+         *  With `pivoted`, the landmark of each step is the input with the largest residual diagonal entry; otherwise landmarks are taken in uniformly random order.
+         *  Landmarks with a negligible residual diagonal entry are skipped, hence `l` may end up with less than `rank` rows.
+         */
+        template<typename SK,typename DATA_TYPE>
+        void lowRankFactor(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<double> &kv,size_t rank,bool pivoted,uint64_t seed,Matrix<double> &l) {
+            const size_t B=1024;
+            size_t N=xlist.size();
+            std::vector<double> d(kv);
+            double dmax=*std::max_element(d.begin(),d.end());
+            std::vector<size_t> order(N);
+            for(size_t i=0;i<N;i++)
+                order[i]=i;
+            if(!pivoted) {
+                std::mt19937_64 rng(seed);
+                std::shuffle(order.begin(),order.end(),rng);
+            }
+            l.resize(std::min(rank,N),N);
+            size_t r=0;
+            for(size_t pos=0;pos<N&&r<l.rows();pos++) {
+                size_t p=pivoted?std::max_element(d.begin(),d.end())-d.begin():order[pos];
+                if(d[p]<=1e-12*dmax) {
+                    if(pivoted)
+                        break;
+                    continue;
+                }
+                double inv=1/std::sqrt(d[p]);
+                double *lr=l[r];
+                parallelFor((N+B-1)/B,[&](size_t t,size_t) {
+                    for(size_t j=t*B;j<std::min(t*B+B,N);j++) {
+                        double k;
+                        sk(xlist[j],xlist[p],k);
+                        for(size_t s=0;s<r;s++)
+                            k-=l[s][j]*l[s][p];
+                        lr[j]=k*inv;
+                    }
+                });
+                for(size_t j=0;j<N;j++)
+                    d[j]=std::max(d[j]-lr[j]*lr[j],0.0);
+                d[p]=0;
+                r++;
+            }
+            l.resize(r,N);
+        }
+
+        /** @brief In-place Cholesky factorization \f$ A = G G^T \f$ of a symmetric positive definite matrix, with \f$ G \f$ stored in the lower triangle. */
+        inline void cholesky(Matrix<double> &a) {
+            size_t N=a.rows();
+            for(size_t j=0;j<N;j++) {
+                double s=a[j][j]-dot(a[j],a[j],j);
+                if(s<=0)
+                    throw "Matrix is not positive definite.";
+                a[j][j]=std::sqrt(s);
+                for(size_t i=j+1;i<N;i++)
+                    a[i][j]=(a[i][j]-dot(a[i],a[j],j))/a[j][j];
+            }
+        }
+
+        /** @brief Solves \f$ G G^T x = b \f$ in place, with \f$ G \f$ computed by cholesky(). */
+        inline void choleskySolve(const Matrix<double> &g,double *x) {
+            size_t N=g.rows();
+            for(size_t i=0;i<N;i++)
+                x[i]=(x[i]-dot(g[i],x,i))/g[i][i];
+            for(size_t i=N;i-->0;) {
+                x[i]/=g[i][i];
+                for(size_t k=0;k<i;k++)
+                    x[k]-=g[i][k]*x[i];
+            }
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE>
+    size_t krr(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<double> &y,double lambda,std::vector<double> &alpha,KrrPreconditioner precond,size_t rank,size_t cacheBytes,double tol,size_t maxIter,uint64_t seed) {
+        // Number of kernel matrix rows per tile.
+        const size_t B=64;
+        size_t N=xlist.size();
+        if(N==0)
+            throw "Input set doesn't contain any element.";
+        if(y.size()!=N)
+            throw "Target vector size does not match the input set size.";
+        if(lambda<=0)
+            throw "Regularization must be positive.";
+        prepare(sk,xlist);
+        std::vector<Matrix<double> > cache((N+B-1)/B);
+        size_t ncache=std::min(cache.size(),cacheBytes/(B*N*sizeof(double)));
+        // preconditioner P = L^T L + lambda I, and the Cholesky factor of M = L L^T + lambda I
+        Matrix<double> l,m;
+        if(precond!=KRR_NONE&&rank>0) {
+            std::vector<double> kv;
+            detail::selfKernels(sk,xlist,kv);
+            detail::lowRankFactor(sk,xlist,kv,rank,precond==KRR_CHOLESKY,seed,l);
+            size_t R=l.rows();
+            m.resize(R,R);
+            detail::parallelFor(R,[&](size_t a,size_t) {
+                for(size_t b=0;b<=a;b++)
+                    m[a][b]=detail::dot(l[a],l[b],N);
+                m[a][a]+=lambda;
+            });
+            detail::cholesky(m);
+        }
+        // Woodbury identity, P^-1 v = (v - L^T M^-1 L v) / lambda
+        std::vector<double> w;
+        auto psolve=[&](const double *v,double *z) {
+            size_t R=l.rows();
+            if(R==0) {
+                std::copy(v,v+N,z);
+                return;
+            }
+            w.resize(R);
+            detail::parallelFor(R,[&](size_t a,size_t) {
+                w[a]=detail::dot(l[a],v,N);
+            });
+            detail::choleskySolve(m,&w[0]);
+            detail::parallelFor((N+B-1)/B,[&](size_t t,size_t) {
+                for(size_t j=t*B;j<std::min(t*B+B,N);j++) {
+                    double s=v[j];
+                    for(size_t a=0;a<R;a++)
+                        s-=l[a][j]*w[a];
+                    z[j]=s/lambda;
+                }
+            });
+        };
+        Matrix<double> p(1,N),q;
+        // q = (K + lambda I) p
+        auto product=[&]() {
+            detail::gramProduct(sk,xlist,p,q,cache,ncache,B,0);
+            for(size_t j=0;j<N;j++)
+                q[0][j]+=lambda*p[0][j];
+        };
+        std::vector<double> r(y),z(N);
+        if(alpha.size()==N) {
+            std::copy(alpha.begin(),alpha.end(),p[0]);
+            product();
+            for(size_t j=0;j<N;j++)
+                r[j]-=q[0][j];
+        }
+        else
+            alpha.assign(N,0);
+        double ynorm=std::sqrt(detail::dot(&y[0],&y[0],N));
+        psolve(&r[0],&z[0]);
+        std::copy(z.begin(),z.end(),p[0]);
+        double rz=detail::dot(&r[0],&z[0],N);
+        size_t it=0;
+        while(it<maxIter&&std::sqrt(detail::dot(&r[0],&r[0],N))>tol*ynorm) {
+            product();
+            double a=rz/detail::dot(p[0],q[0],N);
+            for(size_t j=0;j<N;j++) {
+                alpha[j]+=a*p[0][j];
+                r[j]-=a*q[0][j];
+            }
+            it++;
+            psolve(&r[0],&z[0]);
+            double rz1=detail::dot(&r[0],&z[0],N);
+            double beta=rz1/rz;
+            rz=rz1;
+            for(size_t j=0;j<N;j++)
+                p[0][j]=z[j]+beta*p[0][j];
+        }
+        return it;
+    }
+
+    template<typename SK,typename DATA_TYPE>
+    void krrPredict(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<double> &alpha,const std::vector<DATA_TYPE> &ylist,std::vector<double> &f) {
+        const size_t B=64;
+        size_t N=xlist.size(),M=ylist.size();
+        if(alpha.size()!=N)
+            throw "Kernel ridge regression model does not match the input set size.";
+        prepare(sk,xlist);
+        prepare(sk,ylist);
+        f.resize(M);
+        detail::parallelFor((M+B-1)/B,[&](size_t t,size_t) {
+            for(size_t a=t*B;a<std::min(t*B+B,M);a++) {
+                double s=0,k;
+                for(size_t j=0;j<N;j++) {
+                    sk(ylist[a],xlist[j],k);
+                    s+=k*alpha[j];
+                }
+                f[a]=s;
+            }
+        });
+    }
+
+    namespace detail {
+
+        /** @brief Distance oracle on a materialized N×N distance matrix, given by its rows: a MatrixView, or a std::vector of row pointers (see rowPointers). */
+        template<typename ROWS>
+        struct MatrixDistances {
+            const ROWS &dm;
+            size_t N;
+
+            size_t size() const {
+                return N;
+            }
+
+            void row(size_t c,double *out) const {
+                for(size_t o=0;o<N;o++)
+                    out[o]=dm[c][o];
+            }
+        };
+
+        /** @brief Distance oracle which evaluates kernel distances on demand, from precomputed self-kernels. */
+        template<typename SK,typename DATA_TYPE>
+        struct KernelDistances {
+            SK &sk;
+            const std::vector<DATA_TYPE> &xlist;
+            std::vector<double> kv;
+
+            size_t size() const {
+                return xlist.size();
+            }
+
+            void row(size_t c,double *out) const {
+                for(size_t o=0;o<xlist.size();o++) {
+                    double k;
+                    sk(xlist[c],xlist[o],k);
+                    out[o]=o==c?0:sqrtDist<SK>(kv[c]+kv[o]-2*k);
+                }
+            }
+        };
+
+        /** @brief FasterPAM k-medoids on a distance oracle (see ktools::kmedoids). */
+        template<typename ORACLE>
+        double fasterPam(const ORACLE &oracle,size_t K,std::vector<size_t> &medoids,std::vector<size_t> &labels,size_t maxIter,uint64_t seed) {
+            size_t N=oracle.size();
+            if(K==0||K>N)
+                throw "Number of clusters must be in between 1 and the input set size.";
+            // random initialization
+            std::vector<size_t> perm(N);
+            for(size_t i=0;i<N;i++)
+                perm[i]=i;
+            std::mt19937_64 rng(seed);
+            for(size_t i=0;i<K;i++)
+                std::swap(perm[i],perm[i+std::uniform_int_distribution<size_t>(0,N-1-i)(rng)]);
+            medoids.assign(perm.begin(),perm.begin()+K);
+            std::vector<char> isMedoid(N,0);
+            for(size_t m=0;m<K;m++)
+                isMedoid[medoids[m]]=1;
+            // distances from each medoid to all inputs, nearest and second nearest medoid of each input
+            Matrix<double> dmed(K,N);
+            parallelFor(K,[&](size_t m,size_t) {
+                oracle.row(medoids[m],dmed[m]);
+            });
+            std::vector<size_t> near(N),second(N);
+            std::vector<double> dnear(N),dsecond(N),loss(K);
+            double td=0;
+            auto assign=[&]() {
+                parallelFor(N,[&](size_t o,size_t) {
+                    size_t n=0,s=K;
+                    for(size_t m=1;m<K;m++) {
+                        if(dmed[m][o]<dmed[n][o]) {
+                            s=n;
+                            n=m;
+                        }
+                        else if(s==K||dmed[m][o]<dmed[s][o])
+                            s=m;
+                    }
+                    near[o]=n;
+                    dnear[o]=dmed[n][o];
+                    second[o]=s;
+                    dsecond[o]=s<K?dmed[s][o]:std::numeric_limits<double>::infinity();
+                });
+                // removal loss of each medoid, i.e. increase of the total deviation if it were removed without replacement
+                std::fill(loss.begin(),loss.end(),0.0);
+                td=0;
+                for(size_t o=0;o<N;o++) {
+                    if(K>1)
+                        loss[near[o]]+=dsecond[o]-dnear[o];
+                    td+=dnear[o];
+                }
+            };
+            assign();
+            // candidates are evaluated in parallel batches, each task yielding the distance row, the best medoid to replace and the change of total deviation
+            size_t B=std::max<size_t>(1,4*numThreads());
+            Matrix<double> rows(B,N);
+            std::vector<size_t> best(B);
+            std::vector<double> delta(B);
+            size_t c=0,lastSwap=0,evaluated=0;
+            while(evaluated<N*maxIter&&(evaluated==0||evaluated-lastSwap<N)) {
+                size_t nb=std::min(B,N-c);
+                parallelFor(nb,[&](size_t b,size_t) {
+                    size_t x=c+b;
+                    delta[b]=0;
+                    if(isMedoid[x])
+                        return;
+                    double *r=rows[b];
+                    oracle.row(x,r);
+                    if(K==1) {
+                        best[b]=0;
+                        for(size_t o=0;o<N;o++)
+                            delta[b]+=r[o]-dnear[o];
+                        return;
+                    }
+                    std::vector<double> d(loss);
+                    double acc=0;
+                    for(size_t o=0;o<N;o++) {
+                        if(r[o]<dnear[o]) {
+                            acc+=r[o]-dnear[o];
+                            d[near[o]]+=dnear[o]-dsecond[o];
+                        }
+                        else if(r[o]<dsecond[o])
+                            d[near[o]]+=r[o]-dsecond[o];
+                    }
+                    best[b]=std::min_element(d.begin(),d.end())-d.begin();
+                    delta[b]=d[best[b]]+acc;
+                });
+                size_t b=0;
+                for(;b<nb;b++)
+                    if(delta[b]<-1e-12*td)
+                        break;
+                evaluated+=std::min(b+1,nb);
+                if(b<nb) {
+                    size_t m=best[b];
+                    isMedoid[medoids[m]]=0;
+                    medoids[m]=c+b;
+                    isMedoid[c+b]=1;
+                    std::copy(rows[b],rows[b]+N,dmed[m]);
+                    assign();
+                    lastSwap=evaluated;
+                    c+=b+1;
+                }
+                else
+                    c+=nb;
+                if(c>=N)
+                    c=0;
+            }
+            labels=near;
+            return td;
+        }
+    }
+
+    template<typename RET_TYPE>
+    double kmedoids(const MatrixView<RET_TYPE> &dm,size_t K,std::vector<size_t> &medoids,std::vector<size_t> &labels,size_t maxIter,uint64_t seed) {
+        if(!isSquare(dm))
+            throw "Distance matrix is not square.";
+        detail::MatrixDistances<MatrixView<RET_TYPE> > oracle={dm,dm.rows()};
+        return detail::fasterPam(oracle,K,medoids,labels,maxIter,seed);
+    }
+
+    template<typename RET_TYPE>
+    double kmedoids(const std::vector<std::vector<RET_TYPE> > &dm,size_t K,std::vector<size_t> &medoids,std::vector<size_t> &labels,size_t maxIter,uint64_t seed) {
+        if(!isSquare(dm))
+            throw "Distance matrix is not square.";
+        std::vector<const RET_TYPE*> rows;
+        detail::rowPointers(dm,rows);
+        detail::MatrixDistances<std::vector<const RET_TYPE*> > oracle={rows,dm.size()};
+        return detail::fasterPam(oracle,K,medoids,labels,maxIter,seed);
+    }
+
+    template<typename SK,typename DATA_TYPE>
+    double kmedoids(SK &sk,const std::vector<DATA_TYPE> &xlist,size_t K,std::vector<size_t> &medoids,std::vector<size_t> &labels,size_t maxIter,uint64_t seed) {
+        prepare(sk,xlist);
+        detail::KernelDistances<SK,DATA_TYPE> oracle={sk,xlist,std::vector<double>()};
+        detail::selfKernels(sk,xlist,oracle.kv);
+        return detail::fasterPam(oracle,K,medoids,labels,maxIter,seed);
+    }
+
+    namespace detail {
+
+        /** @brief Runs `f(ti,tj,tid)` on the tiles (ti,tj) of `m`, for all tj (or only \f$ tj \leq ti \f$ with `lower`), concurrently and in tile row order, where `tid` identifies the executing thread (see parallelFor).
+         *
+         *  Each tile row is released (see TiledMatrix::release) by the thread which completes its last tile, hence only the tile rows being visited are resident.
+         */
+        template<typename RET_TYPE,typename F>
+        void tileRows(const TiledMatrix<RET_TYPE> &m,bool lower,F f) {
+            size_t NR=m.tileRows();
+            std::vector<size_t> first(NR+1,0);
+            for(size_t ti=0;ti<NR;ti++)
+                first[ti+1]=first[ti]+(lower?ti+1:m.tileCols());
+            std::vector<std::atomic<size_t> > left(NR);
+            for(size_t ti=0;ti<NR;ti++)
+                left[ti]=first[ti+1]-first[ti];
+            parallelFor(first[NR],[&](size_t t,size_t tid) {
+                size_t ti=std::upper_bound(first.begin(),first.end(),t)-first.begin()-1;
+                f(ti,t-first[ti],tid);
+                if(--left[ti]==0)
+                    m.release(ti);
+            });
+        }
+    }
+
+    template<typename RET_TYPE,typename F>
+    void forEachTile(TiledMatrix<RET_TYPE> &m,F f) {
+        detail::tileRows(m,m.isSymmetric(),[&](size_t ti,size_t tj,size_t) {
+            f(ti,tj,m.tile(ti,tj));
+        });
+    }
+
+    namespace detail {
+
+        /** @brief Implementation of ktools::extend, for Matrix and PackedMatrix, with the normalized matrix `nkm` optional. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE,typename M>
+        void extendImpl(SK &sk,const std::vector<DATA_TYPE> &xlist,M &km,std::vector<RET_TYPE> &kv,M *nkm) {
+            size_t N0=squareSize(km);
+            size_t N=xlist.size();
+            if(N<N0)
+                throw "Input set is smaller than the kernel matrix.";
+            if(kv.size()!=N0)
+                throw "Self-kernel vector size does not match the kernel matrix size.";
+            if(nkm&&squareSize(*nkm)!=N0)
+                throw "Normalized kernel matrix size does not match the kernel matrix size.";
+            // evaluated on xlist itself, since self-kernels cached by address on a copy of the new inputs would go stale (see ktools::release)
+            prepare(sk,xlist);
+            kv.resize(N);
+            parallelFor(N-N0,[&](size_t t,size_t) {
+                if(KernelTraits<SK>::unitDiagonal)
+                    kv[N0+t]=RET_TYPE(1);
+                else
+                    sk(xlist[N0+t],kv[N0+t]);
+            });
+            growMat(km,N);
+            if(nkm)
+                growMat(*nkm,N);
+            parallelFor(N-N0,[&](size_t t,size_t) {
+                size_t i=N0+t;
+                RET_TYPE *ki=lowerRow(km,i);
+                ki[i]=kv[i];
+                for(size_t j=0;j<i;j++)
+                    sk(xlist[i],xlist[j],ki[j]);
+                if(nkm) {
+                    RET_TYPE *ni=lowerRow(*nkm,i);
+                    ni[i]=kv[i]!=RET_TYPE(0)?RET_TYPE(1):RET_TYPE(0);
+                    for(size_t j=0;j<i;j++)
+                        ni[j]=KernelTraits<SK>::unitDiagonal||ki[j]==RET_TYPE(0)?ki[j]:RET_TYPE(ki[j]/std::sqrt(kv[i]*kv[j]));
+                }
+            });
+            mirrorRows(km,N0);
+            if(nkm)
+                mirrorRows(*nkm,N0);
+        }
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv) {
+        detail::extendImpl(sk,xlist,km,kv,(Matrix<RET_TYPE>*)0);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv,Matrix<RET_TYPE> &nkm) {
+        detail::extendImpl(sk,xlist,km,kv,&nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv) {
+        detail::extendImpl(sk,xlist,km,kv,(PackedMatrix<RET_TYPE>*)0);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void extend(SK &sk,const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &km,std::vector<RET_TYPE> &kv,PackedMatrix<RET_TYPE> &nkm) {
+        detail::extendImpl(sk,xlist,km,kv,&nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename WRITER>
+    void stream(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,WRITER &w,size_t blockRows) {
+        if(blockRows==0)
+            throw "Block size is 0.";
+        Matrix<double> buf[2];
+        std::thread writer;
+        std::exception_ptr error;
+        size_t cur=0;
+        try {
+            for(size_t r0=0;r0<xlist.size();r0+=blockRows) {
+                std::vector<DATA_TYPE> xblock(xlist.begin()+r0,xlist.begin()+std::min(r0+blockRows,xlist.size()));
+                sk(xblock,ylist,buf[cur]);
+                release(sk,xblock);
+                if(writer.joinable())
+                    writer.join();
+                if(error)
+                    std::rethrow_exception(error);
+                Matrix<double> *m=&buf[cur];
+                writer=std::thread([&w,&error,m]() {
+                    try {
+                        w.write(m->view());
+                    }
+                    catch(...) {
+                        error=std::current_exception();
+                    }
+                });
+                cur=1-cur;
+            }
+        }
+        catch(...) {
+            if(writer.joinable())
+                writer.join();
+            throw;
+        }
+        if(writer.joinable())
+            writer.join();
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename WRITER>
+    void stream(SK &sk,const std::vector<DATA_TYPE> &xlist,WRITER &w,size_t blockRows) {
+        stream(sk,xlist,xlist,w,blockRows);
+    }
+
+    namespace detail {
+
+        /** @brief Checks the size of `km` against `xlist` and `ylist` (the same object for self-Gram matrices), and prepares `sk` for concurrent evaluations. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void tiledSetup(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const TiledMatrix<RET_TYPE> &km) {
+            if(km.rows()!=xlist.size()||km.cols()!=ylist.size())
+                throw "Tiled matrix size does not match the input set size.";
+            if(km.isSymmetric()&&&xlist!=&ylist)
+                throw "Tiled matrix is symmetric but the input sets differ.";
+            prepare(sk,xlist);
+            if(&xlist!=&ylist)
+                prepare(sk,ylist);
+        }
+
+        /** @brief Fills the stored tiles of `km` with the kernel values on `xlist` and `ylist` (the same object for self-Gram matrices), streaming over the tiles.
+         *
+         *  Each tile is evaluated through the list overloads of `sk` (see gramBlock), transformed in place by `g(i0,j0,t)` while it is in cache, and copied to the file.
+         *  Diagonal tiles of self-Gram matrices are evaluated through the symmetric list overload, and `g` should keep them symmetric (see mirrorRows).
+         */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE,typename G>
+        void gramTileBlocks(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,TiledMatrix<RET_TYPE> &km,G g) {
+            tiledSetup(sk,xlist,ylist,km);
+            bool self=&xlist==&ylist;
+            size_t B=km.tileSize(),T=numThreads();
+            std::vector<std::vector<DATA_TYPE> > xb(T),yb(T);
+            std::vector<Matrix<RET_TYPE> > t(T);
+            tileRows(km,km.isSymmetric(),[&](size_t ti,size_t tj,size_t tid) {
+                MatrixView<RET_TYPE> tile=km.tile(ti,tj);
+                size_t i0=ti*B,j0=tj*B;
+                gramBlock(sk,xlist,ylist,self,i0,i0+tile.rows(),j0,j0+tile.cols(),xb[tid],yb[tid],t[tid]);
+                g(i0,j0,t[tid]);
+                for(size_t a=0;a<tile.rows();a++)
+                    std::copy(t[tid][a],t[tid][a]+tile.cols(),tile[a]);
+            });
+        }
+
+        /** @brief Fills `km` with the kernel values on `xlist` and `ylist` (the same object for self-Gram matrices), streaming over the tiles. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void gramTiles(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,TiledMatrix<RET_TYPE> &km) {
+            gramTileBlocks(sk,xlist,ylist,km,[](size_t,size_t,Matrix<RET_TYPE>&) {});
+        }
+
+        /** @brief Fills `nkm` with the normalized kernel values on `xlist` and `ylist` (the same object for self-Gram matrices), given the self-kernels `xkv` and `ykv`, streaming over the tiles. */
+        template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+        void normTiles(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,const std::vector<RET_TYPE> &xkv,const std::vector<RET_TYPE> &ykv,TiledMatrix<RET_TYPE> &nkm) {
+            bool self=&xlist==&ylist;
+            std::vector<RET_TYPE> xr,yr;
+            rsqrtDiagonal(xkv,xr);
+            rsqrtDiagonal(ykv,yr);
+            gramTileBlocks(sk,xlist,ylist,nkm,[&](size_t i0,size_t j0,Matrix<RET_TYPE> &t) {
+                for(size_t a=0;a<t.rows();a++)
+                    normRow<SK>(t[a],&ykv[j0],&yr[j0],xkv[i0+a],xr[i0+a],t.cols());
+                if(self&&i0==j0) {
+                    mirrorRows(t,0);
+                    for(size_t a=0;a<t.rows();a++)
+                        t[a][a]=xkv[i0+a]!=RET_TYPE(0)?RET_TYPE(1):RET_TYPE(0);
+                }
+            });
+        }
+
+        /** @brief Diagonal of a square tiled matrix. */
+        template<typename RET_TYPE>
+        void tiledDiagonal(const TiledMatrix<RET_TYPE> &m,std::vector<RET_TYPE> &d) {
+            if(m.rows()!=m.cols())
+                throw "Kernel matrix is not square.";
+            d.resize(m.rows());
+            for(size_t ti=0;ti<m.tileRows();ti++) {
+                MatrixView<RET_TYPE> t=m.tile(ti,ti);
+                for(size_t a=0;a<t.rows();a++)
+                    d[ti*m.tileSize()+a]=t[a][a];
+                m.release(ti);
+            }
+        }
+    }
+
+    template<typename RET_TYPE>
+    void kern2norm(TiledMatrix<RET_TYPE> &nkm) {
+        std::vector<RET_TYPE> d,r;
+        detail::tiledDiagonal(nkm,d);
+        detail::rsqrtDiagonal(d,r);
+        size_t B=nkm.tileSize();
+        forEachTile(nkm,[&](size_t ti,size_t tj,const MatrixView<RET_TYPE> &t) {
+            for(size_t a=0;a<t.rows();a++) {
+                size_t i=ti*B+a;
+                detail::scaleRow(t[a],&r[tj*B],r[i],t.cols());
+                if(ti==tj)
+                    t[a][a]=d[i]!=RET_TYPE(0)?RET_TYPE(1):RET_TYPE(0);
+            }
+        });
+    }
+
+    template<typename RET_TYPE>
+    void kern2dist(TiledMatrix<RET_TYPE> &dm) {
+        std::vector<RET_TYPE> d;
+        detail::tiledDiagonal(dm,d);
+        size_t B=dm.tileSize();
+        // each tile on or below the diagonal is paired with its mirror tile, if stored, to symmetrize the values as in the Matrix version;
+        // with symmetric storage, only the lower half of diagonal tiles holds values, and it is mirrored onto the upper half
+        detail::tileRows(dm,true,[&](size_t ti,size_t tj,size_t) {
+            MatrixView<RET_TYPE> t=dm.tile(ti,tj);
+            bool mirrored=ti==tj||!dm.isSymmetric();
+            MatrixView<RET_TYPE> u=mirrored?dm.tile(tj,ti):t;
+            std::vector<RET_TYPE> s(t.cols());
+            for(size_t a=0;a<t.rows();a++) {
+                size_t n=ti==tj?a:t.cols();
+                for(size_t b=0;b<n;b++)
+                    s[b]=dm.isSymmetric()?t[a][b]:(t[a][b]+u[b][a])/2;
+                detail::distRow(&s[0],&d[tj*B],d[ti*B+a],n);
+                for(size_t b=0;b<n;b++) {
+                    t[a][b]=s[b];
+                    if(mirrored)
+                        u[b][a]=s[b];
+                }
+                if(ti==tj)
+                    t[a][a]=RET_TYPE(0);
+            }
+            if(ti!=tj&&mirrored)
+                dm.release(tj,ti);
+        });
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void norm(SK &sk,const std::vector<DATA_TYPE> &xlist,TiledMatrix<RET_TYPE> &nkm) {
+        if(KernelTraits<SK>::unitDiagonal) {
+            detail::gramTiles(sk,xlist,xlist,nkm);
+            return;
+        }
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::normTiles(sk,xlist,xlist,kv,kv,nkm);
+    }
+
+    template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+    void dist(SK &sk,const std::vector<DATA_TYPE> &xlist,TiledMatrix<RET_TYPE> &dm) {
+        std::vector<RET_TYPE> kv;
+        detail::selfKernels(sk,xlist,kv);
+        detail::gramTileBlocks(sk,xlist,xlist,dm,[&](size_t i0,size_t j0,Matrix<RET_TYPE> &t) {
+            for(size_t a=0;a<t.rows();a++)
+                detail::distRow<SK>(t[a],&kv[j0],kv[i0+a],t.cols());
+            if(i0==j0) {
+                detail::mirrorRows(t,0);
+                for(size_t a=0;a<t.rows();a++)
+                    t[a][a]=RET_TYPE(0);
+            }
+        });
+    }
+
+    template<typename DATA_TYPE>
+    uint64_t hash(const DATA_TYPE &x,uint64_t h) {
+        unsigned char bytes[sizeof(DATA_TYPE)];
+        std::memcpy(bytes,&x,sizeof(DATA_TYPE));
+        for(size_t b=0;b<sizeof(DATA_TYPE);b++) {
+            h^=bytes[b];
+            h*=1099511628211ULL;
+        }
+        return h;
+    }
+
+    template<typename DATA_TYPE>
+    uint64_t hash(const std::vector<DATA_TYPE> &x,uint64_t h) {
+        h=hash(x.size(),h);
+        for(size_t i=0;i<x.size();i++)
+            h=hash(x[i],h);
+        return h;
+    }
+
+    namespace detail {
+
+        /** @brief Returns `sk.fingerprint()`, selected when the kernel class provides such a method. */
+        template<typename SK>
+        auto fingerprintImpl(const SK &sk,int) -> decltype(uint64_t(sk.fingerprint())) {
+            return sk.fingerprint();
+        }
+
+        /** @brief Returns 0, selected when the kernel class does not provide a fingerprint method. */
+        template<typename SK>
+        uint64_t fingerprintImpl(const SK &sk,long) {
+            return 0;
+        }
+    }
+
+    template<typename SK>
+    uint64_t fingerprint(const SK &sk) {
+        return detail::fingerprintImpl(sk,0);
     }
 
 }
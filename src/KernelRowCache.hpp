@@ -0,0 +1,249 @@
+#ifndef _KERNEL_ROW_CACHE_HPP_
+#define _KERNEL_ROW_CACHE_HPP_
+
+#include<algorithm>
+#include<list>
+#include<map>
+#include<memory>
+#include<mutex>
+#include<utility>
+#include<vector>
+#include"KernelTraits.hpp"
+#include"RefKernel.hpp"
+#include"KTools.hpp"
+
+/** @brief Kernel Row Cache class.
+ *
+ *  Serves rows of the kernel matrix of a fixed set of inputs, i.e. \f$ k_{SK}(x_i,x_j) \f$ for all \f$ x_j \f$ in the set, as requested by iterative solvers (e.g. SMO-style SVM solvers, coordinate descent) which only ever access a few rows at a time.
+ *
+ *  Rows are kept in memory up to a budget of bytes, and the least recently used rows are discarded once the budget is exceeded.
+ *  Missing rows are computed in parallel batches, on up to ktools::numThreads() threads.
+ *  For symmetric kernels (see KernelTraits), the values of a new row already present in cached rows, i.e. \f$ k_{SK}(x_j,x_i) \f$ in row j, are copied rather than evaluated.
+ *
+ *  The self-kernels of the set, i.e. the diagonal of the kernel matrix, are computed once at construction.
+ *
+ *  The cache may be accessed concurrently from several threads.
+ *  Rows are returned as shared pointers, which stay valid after the row has been discarded from the cache.
+ *
+ *  This class extends RefKernel, and thus requires the specification of an internal kernel instance.
+ *
+ *  Data Inputs
+ *  -----------
+ *
+ *  The set is held by reference, and must therefore outlive the class instance and not be modified.
+ */
+template<typename SK,typename DATA_TYPE,typename RET_TYPE=double>
+class KernelRowCache: public RefKernel<SK> {
+    public:
+        /** @brief Shared pointer to a kernel row. */
+        typedef std::shared_ptr<const std::vector<RET_TYPE> > Row;
+
+    protected:
+        /** @brief The set of inputs. */
+        const std::vector<DATA_TYPE> &_xlist;
+
+        /** @brief Self-kernels of the set. */
+        std::vector<RET_TYPE> _kv;
+
+        /** @brief Maximum number of cached rows, derived from the budget of bytes. */
+        size_t _maxRows;
+
+        /** @brief Copy values from cached rows when computing new ones, for symmetric kernels. */
+        bool _symmetry;
+
+        /** @brief Cached rows (with their index), ordered from the most to the least recently used. */
+        std::list<std::pair<size_t,Row> > _lru;
+
+        /** @brief Index of the cached rows. */
+        std::map<size_t,typename std::list<std::pair<size_t,Row> >::iterator> _index;
+
+        /** @brief Number of rows served from the cache. */
+        size_t _hits;
+
+        /** @brief Number of rows computed. */
+        size_t _misses;
+
+        /** @brief Guards the cache. */
+        mutable std::mutex _mutex;
+
+    public:
+        /** @brief Number of columns computed by each parallel task. */
+        static const size_t BLOCK=512;
+
+        /** @brief Initializes the internal kernel reference and computes the self-kernels of the set.
+         *
+         *  @param[in] sk
+         *          Kernel instance.
+         *  @param[in] xlist
+         *          List (std::vector) of inputs.
+         *  @param[in] bytes
+         *          Budget of bytes for the cached rows. Each row takes `xlist.size()*sizeof(RET_TYPE)` bytes.
+         *  @param[in] symmetry
+         *          If true and the kernel is symmetric, values are copied from the cached rows whenever possible.
+         */
+        KernelRowCache(SK &sk,const std::vector<DATA_TYPE> &xlist,size_t bytes,bool symmetry=true);
+
+        /** @brief Returns row i of the kernel matrix, computing it if not cached.
+         *
+         *  @param[in] i
+         *          Row index.
+         *  @return
+         *          The kernel row, i.e. \f$ k_{SK}(x_i,x_j) \f$ for all j.
+         */
+        Row row(size_t i);
+
+        /** @brief Returns several rows of the kernel matrix, computing the missing ones in a single parallel batch.
+         *
+         *  @param[in] idx
+         *          Row indexes.
+         *  @param[out] out
+         *          The kernel rows, in the order of `idx`.
+         */
+        void rows(const std::vector<size_t> &idx,std::vector<Row> &out);
+
+        /** @brief Self-kernels of the set, i.e. the diagonal of the kernel matrix. */
+        const std::vector<RET_TYPE>& diagonal() const;
+
+        /** @brief Number of inputs in the set. */
+        size_t size() const;
+
+        /** @brief Number of rows currently cached. */
+        size_t cached() const;
+
+        /** @brief Number of rows served from the cache so far. */
+        size_t hits() const;
+
+        /** @brief Number of rows computed so far. */
+        size_t misses() const;
+
+        /** @brief Discards all the cached rows. */
+        void clear();
+
+    private:
+        /** @brief Inserts row i as the most recently used, and discards the least recently used rows beyond the budget. Requires the lock. */
+        void insert(size_t i,const Row &r);
+};
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+const size_t KernelRowCache<SK,DATA_TYPE,RET_TYPE>::BLOCK;
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+KernelRowCache<SK,DATA_TYPE,RET_TYPE>::KernelRowCache(SK &sk,const std::vector<DATA_TYPE> &xlist,size_t bytes,bool symmetry): RefKernel<SK>(sk),_xlist(xlist),_maxRows(0),_symmetry(symmetry&&KernelTraits<SK>::symmetric),_hits(0),_misses(0) {
+    if(!xlist.empty())
+        _maxRows=bytes/(xlist.size()*sizeof(RET_TYPE));
+    ktools::prepare(this->_sk,_xlist);
+    ktools::detail::selfKernels(this->_sk,_xlist,_kv);
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+typename KernelRowCache<SK,DATA_TYPE,RET_TYPE>::Row KernelRowCache<SK,DATA_TYPE,RET_TYPE>::row(size_t i) {
+    std::vector<Row> out;
+    rows(std::vector<size_t>(1,i),out);
+    return out[0];
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+void KernelRowCache<SK,DATA_TYPE,RET_TYPE>::rows(const std::vector<size_t> &idx,std::vector<Row> &out) {
+    size_t N=_xlist.size();
+    out.assign(idx.size(),Row());
+    std::vector<size_t> missing;
+    // cached rows from which the values of the missing rows are copied, kept alive until done
+    std::vector<Row> sources;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(size_t t=0;t<idx.size();t++) {
+            if(idx[t]>=N)
+                throw "Row index exceeds the set size.";
+            typename std::map<size_t,typename std::list<std::pair<size_t,Row> >::iterator>::iterator it=_index.find(idx[t]);
+            if(it!=_index.end()) {
+                _lru.splice(_lru.begin(),_lru,it->second);
+                out[t]=it->second->second;
+                _hits++;
+            }
+            else if(std::find(missing.begin(),missing.end(),idx[t])==missing.end())
+                missing.push_back(idx[t]);
+        }
+        if(missing.empty())
+            return;
+        _misses+=missing.size();
+        if(_symmetry) {
+            sources.assign(N,Row());
+            for(typename std::list<std::pair<size_t,Row> >::iterator it=_lru.begin();it!=_lru.end();++it)
+                sources[it->first]=it->second;
+        }
+    }
+    std::vector<std::shared_ptr<std::vector<RET_TYPE> > > computed(missing.size());
+    for(size_t m=0;m<missing.size();m++)
+        computed[m]=std::make_shared<std::vector<RET_TYPE> >(N);
+    size_t NB=(N+BLOCK-1)/BLOCK;
+    ktools::detail::parallelFor(missing.size()*NB,[&](size_t t,size_t) {
+        size_t i=missing[t/NB];
+        std::vector<RET_TYPE> &r=*computed[t/NB];
+        for(size_t j=(t%NB)*BLOCK;j<std::min((t%NB+1)*BLOCK,N);j++) {
+            if(j==i)
+                r[j]=_kv[i];
+            else if(_symmetry&&sources[j])
+                r[j]=(*sources[j])[i];
+            else
+                this->_sk(_xlist[i],_xlist[j],r[j]);
+        }
+    });
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(size_t m=0;m<missing.size();m++) {
+        Row r=computed[m];
+        if(_index.find(missing[m])==_index.end())
+            insert(missing[m],r);
+        for(size_t t=0;t<idx.size();t++)
+            if(idx[t]==missing[m])
+                out[t]=r;
+    }
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+void KernelRowCache<SK,DATA_TYPE,RET_TYPE>::insert(size_t i,const Row &r) {
+    if(_maxRows==0)
+        return;
+    _lru.push_front(std::make_pair(i,r));
+    _index[i]=_lru.begin();
+    while(_lru.size()>_maxRows) {
+        _index.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+const std::vector<RET_TYPE>& KernelRowCache<SK,DATA_TYPE,RET_TYPE>::diagonal() const {
+    return _kv;
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+size_t KernelRowCache<SK,DATA_TYPE,RET_TYPE>::size() const {
+    return _xlist.size();
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+size_t KernelRowCache<SK,DATA_TYPE,RET_TYPE>::cached() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _lru.size();
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+size_t KernelRowCache<SK,DATA_TYPE,RET_TYPE>::hits() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _hits;
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+size_t KernelRowCache<SK,DATA_TYPE,RET_TYPE>::misses() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _misses;
+}
+
+template<typename SK,typename DATA_TYPE,typename RET_TYPE>
+void KernelRowCache<SK,DATA_TYPE,RET_TYPE>::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _lru.clear();
+    _index.clear();
+}
+
+#endif // _KERNEL_ROW_CACHE_HPP_
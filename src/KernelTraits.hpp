@@ -0,0 +1,37 @@
+#ifndef _KERNEL_TRAITS_HPP_
+#define _KERNEL_TRAITS_HPP_
+
+/** @brief Kernel Traits class.
+ *
+ *  Describes, at compile time, properties of a kernel class which allow to skip redundant work.
+ *  For example, normalizing a kernel with unit diagonal does not require any self-kernel evaluation, and normalizing a stationary kernel requires a single one.
+ *
+ *  The default traits make no assumption other than symmetry, which holds for any kernel by definition.
+ *  Each kernel class specializes this template next to its own definition; any user-defined kernel class may do the same.
+ *
+ *  Traits are used, for example, by NormKernel and by the ktools namespace.
+ */
+template<typename K>
+struct KernelTraits {
+    /** @brief \f$ k(x,x) = 1 \quad \forall x \f$. */
+    static const bool unitDiagonal=false;
+
+    /** @brief \f$ k(x,y) \f$ only depends on \f$ x-y \f$, hence \f$ k(x,x) \f$ is the same for all \f$ x \f$. */
+    static const bool stationary=false;
+
+    /** @brief \f$ k(x,y) = k(y,x) \quad \forall x,y \f$. */
+    static const bool symmetric=true;
+
+    /** @brief The kernel is positive semi-definite. */
+    static const bool positive=false;
+};
+
+/** @brief Kernel Traits class for const-qualified kernels.
+ *
+ *  Same as the traits of the non-qualified kernel class.
+ */
+template<typename K>
+struct KernelTraits<const K>: public KernelTraits<K> {
+};
+
+#endif // _KERNEL_TRAITS_HPP_
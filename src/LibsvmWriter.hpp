@@ -0,0 +1,158 @@
+#ifndef _LIBSVM_WRITER_HPP_
+#define _LIBSVM_WRITER_HPP_
+
+#include<cstdio>
+#include<fstream>
+#include<string>
+#include<vector>
+#if __cplusplus>=201703L
+#include<charconv>
+#endif
+#include"Matrix.hpp"
+
+/** @brief LIBSVM Writer class.
+ *
+ *  Writes a kernel matrix in the precomputed-kernel text format of LIBSVM, one row at a time, i.e. one line per row:
+ *
+ *      <label> 0:<serial number> 1:<k(x_i,y_1)> 2:<k(x_i,y_2)> ...
+ *
+ *  where serial numbers start from 1.
+ *  Rows are appended in blocks through write(), typically from ktools::stream, so that no full kernel matrix is ever held in memory.
+ *
+ *  Values are converted to text with `std::to_chars` when available (C++17), which yields the shortest representation that reads back to the same value, and with `snprintf` otherwise.
+ *  The text is accumulated in a buffer of BUFFER bytes before being written to file.
+ */
+class LibsvmWriter {
+    protected:
+        /** @brief Output file. */
+        std::ofstream _ofs;
+
+        /** @brief Labels of the rows. */
+        std::vector<double> _labels;
+
+        /** @brief Text not yet written to file. */
+        std::string _buf;
+
+        /** @brief Number of rows written so far. */
+        size_t _NR;
+
+        /** @brief Number of columns, set by the first block of rows. */
+        size_t _NC;
+
+    public:
+        /** @brief Size of the text buffer, in bytes. */
+        static const size_t BUFFER=1<<20;
+
+        /** @brief Creates (or overwrites) the output file.
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         *  @param[in] labels
+         *          Labels of the rows, in order. Must contain at least as many labels as the rows which are written.
+         */
+        LibsvmWriter(const std::string &fname,const std::vector<double> &labels);
+
+        /** @brief Closes the file, see close(). */
+        ~LibsvmWriter();
+
+        /** @brief Appends a block of rows.
+         *
+         *  @param[in] rows
+         *          Block of rows of the kernel matrix. All blocks must have the same number of columns.
+         */
+        template<typename RET_TYPE>
+        void write(const MatrixView<RET_TYPE> &rows);
+
+        /** @brief Writes the buffered text and closes the file. Does nothing if already closed. */
+        void close();
+
+        /** @brief Number of rows written so far. */
+        size_t rows() const;
+
+    private:
+        /** @brief Appends unsigned integer n to the buffer. */
+        void append(size_t n);
+
+        /** @brief Appends value v to the buffer. */
+        void append(double v);
+};
+
+inline LibsvmWriter::LibsvmWriter(const std::string &fname,const std::vector<double> &labels): _ofs(fname.c_str(),std::ios::out|std::ios::trunc|std::ios::binary),_labels(labels),_NR(0),_NC(0) {
+    if(!_ofs.is_open())
+        throw "Output file cannot be created.";
+    _buf.reserve(BUFFER+4096);
+}
+
+inline LibsvmWriter::~LibsvmWriter() {
+    try {
+        close();
+    }
+    catch(...) {
+    }
+}
+
+template<typename RET_TYPE>
+void LibsvmWriter::write(const MatrixView<RET_TYPE> &rows) {
+    if(!_ofs.is_open())
+        throw "Output file is closed.";
+    if(_NR>0&&rows.cols()!=_NC)
+        throw "Row block size does not match the previous rows.";
+    if(_NR+rows.rows()>_labels.size())
+        throw "Label vector is shorter than the number of rows.";
+    _NC=rows.cols();
+    for(size_t i=0;i<rows.rows();i++,_NR++) {
+        append(_labels[_NR]);
+        _buf+=" 0:";
+        append(_NR+1);
+        for(size_t j=0;j<_NC;j++) {
+            _buf+=' ';
+            append(j+1);
+            _buf+=':';
+            append(double(rows[i][j]));
+        }
+        _buf+='\n';
+        if(_buf.size()>=BUFFER) {
+            _ofs.write(_buf.data(),_buf.size());
+            _buf.clear();
+        }
+    }
+    if(!_ofs)
+        throw "Output file cannot be written.";
+}
+
+inline void LibsvmWriter::close() {
+    if(!_ofs.is_open())
+        return;
+    _ofs.write(_buf.data(),_buf.size());
+    _buf.clear();
+    _ofs.close();
+    if(!_ofs)
+        throw "Output file cannot be written.";
+}
+
+inline size_t LibsvmWriter::rows() const {
+    return _NR;
+}
+
+inline void LibsvmWriter::append(size_t n) {
+    char s[24];
+    size_t l=sizeof(s);
+    do {
+        s[--l]=char('0'+n%10);
+        n/=10;
+    } while(n>0);
+    _buf.append(s+l,sizeof(s)-l);
+}
+
+inline void LibsvmWriter::append(double v) {
+    char s[32];
+#if defined(__cpp_lib_to_chars)
+    std::to_chars_result r=std::to_chars(s,s+sizeof(s),v);
+    _buf.append(s,r.ptr-s);
+#else
+    int l=std::snprintf(s,sizeof(s),"%.17g",v);
+    _buf.append(s,size_t(l));
+#endif
+}
+
+#endif // _LIBSVM_WRITER_HPP_
@@ -0,0 +1,404 @@
+#ifndef _MATRIX_HPP_
+#define _MATRIX_HPP_
+
+#include<algorithm>
+#include<cstdlib>
+#include<new>
+#include<stdint.h>
+
+/** @brief Matrix View class.
+ *
+ *  Non-owning view of a row-major matrix of some basic numeric type (double, float, int..), stored contiguously with a leading dimension (i.e. distance between the starts of two consecutive rows) greater or equal to the number of columns.
+ *
+ *  Elements are accessed either as `m[i][j]`, exactly as with the nested std::vector matrices, or as `m(i,j)`.
+ *  The view is shallow: copying it does not copy the elements, and its constness does not propagate to the elements.
+ *
+ *  The layout is directly usable by BLAS/LAPACK routines (row-major, with leading dimension `ld()`).
+ */
+template<typename T>
+class MatrixView {
+    protected:
+        /** @brief Pointer to the first element. */
+        T *_data;
+
+        /** @brief Number of rows. */
+        size_t _NR;
+
+        /** @brief Number of columns. */
+        size_t _NC;
+
+        /** @brief Leading dimension, in elements. */
+        size_t _LD;
+
+    public:
+        /** @brief Initializes an empty view. */
+        MatrixView();
+
+        /** @brief Initializes a view on existing memory.
+         *
+         *  @param[in] data
+         *          Pointer to the first element.
+         *  @param[in] NR
+         *          Number of rows.
+         *  @param[in] NC
+         *          Number of columns.
+         *  @param[in] LD
+         *          Leading dimension, in elements.
+         */
+        MatrixView(T *data,size_t NR,size_t NC,size_t LD);
+
+        /** @brief Converts a view on mutable elements into a view on constant elements.
+         *
+         *  @param[in] m
+         *          View to convert.
+         */
+        template<typename U>
+        MatrixView(const MatrixView<U> &m);
+
+        /** @brief Number of rows. */
+        size_t rows() const;
+
+        /** @brief Number of columns. */
+        size_t cols() const;
+
+        /** @brief Leading dimension, in elements. */
+        size_t ld() const;
+
+        /** @brief Pointer to the first element. */
+        T* data() const;
+
+        /** @brief Pointer to the first element of row i, such that `m[i][j]` is the element in row i and column j. */
+        T* operator[](size_t i) const;
+
+        /** @brief Element in row i and column j. */
+        T& operator()(size_t i,size_t j) const;
+
+        /** @brief View on the sub-matrix of NR rows and NC columns starting at row r0 and column c0.
+         *
+         *  @param[in] r0
+         *          First row.
+         *  @param[in] c0
+         *          First column.
+         *  @param[in] NR
+         *          Number of rows.
+         *  @param[in] NC
+         *          Number of columns.
+         *  @return
+         *          The sub-matrix view.
+         */
+        MatrixView<T> view(size_t r0,size_t c0,size_t NR,size_t NC) const;
+};
+
+/** @brief Matrix class.
+ *
+ *  Row-major matrix of some basic numeric type (double, float, int..), stored in a single contiguous allocation whose first element, as well as the first element of each row, is aligned to Matrix::ALIGN bytes.
+ *  Rows are padded up to the alignment, hence the leading dimension `ld()` may be greater than the number of columns.
+ *
+ *  This is the matrix type accepted and produced by the list overloads of the kernel classes and by the ktools namespace.
+ *  The nested std::vector matrices are still accepted: their overloads work on them in place, through pointers to their rows.
+ */
+template<typename T>
+class Matrix: public MatrixView<T> {
+    protected:
+        /** @brief Pointer to the allocated (non-aligned) memory. */
+        void *_raw;
+
+        /** @brief Number of rows of `ld()` elements that fit in the allocated memory. */
+        size_t _cap;
+
+    public:
+        /** @brief Alignment, in bytes, of the first element of each row. */
+        static const size_t ALIGN=64;
+
+        /** @brief Initializes an empty matrix. */
+        Matrix();
+
+        /** @brief Initializes a matrix of NR rows and NC columns, with all elements set to v.
+         *
+         *  @param[in] NR
+         *          Number of rows.
+         *  @param[in] NC
+         *          Number of columns.
+         *  @param[in] v
+         *          Value of the elements.
+         */
+        Matrix(size_t NR,size_t NC,const T &v=T());
+
+        /** @brief Copy constructor (deep copy). */
+        Matrix(const Matrix &m);
+
+        /** @brief Move constructor. */
+        Matrix(Matrix &&m);
+
+        /** @brief Releases the memory. */
+        ~Matrix();
+
+        /** @brief Copy assignment (deep copy). */
+        Matrix& operator=(const Matrix &m);
+
+        /** @brief Move assignment. */
+        Matrix& operator=(Matrix &&m);
+
+        /** @brief Pointer to the first element of row i. */
+        T* operator[](size_t i);
+
+        /** @brief Constant pointer to the first element of row i. */
+        const T* operator[](size_t i) const;
+
+        /** @brief Resizes the matrix into \f$ NR \times NC \f$.
+         *
+         *  As for nested std::vector matrices, the elements in the overlapping sub-matrix are preserved, and new elements are set to 0.
+         *  The matrix is resized in place, without moving its elements, as long as NR rows of NC columns fit in the allocated memory (see reserve); otherwise it is reallocated to exactly \f$ NR \times NC \f$.
+         *
+         *  @param[in] NR
+         *          Number of rows.
+         *  @param[in] NC
+         *          Number of columns.
+         */
+        void resize(size_t NR,size_t NC);
+
+        /** @brief Reserves memory for NR rows of NC columns, such that resizing the matrix up to \f$ NR \times NC \f$ does not move its elements.
+         *
+         *  The elements are preserved; the memory is reallocated only if the current one is too small.
+         *
+         *  @param[in] NR
+         *          Number of rows.
+         *  @param[in] NC
+         *          Number of columns.
+         */
+        void reserve(size_t NR,size_t NC);
+
+        /** @brief Number of rows that fit in the allocated memory, with up to `ld()` columns. */
+        size_t capacity() const;
+
+        /** @brief Sets all elements to v.
+         *
+         *  @param[in] v
+         *          Value of the elements.
+         */
+        void fill(const T &v);
+
+        /** @brief Exchanges the contents of two matrices. */
+        void swap(Matrix &m);
+
+        using MatrixView<T>::view;
+
+        /** @brief View on the whole matrix. */
+        MatrixView<T> view();
+
+        /** @brief View on the whole (constant) matrix. */
+        MatrixView<const T> view() const;
+
+        /** @brief Leading dimension used for NC columns, i.e. NC rounded up to a multiple of the alignment. */
+        static size_t leading(size_t NC);
+
+    private:
+        /** @brief Allocates aligned memory for NR rows of LD elements, and stores the pointers. */
+        void allocate(size_t NR,size_t LD);
+};
+
+template<typename T>
+MatrixView<T>::MatrixView(): _data(0),_NR(0),_NC(0),_LD(0) {
+}
+
+template<typename T>
+MatrixView<T>::MatrixView(T *data,size_t NR,size_t NC,size_t LD): _data(data),_NR(NR),_NC(NC),_LD(LD) {
+}
+
+template<typename T>
+template<typename U>
+MatrixView<T>::MatrixView(const MatrixView<U> &m): _data(m.data()),_NR(m.rows()),_NC(m.cols()),_LD(m.ld()) {
+}
+
+template<typename T>
+size_t MatrixView<T>::rows() const {
+    return _NR;
+}
+
+template<typename T>
+size_t MatrixView<T>::cols() const {
+    return _NC;
+}
+
+template<typename T>
+size_t MatrixView<T>::ld() const {
+    return _LD;
+}
+
+template<typename T>
+T* MatrixView<T>::data() const {
+    return _data;
+}
+
+template<typename T>
+T* MatrixView<T>::operator[](size_t i) const {
+    return _data+i*_LD;
+}
+
+template<typename T>
+T& MatrixView<T>::operator()(size_t i,size_t j) const {
+    return _data[i*_LD+j];
+}
+
+template<typename T>
+MatrixView<T> MatrixView<T>::view(size_t r0,size_t c0,size_t NR,size_t NC) const {
+    if(r0+NR>_NR||c0+NC>_NC)
+        throw "Sub-matrix exceeds the matrix dimensions.";
+    return MatrixView<T>(_data+r0*_LD+c0,NR,NC,_LD);
+}
+
+template<typename T>
+const size_t Matrix<T>::ALIGN;
+
+template<typename T>
+Matrix<T>::Matrix(): MatrixView<T>(),_raw(0),_cap(0) {
+}
+
+template<typename T>
+Matrix<T>::Matrix(size_t NR,size_t NC,const T &v): MatrixView<T>(),_raw(0),_cap(0) {
+    allocate(NR,leading(NC));
+    this->_NC=NC;
+    fill(v);
+}
+
+template<typename T>
+Matrix<T>::Matrix(const Matrix &m): MatrixView<T>(),_raw(0),_cap(0) {
+    allocate(m._NR,m._LD);
+    this->_NC=m._NC;
+    std::copy(m._data,m._data+m._NR*m._LD,this->_data);
+}
+
+template<typename T>
+Matrix<T>::Matrix(Matrix &&m): MatrixView<T>(m),_raw(m._raw),_cap(m._cap) {
+    m._raw=0;
+    m._cap=0;
+    m._data=0;
+    m._NR=m._NC=m._LD=0;
+}
+
+template<typename T>
+Matrix<T>::~Matrix() {
+    std::free(_raw);
+}
+
+template<typename T>
+Matrix<T>& Matrix<T>::operator=(const Matrix &m) {
+    if(this!=&m) {
+        Matrix<T> tmp(m);
+        swap(tmp);
+    }
+    return *this;
+}
+
+template<typename T>
+Matrix<T>& Matrix<T>::operator=(Matrix &&m) {
+    swap(m);
+    return *this;
+}
+
+template<typename T>
+T* Matrix<T>::operator[](size_t i) {
+    return this->_data+i*this->_LD;
+}
+
+template<typename T>
+const T* Matrix<T>::operator[](size_t i) const {
+    return this->_data+i*this->_LD;
+}
+
+template<typename T>
+void Matrix<T>::resize(size_t NR,size_t NC) {
+    if(NR==this->_NR&&NC==this->_NC)
+        return;
+    if(NR<=_cap&&leading(NC)<=this->_LD) {
+        size_t nr=std::min(NR,this->_NR);
+        if(NC>this->_NC)
+            for(size_t i=0;i<nr;i++)
+                std::fill((*this)[i]+this->_NC,(*this)[i]+NC,T(0));
+        for(size_t i=nr;i<NR;i++)
+            std::fill((*this)[i],(*this)[i]+NC,T(0));
+        this->_NR=NR;
+        this->_NC=NC;
+        return;
+    }
+    Matrix<T> tmp;
+    tmp.allocate(NR,leading(NC));
+    tmp._NC=NC;
+    tmp.fill(T(0));
+    size_t nr=std::min(NR,this->_NR);
+    size_t nc=std::min(NC,this->_NC);
+    for(size_t i=0;i<nr;i++)
+        std::copy((*this)[i],(*this)[i]+nc,tmp[i]);
+    swap(tmp);
+}
+
+template<typename T>
+void Matrix<T>::reserve(size_t NR,size_t NC) {
+    if(NR<=_cap&&leading(NC)<=this->_LD)
+        return;
+    Matrix<T> tmp;
+    tmp.allocate(std::max(NR,_cap),std::max(leading(NC),this->_LD));
+    tmp._NR=this->_NR;
+    tmp._NC=this->_NC;
+    for(size_t i=0;i<this->_NR;i++)
+        std::copy((*this)[i],(*this)[i]+this->_NC,tmp[i]);
+    swap(tmp);
+}
+
+template<typename T>
+size_t Matrix<T>::capacity() const {
+    return _cap;
+}
+
+template<typename T>
+void Matrix<T>::fill(const T &v) {
+    std::fill(this->_data,this->_data+this->_NR*this->_LD,v);
+}
+
+template<typename T>
+void Matrix<T>::swap(Matrix &m) {
+    std::swap(this->_data,m._data);
+    std::swap(this->_NR,m._NR);
+    std::swap(this->_NC,m._NC);
+    std::swap(this->_LD,m._LD);
+    std::swap(_raw,m._raw);
+    std::swap(_cap,m._cap);
+}
+
+template<typename T>
+MatrixView<T> Matrix<T>::view() {
+    return MatrixView<T>(this->_data,this->_NR,this->_NC,this->_LD);
+}
+
+template<typename T>
+MatrixView<const T> Matrix<T>::view() const {
+    return MatrixView<const T>(this->_data,this->_NR,this->_NC,this->_LD);
+}
+
+template<typename T>
+size_t Matrix<T>::leading(size_t NC) {
+    if(ALIGN%sizeof(T)!=0)
+        return NC;
+    size_t step=ALIGN/sizeof(T);
+    return (NC+step-1)/step*step;
+}
+
+template<typename T>
+void Matrix<T>::allocate(size_t NR,size_t LD) {
+    std::free(_raw);
+    _raw=0;
+    this->_data=0;
+    this->_NR=NR;
+    this->_LD=LD;
+    this->_NC=0;
+    _cap=NR;
+    if(NR*LD==0)
+        return;
+    _raw=std::malloc(NR*LD*sizeof(T)+ALIGN);
+    if(_raw==0)
+        throw std::bad_alloc();
+    uintptr_t p=reinterpret_cast<uintptr_t>(_raw);
+    this->_data=reinterpret_cast<T*>((p+ALIGN-1)/ALIGN*ALIGN);
+}
+
+#endif // _MATRIX_HPP_
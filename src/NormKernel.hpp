@@ -10,7 +10,18 @@
 #define _NORM_KERNEL_HPP_
 
 #include<cmath>
+#include<list>
+#include<map>
+#include<mutex>
+#include<utility>
 #include<vector>
+#include<stdint.h>
+#include"KernelTraits.hpp"
+#include"Matrix.hpp"
+#include"PackedMatrix.hpp"
+#include"TiledMatrix.hpp"
+#include"RefKernel.hpp"
+#include"KTools.hpp"
 
 /** @brief Normalized Kernel class.
  *
@@ -25,17 +36,106 @@
  *  -----------
  *
  *  The inputs to this kernel must be adequate for the supplied internal kernel instance.
+ *
+ *  Self-kernel cache
+ *  -----------------
+ *
+ *  Each normalized value requires the self-kernels \f$ k_{SK}(x,x) \f$ and \f$ k_{SK}(y,y) \f$, which may be as expensive as \f$ k_{SK}(x,y) \f$ itself (e.g. for the PathKernel).
+ *  When the same inputs are scored repeatedly, a bounded cache of self-kernel values can be enabled through cache().
+ *  Inputs are identified either by content (see ktools::hash) or by identity (i.e. memory address).
+ *  The least recently used values are discarded once the cache is full; clearCache() and invalidate() discard values explicitly.
  */
 template<typename SK>
 class NormKernel: public RefKernel<SK>{
+    protected:
+        /** @brief Maximum number of self-kernel values held in the cache. A value of 0 disables the cache. */
+        size_t _cacheMax;
+
+        /** @brief Identification of the inputs by content (true) or by identity (false). */
+        bool _cacheContent;
+
+        /** @brief Cached self-kernel values, ordered from the most to the least recently used. */
+        std::list<std::pair<uint64_t,double> > _cacheList;
+
+        /** @brief Index of the cached self-kernel values. */
+        std::map<uint64_t,std::list<std::pair<uint64_t,double> >::iterator> _cacheMap;
+
+        /** @brief Guards the cache, so that the kernel may be evaluated concurrently. */
+        mutable std::mutex _cacheMutex;
+
 	public: 
         /** @brief Initiates the internal kernel.
+         *
+         *  The self-kernel cache is disabled.
          *
          *  @param[in] sk
          *          Kernel to normalize.
          */
         NormKernel(SK &sk);
 
+        /** @brief Copy constructor.
+         *
+         *  Copies the internal kernel reference and the cache configuration, but not the cached values.
+         *
+         *  @param[in] nk
+         *          Kernel to copy.
+         */
+        NormKernel(const NormKernel &nk);
+
+        /** @brief Configures the self-kernel cache.
+         *
+         *  Any value already in the cache is discarded.
+         *
+         *  @param[in] size
+         *          Maximum number of self-kernel values held in the cache. If 0, the cache is disabled.
+         *  @param[in] content
+         *          If true, inputs are identified by content through ktools::hash.
+         *          If false, inputs are identified by their memory address, which is cheaper but only valid as long as the inputs are neither moved nor modified.
+         *          The ktools functions which evaluate the kernel on temporary copies of the inputs (e.g. ktools::stream) discard the values of the copies through release().
+         */
+        void cache(const size_t size,const bool content=true);
+
+        /** @brief Discards all the values in the self-kernel cache. */
+        void clearCache();
+
+        /** @brief Discards the cached self-kernel value of a specific input, if present.
+         *
+         *  @param[in] x
+         *          Input whose self-kernel value is discarded.
+         */
+        template<typename DATA_TYPE>
+        void invalidate(const DATA_TYPE &x);
+
+        /** @brief Number of values currently held in the self-kernel cache.
+         *
+         *  @return
+         *          The number of cached values.
+         */
+        size_t cacheSize() const;
+
+        /** @brief Hash of the internal kernel's fingerprint, which identifies the kernel function (see ktools::fingerprint). */
+        uint64_t fingerprint() const;
+
+        /** @brief Prepares the internal kernel for concurrent evaluations on the inputs in `xlist`, see ktools::prepare.
+         *
+         *  The self-kernel cache is already protected by a mutex.
+         *
+         *  @param[in] xlist
+         *          List (std::vector) of inputs.
+         */
+        template<typename DATA_TYPE>
+        void prepare(const std::vector<DATA_TYPE> &xlist);
+
+        /** @brief Discards the self-kernel values cached by identity for the inputs in `xlist`, which are about to be destroyed, see ktools::release.
+         *
+         *  Values cached by content remain valid, and are kept.
+         *
+         *  @param[in] xlist
+         *          List (std::vector) of inputs.
+         */
+        template<typename DATA_TYPE>
+        void release(const std::vector<DATA_TYPE> &xlist);
+
         /** @brief Evaluates the kernel function \f$ k_{NORM}(x,y) \f$ and stores the result in reference parameter k.
          *
          *  @param[in] x
@@ -70,11 +170,19 @@ class NormKernel: public RefKernel<SK>{
          *  @param[in] ylist
          *          List (std::vector) of vectorial inputs.
          *  @param[out] km
-         *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+         *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
          */
         template<typename DATA_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename DATA_TYPE,typename RET_TYPE>
         void operator()(const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &km);
 
+        /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads, on up to ktools::numThreads() threads. */
+        template<typename DATA_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,TiledMatrix<RET_TYPE> &km);
+
         /** @brief Evaluates the kernel function \f$ k_{NORM}(x_i,x_j) \f$ with \f$ x_i,x_j\in \f$ `xlist`, and stores the result in reference matrix parameter km.
          *
          *  After evaluation, `km[i][j]` is set to the kernel value computed on `xlist[i]` and `xlist[j]`.
@@ -84,11 +192,23 @@ class NormKernel: public RefKernel<SK>{
          *  @param[in] xlist
          *          List (std::vector) of vectorial inputs.
          *  @param[out] km
-         *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+         *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
          */
         template<typename DATA_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename DATA_TYPE,typename RET_TYPE>
         void operator()(const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &km);
 
+        /** @brief Same as the Matrix version, with the result stored in a packed symmetric matrix (PackedMatrix), which holds each value once. */
+        template<typename DATA_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads, on up to ktools::numThreads() threads. */
+        template<typename DATA_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<DATA_TYPE> &xlist,TiledMatrix<RET_TYPE> &km);
+
         /** @brief Evaluates the kernel function \f$ k_{NORM}(x_i,x_i) \f$ with \f$ x_i\in \f$ `xlist`, and stores the result in reference vector parameter kv.
          *
          *  Equivalent to:
@@ -104,20 +224,225 @@ class NormKernel: public RefKernel<SK>{
          */
         template<typename DATA_TYPE,typename RET_TYPE>
         void operator()(const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &kv);
+
+    protected:
+        /** @brief Evaluates the internal self-kernel \f$ k_{SK}(x,x) \f$, going through the cache if enabled.
+         *
+         *  @param[in] x
+         *          Input.
+         *  @param[out] k
+         *          Variable in which the self-kernel value is stored.
+         */
+        template<typename DATA_TYPE,typename RET_TYPE>
+        void selfKernel(const DATA_TYPE &x,RET_TYPE &k);
+
+        /** @brief Evaluates the internal self-kernels \f$ k_{SK}(x_i,x_i) \f$, going through the cache if enabled.
+         *
+         *  The cache misses are evaluated together, with a single call to the list overload of the internal kernel.
+         *
+         *  @param[in] xlist
+         *          List (std::vector) of inputs.
+         *  @param[out] kv
+         *          Reference to a vector (std::vector) variable in which the self-kernel values are stored.
+         */
+        template<typename DATA_TYPE,typename RET_TYPE>
+        void selfKernel(const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &kv);
+
+        /** @brief Computes the cache key relative to an input.
+         *
+         *  @param[in] x
+         *          Input.
+         *  @return
+         *          The content hash or the address of the input, depending on the cache configuration.
+         */
+        template<typename DATA_TYPE>
+        uint64_t cacheKey(const DATA_TYPE &x) const;
 }; 
 
+/** @brief Kernel Traits of the NormKernel.
+ *
+ *  The NormKernel inherits the traits of the normalized kernel.
+ *  In particular, its diagonal is not unit in general: the self-kernel of an input is 1, except for inputs with a null internal self-kernel (e.g. an empty sequence under the PathKernel), for which it is 0.
+ */
+template<typename SK>
+struct KernelTraits<NormKernel<SK> > {
+    static const bool unitDiagonal=KernelTraits<SK>::unitDiagonal;
+    static const bool stationary=KernelTraits<SK>::stationary;
+    static const bool symmetric=KernelTraits<SK>::symmetric;
+    static const bool positive=KernelTraits<SK>::positive;
+};
+
+template<typename SK>
+NormKernel<SK>::NormKernel(SK &sk): RefKernel<SK>(sk),_cacheMax(0),_cacheContent(true) {
+};
+
 template<typename SK>
-NormKernel<SK>::NormKernel(SK &sk): RefKernel<SK>(sk) {
+NormKernel<SK>::NormKernel(const NormKernel &nk): RefKernel<SK>(nk._sk),_cacheMax(nk._cacheMax),_cacheContent(nk._cacheContent) {
 };
 
+template<typename SK>
+void NormKernel<SK>::cache(const size_t size,const bool content) {
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    _cacheMax=size;
+    _cacheContent=content;
+    _cacheList.clear();
+    _cacheMap.clear();
+}
+
+template<typename SK>
+void NormKernel<SK>::clearCache() {
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    _cacheList.clear();
+    _cacheMap.clear();
+}
+
+template<typename SK>
+template<typename DATA_TYPE>
+void NormKernel<SK>::prepare(const std::vector<DATA_TYPE> &xlist) {
+    ktools::prepare(this->_sk,xlist);
+}
+
+template<typename SK>
+template<typename DATA_TYPE>
+void NormKernel<SK>::release(const std::vector<DATA_TYPE> &xlist) {
+    ktools::release(this->_sk,xlist);
+    if(_cacheMax==0||_cacheContent)
+        return;
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    for(size_t i=0;i<xlist.size();i++) {
+        typename std::map<uint64_t,std::list<std::pair<uint64_t,double> >::iterator>::iterator it=_cacheMap.find(cacheKey(xlist[i]));
+        if(it!=_cacheMap.end()) {
+            _cacheList.erase(it->second);
+            _cacheMap.erase(it);
+        }
+    }
+}
+
+template<typename SK>
+template<typename DATA_TYPE>
+void NormKernel<SK>::invalidate(const DATA_TYPE &x) {
+    uint64_t key=cacheKey(x);
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    typename std::map<uint64_t,std::list<std::pair<uint64_t,double> >::iterator>::iterator it=_cacheMap.find(key);
+    if(it!=_cacheMap.end()) {
+        _cacheList.erase(it->second);
+        _cacheMap.erase(it);
+    }
+}
+
+template<typename SK>
+size_t NormKernel<SK>::cacheSize() const {
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    return _cacheList.size();
+}
+
+template<typename SK>
+uint64_t NormKernel<SK>::fingerprint() const {
+    return ktools::hash(ktools::fingerprint(this->_sk));
+}
+
+template<typename SK>
+template<typename DATA_TYPE>
+uint64_t NormKernel<SK>::cacheKey(const DATA_TYPE &x) const {
+    if(_cacheContent)
+        return ktools::hash(x);
+    return uint64_t(reinterpret_cast<uintptr_t>(&x));
+}
+
+template<typename SK>
+template<typename DATA_TYPE,typename RET_TYPE>
+void NormKernel<SK>::selfKernel(const DATA_TYPE &x,RET_TYPE &k) {
+    if(_cacheMax==0) {
+        this->_sk(x,k);
+        return;
+    }
+    uint64_t key=cacheKey(x);
+    {
+        std::lock_guard<std::mutex> lock(_cacheMutex);
+        typename std::map<uint64_t,std::list<std::pair<uint64_t,double> >::iterator>::iterator it=_cacheMap.find(key);
+        if(it!=_cacheMap.end()) {
+            _cacheList.splice(_cacheList.begin(),_cacheList,it->second);
+            k=RET_TYPE(it->second->second);
+            return;
+        }
+    }
+    this->_sk(x,k);
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    if(_cacheMap.find(key)==_cacheMap.end()) {
+        _cacheList.push_front(std::make_pair(key,double(k)));
+        _cacheMap[key]=_cacheList.begin();
+        while(_cacheList.size()>_cacheMax) {
+            _cacheMap.erase(_cacheList.back().first);
+            _cacheList.pop_back();
+        }
+    }
+}
+
+template<typename SK>
+template<typename DATA_TYPE,typename RET_TYPE>
+void NormKernel<SK>::selfKernel(const std::vector<DATA_TYPE> &xlist,std::vector<RET_TYPE> &kv) {
+    if(_cacheMax==0||KernelTraits<SK>::stationary) {
+        ktools::detail::selfKernels(this->_sk,xlist,kv);
+        return;
+    }
+    size_t N=xlist.size();
+    kv.resize(N);
+    std::vector<uint64_t> keys(N);
+    for(size_t i=0;i<N;i++)
+        keys[i]=cacheKey(xlist[i]);
+    std::vector<size_t> miss;
+    {
+        std::lock_guard<std::mutex> lock(_cacheMutex);
+        for(size_t i=0;i<N;i++) {
+            typename std::map<uint64_t,std::list<std::pair<uint64_t,double> >::iterator>::iterator it=_cacheMap.find(keys[i]);
+            if(it!=_cacheMap.end()) {
+                _cacheList.splice(_cacheList.begin(),_cacheList,it->second);
+                kv[i]=RET_TYPE(it->second->second);
+            }
+            else
+                miss.push_back(i);
+        }
+    }
+    if(miss.empty())
+        return;
+    // the misses are evaluated with a single call to the list overload of the internal kernel, on a copy of the missed inputs unless all of them missed
+    std::vector<RET_TYPE> mkv;
+    if(miss.size()==N)
+        ktools::detail::selfKernels(this->_sk,xlist,mkv);
+    else {
+        std::vector<DATA_TYPE> mlist(miss.size());
+        for(size_t m=0;m<miss.size();m++)
+            mlist[m]=xlist[miss[m]];
+        ktools::detail::selfKernels(this->_sk,mlist,mkv);
+    }
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    for(size_t m=0;m<miss.size();m++) {
+        size_t i=miss[m];
+        kv[i]=mkv[m];
+        if(_cacheMap.find(keys[i])==_cacheMap.end()) {
+            _cacheList.push_front(std::make_pair(keys[i],double(kv[i])));
+            _cacheMap[keys[i]]=_cacheList.begin();
+        }
+    }
+    while(_cacheList.size()>_cacheMax) {
+        _cacheMap.erase(_cacheList.back().first);
+        _cacheList.pop_back();
+    }
+}
+
 template<typename SK>
 template<typename DATA_TYPE,typename RET_TYPE>
 void NormKernel<SK>::operator()(const DATA_TYPE &x,const DATA_TYPE &y,RET_TYPE &k) {
     RET_TYPE kx,ky;
     this->_sk(x,y,k);
+    if(KernelTraits<SK>::unitDiagonal)
+        return;
     if(k!=RET_TYPE(0)) {
-        this->_sk(x,x,kx);
-        this->_sk(y,y,ky);
+        selfKernel(x,kx);
+        if(KernelTraits<SK>::stationary)
+            ky=kx;
+        else
+            selfKernel(y,ky);
         k=RET_TYPE(k/std::sqrt(kx*ky));
     }
 }
@@ -125,35 +450,109 @@ void NormKernel<SK>::operator()(const DATA_TYPE &x,const DATA_TYPE &y,RET_TYPE &
 template<typename SK>
 template<typename DATA_TYPE,typename RET_TYPE>
 void NormKernel<SK>::operator()(const DATA_TYPE &x,RET_TYPE &k) {
+    if(KernelTraits<SK>::unitDiagonal) {
+        k=RET_TYPE(1);
+        return;
+    }
     this->_sk(x,k);
     if(k!=RET_TYPE(0))
         k=RET_TYPE(1);
 }
 
+template<typename SK>
+template<typename DATA_TYPE,typename RET_TYPE>
+void NormKernel<SK>::operator()(const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,Matrix<RET_TYPE> &km) {
+    if(KernelTraits<SK>::unitDiagonal) {
+        this->_sk(xlist,ylist,km);
+        return;
+    }
+    std::vector<RET_TYPE> kvx,kvy;
+    selfKernel(xlist,kvx);
+    if(&xlist==&ylist)
+        kvy=kvx;
+    else
+        selfKernel(ylist,kvy);
+    ktools::norm(this->_sk,xlist,ylist,kvx,kvy,km);
+}
+
 template<typename SK>
 template<typename DATA_TYPE,typename RET_TYPE>
 void NormKernel<SK>::operator()(const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,std::vector<std::vector<RET_TYPE> > &km) {
+    if(KernelTraits<SK>::unitDiagonal) {
+        this->_sk(xlist,ylist,km);
+        return;
+    }
     std::vector<RET_TYPE> kvx,kvy;
-    this->_sk(xlist,ylist,km);
-    this->_sk(xlist,kvx);
-    this->_sk(ylist,kvy);
-    for(size_t i=0;i<xlist.size();i++)
-        for(size_t j=0;j<ylist.size();j++)
-            if(km[i][j]!=RET_TYPE(0))
-                km[i][j]=RET_TYPE(km[i][j]/std::sqrt(kvx[i]*kvy[j]));
+    selfKernel(xlist,kvx);
+    if(&xlist==&ylist)
+        kvy=kvx;
+    else
+        selfKernel(ylist,kvy);
+    ktools::norm(this->_sk,xlist,ylist,kvx,kvy,km);
+}
+
+template<typename SK>
+template<typename DATA_TYPE,typename RET_TYPE>
+void NormKernel<SK>::operator()(const std::vector<DATA_TYPE> &xlist,const std::vector<DATA_TYPE> &ylist,TiledMatrix<RET_TYPE> &km) {
+    if(KernelTraits<SK>::unitDiagonal) {
+        ktools::detail::gramTiles(this->_sk,xlist,ylist,km);
+        return;
+    }
+    std::vector<RET_TYPE> kvx,kvy;
+    selfKernel(xlist,kvx);
+    if(&xlist==&ylist)
+        kvy=kvx;
+    else
+        selfKernel(ylist,kvy);
+    ktools::detail::normTiles(this->_sk,xlist,ylist,kvx,kvy,km);
+}
+
+template<typename SK>
+template<typename DATA_TYPE,typename RET_TYPE>
+void NormKernel<SK>::operator()(const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km) {
+    if(KernelTraits<SK>::unitDiagonal) {
+        this->_sk(xlist,km);
+        return;
+    }
+    std::vector<RET_TYPE> kv;
+    selfKernel(xlist,kv);
+    ktools::detail::normSym(this->_sk,xlist,kv,km);
 }
 
 template<typename SK>
 template<typename DATA_TYPE,typename RET_TYPE>
 void NormKernel<SK>::operator()(const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &km) {
-    this->_sk(xlist,km);
-    for(size_t i=0;i<xlist.size();i++)
-        for(size_t j=0;j<i;j++)
-            if(km[i][j]!=RET_TYPE(0))
-                km[i][j]=km[j][i]=RET_TYPE(km[i][j]/std::sqrt(km[i][i]*km[j][j]));
-    for(size_t i=0;i<xlist.size();i++)
-        if(km[i][i]!=RET_TYPE(0))
-            km[i][i]=RET_TYPE(1);
+    if(KernelTraits<SK>::unitDiagonal) {
+        this->_sk(xlist,km);
+        return;
+    }
+    std::vector<RET_TYPE> kv;
+    selfKernel(xlist,kv);
+    ktools::detail::normSym(this->_sk,xlist,kv,km);
+}
+
+template<typename SK>
+template<typename DATA_TYPE,typename RET_TYPE>
+void NormKernel<SK>::operator()(const std::vector<DATA_TYPE> &xlist,PackedMatrix<RET_TYPE> &km) {
+    if(KernelTraits<SK>::unitDiagonal) {
+        this->_sk(xlist,km);
+        return;
+    }
+    std::vector<RET_TYPE> kv;
+    selfKernel(xlist,kv);
+    ktools::detail::normSym(this->_sk,xlist,kv,km);
+}
+
+template<typename SK>
+template<typename DATA_TYPE,typename RET_TYPE>
+void NormKernel<SK>::operator()(const std::vector<DATA_TYPE> &xlist,TiledMatrix<RET_TYPE> &km) {
+    if(KernelTraits<SK>::unitDiagonal) {
+        ktools::detail::gramTiles(this->_sk,xlist,xlist,km);
+        return;
+    }
+    std::vector<RET_TYPE> kv;
+    selfKernel(xlist,kv);
+    ktools::detail::normTiles(this->_sk,xlist,xlist,kv,kv,km);
 }
 
 template<typename SK>
@@ -0,0 +1,251 @@
+#ifndef _NORM_REF_SET_HPP_
+#define _NORM_REF_SET_HPP_
+
+#include<cmath>
+#include<fstream>
+#include<string>
+#include<vector>
+#include<stdint.h>
+#include"KernelTraits.hpp"
+#include"Matrix.hpp"
+#include"RefKernel.hpp"
+#include"KTools.hpp"
+
+/** @brief Normalized Reference Set class.
+ *
+ *  Scores queries against a fixed reference set (e.g. the training set of a classifier) with the normalized version of some other kernel \f$ SK \f$, i.e. with
+ *  \f[
+ *      k_{NORM}(x,y_j) = \frac{k_{SK}(x,y_j)}{\sqrt{k_{SK}(x,x)k_{SK}(y_j,y_j)}}
+ *  \f]
+ *  for all \f$ y_j \f$ in the reference set.
+ *
+ *  The self-kernels \f$ k_{SK}(y_j,y_j) \f$ are computed once, when the reference set is prepared, and may be saved on and loaded from disk.
+ *  Each query then costs one self-kernel and one kernel evaluation per reference input, as opposed to the one-vs-many evaluation through NormKernel, which recomputes all the self-kernels of the reference set.
+ *
+ *  This class extends RefKernel, and thus requires the specification of an internal kernel instance.
+ *
+ *  Data Inputs
+ *  -----------
+ *
+ *  The reference set is held by reference, and must therefore outlive the class instance and not be modified.
+ *  Queries must be adequate for the supplied internal kernel instance.
+ */
+template<typename SK,typename DATA_TYPE>
+class NormRefSet: public RefKernel<SK> {
+    protected:
+        /** @brief The reference set. */
+        const std::vector<DATA_TYPE> &_ylist;
+
+        /** @brief Self-kernels of the reference set. */
+        std::vector<double> _ykv;
+
+    public:
+        /** @brief Initializes the internal kernel reference and computes the self-kernels of the reference set.
+         *
+         *  @param[in] sk
+         *          Kernel to normalize.
+         *  @param[in] ylist
+         *          List (std::vector) of reference inputs.
+         */
+        NormRefSet(SK &sk,const std::vector<DATA_TYPE> &ylist);
+
+        /** @brief Initializes the internal kernel reference and loads the self-kernels of the reference set from file.
+         *
+         *  If the file does not exist or does not match the reference set and the kernel function, the self-kernels are computed and the file is (over)written.
+         *
+         *  @param[in] sk
+         *          Kernel to normalize.
+         *  @param[in] ylist
+         *          List (std::vector) of reference inputs.
+         *  @param[in] fname
+         *          Path to the file containing the self-kernels.
+         */
+        NormRefSet(SK &sk,const std::vector<DATA_TYPE> &ylist,const std::string &fname);
+
+        /** @brief Evaluates the normalized kernel function \f$ k_{NORM}(x,y_j) \f$ for all \f$ y_j \f$ in the reference set, and stores the result in reference vector parameter kv.
+         *
+         *  After evaluation, `kv[j]` is set to the normalized kernel value computed on `x` and the `j`-th reference input.
+         *
+         *  @param[in] x
+         *          Query input.
+         *  @param[out] kv
+         *          Reference to a vector (std::vector) variable in which the normalized kernel values are stored.
+         */
+        template<typename RET_TYPE>
+        void operator()(const DATA_TYPE &x,std::vector<RET_TYPE> &kv);
+
+        /** @brief Evaluates the normalized kernel function \f$ k_{NORM}(x_i,y_j) \f$ for all \f$ x_i\in \f$ `xlist` and all \f$ y_j \f$ in the reference set, and stores the result in reference matrix parameter km.
+         *
+         *  After evaluation, `km[i][j]` is set to the normalized kernel value computed on `xlist[i]` and the `j`-th reference input.
+         *
+         *  @param[in] xlist
+         *          List (std::vector) of query inputs.
+         *  @param[out] km
+         *          Reference to a matrix (Matrix) variable in which the normalized kernel values are stored.
+         */
+        template<typename RET_TYPE>
+        void operator()(const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename RET_TYPE>
+        void operator()(const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &km);
+
+        /** @brief Number of inputs in the reference set.
+         *
+         *  @return
+         *          The size of the reference set.
+         */
+        size_t size() const;
+
+        /** @brief Returns the self-kernels of the reference set.
+         *
+         *  @return
+         *          The self-kernels.
+         */
+        const std::vector<double>& getSelfKernels() const;
+
+        /** @brief Saves the self-kernels of the reference set on disk.
+         *
+         *  The file also contains the size and a content hash (see ktools::hash) of the reference set, and the fingerprint of the kernel (see ktools::fingerprint), which are verified on load.
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         *  @return
+         *          True if the file was completely written. False otherwise (e.g. if it could not be opened, or on a write error such as a full disk).
+         */
+        bool save(const std::string &fname) const;
+
+        /** @brief Loads the self-kernels of the reference set from disk.
+         *
+         *  Does nothing if the file does not exist, or if it was saved for a different reference set or with a different kernel function (e.g. another \f$\sigma\f$ of the RbfKernel).
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         *  @return
+         *          True if the self-kernels were actually read from file. False otherwise.
+         */
+        bool load(const std::string &fname);
+
+    private:
+        /** @brief Computes the self-kernels of the reference set. */
+        void prepare();
+
+        /** @brief Scores query x against the reference set, and stores the results in the size() elements starting at kv. */
+        template<typename RET_TYPE>
+        void score(const DATA_TYPE &x,RET_TYPE *kv);
+};
+
+template<typename SK,typename DATA_TYPE>
+NormRefSet<SK,DATA_TYPE>::NormRefSet(SK &sk,const std::vector<DATA_TYPE> &ylist): RefKernel<SK>(sk),_ylist(ylist) {
+    prepare();
+}
+
+template<typename SK,typename DATA_TYPE>
+NormRefSet<SK,DATA_TYPE>::NormRefSet(SK &sk,const std::vector<DATA_TYPE> &ylist,const std::string &fname): RefKernel<SK>(sk),_ylist(ylist) {
+    if(!load(fname)) {
+        prepare();
+        save(fname);
+    }
+}
+
+template<typename SK,typename DATA_TYPE>
+void NormRefSet<SK,DATA_TYPE>::prepare() {
+    ktools::detail::selfKernels(this->_sk,_ylist,_ykv);
+}
+
+template<typename SK,typename DATA_TYPE>
+template<typename RET_TYPE>
+void NormRefSet<SK,DATA_TYPE>::operator()(const DATA_TYPE &x,std::vector<RET_TYPE> &kv) {
+    kv.resize(_ylist.size());
+    if(!kv.empty())
+        score(x,&kv[0]);
+}
+
+template<typename SK,typename DATA_TYPE>
+template<typename RET_TYPE>
+void NormRefSet<SK,DATA_TYPE>::score(const DATA_TYPE &x,RET_TYPE *kv) {
+    size_t lyl=_ylist.size();
+    double kx=1;
+    if(!KernelTraits<SK>::unitDiagonal) {
+        if(KernelTraits<SK>::stationary&&lyl>0)
+            kx=_ykv[0];
+        else
+            this->_sk(x,kx);
+    }
+    for(size_t j=0;j<lyl;j++) {
+        this->_sk(x,_ylist[j],kv[j]);
+        if(!KernelTraits<SK>::unitDiagonal&&kv[j]!=RET_TYPE(0))
+            kv[j]=RET_TYPE(kv[j]/std::sqrt(kx*_ykv[j]));
+    }
+}
+
+template<typename SK,typename DATA_TYPE>
+template<typename RET_TYPE>
+void NormRefSet<SK,DATA_TYPE>::operator()(const std::vector<DATA_TYPE> &xlist,Matrix<RET_TYPE> &km) {
+    km.resize(xlist.size(),_ylist.size());
+    if(_ylist.empty())
+        return;
+    for(size_t i=0;i<xlist.size();i++)
+        score(xlist[i],km[i]);
+}
+
+template<typename SK,typename DATA_TYPE>
+template<typename RET_TYPE>
+void NormRefSet<SK,DATA_TYPE>::operator()(const std::vector<DATA_TYPE> &xlist,std::vector<std::vector<RET_TYPE> > &km) {
+    km.resize(xlist.size());
+    for(size_t i=0;i<xlist.size();i++)
+        (*this)(xlist[i],km[i]);
+}
+
+template<typename SK,typename DATA_TYPE>
+size_t NormRefSet<SK,DATA_TYPE>::size() const {
+    return _ylist.size();
+}
+
+template<typename SK,typename DATA_TYPE>
+const std::vector<double>& NormRefSet<SK,DATA_TYPE>::getSelfKernels() const {
+    return _ykv;
+}
+
+template<typename SK,typename DATA_TYPE>
+bool NormRefSet<SK,DATA_TYPE>::save(const std::string &fname) const {
+    std::ofstream ofs(fname.c_str(),std::ios::out|std::ios::trunc|std::ios::binary);
+    if(!ofs.is_open())
+        return false;
+    uint64_t h=ktools::hash(_ylist);
+    uint64_t fp=ktools::fingerprint(this->_sk);
+    size_t N=_ykv.size();
+    ofs.write((char*)&h,sizeof(h));
+    ofs.write((char*)&fp,sizeof(fp));
+    ofs.write((char*)&N,sizeof(N));
+    if(N>0)
+        ofs.write((char*)&_ykv[0],N*sizeof(_ykv[0]));
+    // a full disk or an I/O error may surface on the writes or only when the buffer is flushed by close()
+    if(!ofs.good())
+        return false;
+    ofs.close();
+    return ofs.good();
+}
+
+template<typename SK,typename DATA_TYPE>
+bool NormRefSet<SK,DATA_TYPE>::load(const std::string &fname) {
+    std::ifstream ifs(fname.c_str(),std::ios::in|std::ios::binary);
+    if(!ifs.is_open())
+        return false;
+    uint64_t h,fp;
+    size_t N;
+    ifs.read((char*)&h,sizeof(h));
+    ifs.read((char*)&fp,sizeof(fp));
+    ifs.read((char*)&N,sizeof(N));
+    if(!ifs||N!=_ylist.size()||h!=ktools::hash(_ylist)||fp!=ktools::fingerprint(this->_sk))
+        return false;
+    std::vector<double> ykv(N);
+    if(N>0)
+        ifs.read((char*)&ykv[0],N*sizeof(ykv[0]));
+    if(!ifs)
+        return false;
+    _ykv.swap(ykv);
+    return true;
+}
+
+#endif // _NORM_REF_SET_HPP_
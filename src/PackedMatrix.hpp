@@ -0,0 +1,171 @@
+#ifndef _PACKED_MATRIX_HPP_
+#define _PACKED_MATRIX_HPP_
+
+#include<algorithm>
+#include<vector>
+
+/** @brief Packed Symmetric Matrix class.
+ *
+ *  Square symmetric matrix of some basic numeric type (double, float, int..), of which only the lower triangle (diagonal included) is stored.
+ *  The triangle is packed row by row: row i holds the i+1 elements of columns 0 to i, and starts at offset \f$ i(i+1)/2 \f$.
+ *  An \f$ N \times N \f$ matrix thus takes \f$ N(N+1)/2 \f$ elements, about half of a full Matrix.
+ *
+ *  Elements are accessed as `m(i,j)`, for any i and j, since `m(i,j)` and `m(j,i)` are the same element.
+ *  Rows of the lower triangle are also accessible as contiguous arrays through `row(i)`.
+ *
+ *  This is the matrix type filled by the packed self-Gram overloads of the kernel classes, and transformed in place by ktools::kern2norm and ktools::kern2dist.
+ *  See ktools::copyMat for conversions to and from Matrix.
+ */
+template<typename T>
+class PackedMatrix {
+    protected:
+        /** @brief Packed lower triangle. */
+        std::vector<T> _data;
+
+        /** @brief Number of rows and columns. */
+        size_t _N;
+
+    public:
+        /** @brief Initializes an empty matrix. */
+        PackedMatrix();
+
+        /** @brief Initializes an \f$ N \times N \f$ matrix, with all elements set to v.
+         *
+         *  @param[in] N
+         *          Number of rows and columns.
+         *  @param[in] v
+         *          Value of the elements.
+         */
+        PackedMatrix(size_t N,const T &v=T());
+
+        /** @brief Number of rows and columns. */
+        size_t size() const;
+
+        /** @brief Number of stored elements, i.e. \f$ N(N+1)/2 \f$. */
+        size_t elements() const;
+
+        /** @brief Pointer to the first stored element. */
+        T* data();
+
+        /** @brief Constant pointer to the first stored element. */
+        const T* data() const;
+
+        /** @brief Pointer to the first element of row i of the lower triangle, such that `row(i)[j]` is the element in row i and column j, for \f$ j \leq i \f$. */
+        T* row(size_t i);
+
+        /** @brief Constant pointer to the first element of row i of the lower triangle. */
+        const T* row(size_t i) const;
+
+        /** @brief Element in row i and column j (or, equivalently, in row j and column i). */
+        T& operator()(size_t i,size_t j);
+
+        /** @brief Constant element in row i and column j (or, equivalently, in row j and column i). */
+        const T& operator()(size_t i,size_t j) const;
+
+        /** @brief Resizes the matrix into \f$ N \times N \f$.
+         *
+         *  As for Matrix, the elements in the overlapping sub-matrix are preserved, and new elements are set to 0.
+         *
+         *  @param[in] N
+         *          Number of rows and columns.
+         */
+        void resize(size_t N);
+
+        /** @brief Reserves memory for an \f$ N \times N \f$ matrix, so that growing up to N rows and columns (e.g. through ktools::extend) does not reallocate.
+         *
+         *  @param[in] N
+         *          Number of rows and columns.
+         */
+        void reserve(size_t N);
+
+        /** @brief Sets all elements to v.
+         *
+         *  @param[in] v
+         *          Value of the elements.
+         */
+        void fill(const T &v);
+
+        /** @brief Exchanges the contents of two matrices. */
+        void swap(PackedMatrix &m);
+
+        /** @brief Offset of the element in row i and column j, with \f$ j \leq i \f$, within the packed triangle. */
+        static size_t index(size_t i,size_t j);
+};
+
+template<typename T>
+PackedMatrix<T>::PackedMatrix(): _N(0) {
+}
+
+template<typename T>
+PackedMatrix<T>::PackedMatrix(size_t N,const T &v): _data(N*(N+1)/2,v),_N(N) {
+}
+
+template<typename T>
+size_t PackedMatrix<T>::size() const {
+    return _N;
+}
+
+template<typename T>
+size_t PackedMatrix<T>::elements() const {
+    return _data.size();
+}
+
+template<typename T>
+T* PackedMatrix<T>::data() {
+    return _data.empty()?0:&_data[0];
+}
+
+template<typename T>
+const T* PackedMatrix<T>::data() const {
+    return _data.empty()?0:&_data[0];
+}
+
+template<typename T>
+T* PackedMatrix<T>::row(size_t i) {
+    return &_data[index(i,0)];
+}
+
+template<typename T>
+const T* PackedMatrix<T>::row(size_t i) const {
+    return &_data[index(i,0)];
+}
+
+template<typename T>
+T& PackedMatrix<T>::operator()(size_t i,size_t j) {
+    return i>=j?_data[index(i,j)]:_data[index(j,i)];
+}
+
+template<typename T>
+const T& PackedMatrix<T>::operator()(size_t i,size_t j) const {
+    return i>=j?_data[index(i,j)]:_data[index(j,i)];
+}
+
+template<typename T>
+void PackedMatrix<T>::resize(size_t N) {
+    // the leading rows of the packed triangle are exactly the smaller matrix
+    _data.resize(N*(N+1)/2,T(0));
+    _N=N;
+}
+
+template<typename T>
+void PackedMatrix<T>::reserve(size_t N) {
+    _data.reserve(N*(N+1)/2);
+}
+
+template<typename T>
+void PackedMatrix<T>::fill(const T &v) {
+    std::fill(_data.begin(),_data.end(),v);
+}
+
+template<typename T>
+void PackedMatrix<T>::swap(PackedMatrix &m) {
+    _data.swap(m._data);
+    std::swap(_N,m._N);
+}
+
+template<typename T>
+size_t PackedMatrix<T>::index(size_t i,size_t j) {
+    return i*(i+1)/2+j;
+}
+
+#endif // _PACKED_MATRIX_HPP_
@@ -15,8 +15,55 @@
 #include<iomanip>
 #include<algorithm>
 #include<vector>
+#include<stdint.h>
+#ifdef TKL_INSTRUMENT
+#include<atomic>
+#include<chrono>
+#endif
+#include"KernelTraits.hpp"
+#include"Matrix.hpp"
+#include"PackedMatrix.hpp"
+#include"TiledMatrix.hpp"
+#include"KTools.hpp"
 #include"RefKernel.hpp"
 
+/** @brief Counters and cumulative timers of a PathKernel instance, see PathKernel::getStats.
+ *
+ *  All values are zero unless the library is compiled with `TKL_INSTRUMENT` defined.
+ *  Times are wall-clock times summed over all the evaluations, hence over all the threads which evaluated the kernel concurrently.
+ */
+struct PathKernelStats {
+    /** @brief Whether the instrumentation is compiled in. */
+    bool enabled;
+
+    /** @brief Kernel evaluations on pairs of sequences (including self pairs and prefix tables). */
+    uint64_t pairs;
+
+    /** @brief Symbol kernel evaluations, i.e. entries of the symbol kernel matrices. */
+    uint64_t groundEvaluations;
+
+    /** @brief Times the weight matrix was extended (or loaded from disk). */
+    uint64_t wmatGrowths;
+
+    /** @brief Bytes added to the weight matrix by its extensions. */
+    uint64_t wmatBytes;
+
+    /** @brief Scratch buffers (symbol kernel matrices and prefix rows) allocated by the evaluations. */
+    uint64_t scratchAllocations;
+
+    /** @brief Bytes of the scratch buffers allocated by the evaluations. */
+    uint64_t scratchBytes;
+
+    /** @brief Seconds spent evaluating the symbol kernel. */
+    double groundSeconds;
+
+    /** @brief Seconds spent combining symbol kernel values with the weight matrix. */
+    double weightSeconds;
+
+    /** @brief Seconds spent extending (or loading) the weight matrix. */
+    double wmatSeconds;
+};
+
 /** @brief Path Kernel class
  *
  *  Computes the Path kernel on sequential inputs. Formally described for non-empty sequences as:
@@ -54,6 +101,13 @@
  *      k_{\omega}(i,j) = C_{HV} k_{\omega}(i-1,j) + C_{HV} k_{\omega}(i,j-1) + C_D k_{\omega}(i-1,j-1).
  *  \f]
  *
+ *  Instrumentation
+ *  ---------------
+ *
+ *  When the library is compiled with `TKL_INSTRUMENT` defined (e.g. `-DTKL_INSTRUMENT`), each instance counts its evaluations, symbol kernel evaluations, weight matrix growths and scratch allocations,
+ *  and accumulates the time spent in each phase, see getStats and PathKernelStats.
+ *  Counters are atomic, hence concurrent evaluations are counted correctly.
+ *  Otherwise, getStats returns zeros and the instrumentation is compiled out entirely.
  */
 template<typename SK>
 class PathKernel: public RefKernel<SK> {
@@ -82,6 +136,21 @@ class PathKernel: public RefKernel<SK> {
         /** @brief Write permission in the `wDir` folder. */
         bool wW;
 
+#ifdef TKL_INSTRUMENT
+        /** @brief Atomic counterpart of PathKernelStats, with times in nanoseconds. */
+        struct Counters {
+            std::atomic<uint64_t> pairs,groundEvaluations,wmatGrowths,wmatBytes,scratchAllocations,scratchBytes;
+            std::atomic<uint64_t> groundNanos,weightNanos,wmatNanos;
+
+            Counters();
+            /** @brief Copies current values, so that instances remain copyable. */
+            Counters(const Counters &c);
+        };
+
+        /** @brief Instrumentation counters, see getStats. */
+        Counters _stats;
+#endif
+
 	public: 
         /** @brief Default value for the `_CHV` attribute. */
         static const double _CHV_def;
@@ -142,11 +211,19 @@ class PathKernel: public RefKernel<SK> {
         *  @param[in] tlist
         *          List (std::vector) of sequential (std::vector of symbols) inputs.
         *  @param[out] km
-        *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+        *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
         */
         template<typename SYM_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,Matrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename SYM_TYPE,typename RET_TYPE>
         void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,std::vector<std::vector<RET_TYPE> > &km);
 
+        /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads, on up to ktools::numThreads() threads. */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,TiledMatrix<RET_TYPE> &km);
+
         /** @brief Evaluates the kernel function \f$ k_{PATH}(s_i,s_j) \f$ with \f$ s_i,s_j\in \f$ `slist`, and stores the result in reference matrix parameter km.
          *
          *  After evaluation, `km[i][j]` is set to the kernel value computed on `slist[i]` and `slist[j]`.
@@ -156,11 +233,23 @@ class PathKernel: public RefKernel<SK> {
          *  @param[in] slist
          *          List (std::vector) of sequential (std::vector of symbols) inputs.
          *  @param[out] km
-         *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+         *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
          */
         template<typename SYM_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,Matrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename SYM_TYPE,typename RET_TYPE>
         void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<std::vector<RET_TYPE> > &km);
 
+        /** @brief Same as the Matrix version, with the result stored in a packed symmetric matrix (PackedMatrix), which holds each value once. */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,PackedMatrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads, on up to ktools::numThreads() threads. */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,TiledMatrix<RET_TYPE> &km);
+
         /** @brief Evaluates the kernel function \f$ k_{PATH}(s_i,s_i) \f$ with \f$ s_i\in \f$ `slist`, and stores the result in reference vector parameter kv.
          *
          *  Equivalent to:
@@ -177,6 +266,68 @@ class PathKernel: public RefKernel<SK> {
         template<typename SYM_TYPE,typename RET_TYPE>
         void operator()(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<RET_TYPE> &kv);
 
+        /** @brief Evaluates the kernel function on all pairs of prefixes of \f$ s \f$ and \f$ t \f$, and stores the results in reference matrix parameter pkm.
+         *
+         *  After evaluation, `pkm[p][q]` is set to \f$ k_{PATH}(s_{1:p+1},t_{1:q+1}) \f$, i.e. the kernel value computed on the first `p+1` symbols of `s` and the first `q+1` symbols of `t`.
+         *  In particular, `pkm[s.size()-1][t.size()-1]` is equal to `(*this)(s,t,k)`.
+         *
+         *  The whole table is elaborated in a single traversal of the symbol kernel matrix, at a cost comparable to a single kernel evaluation.
+         *  The forward half of each value is a 2D prefix sum weighted by the weight matrix, while the backward half satisfies the same recurrence which defines the weight matrix:
+         *  \f[
+         *      G(p,q) = k_{\Sigma}(s_p,t_q) + C_{HV} G(p-1,q) + C_{HV} G(p,q-1) + C_D G(p-1,q-1).
+         *  \f]
+         *
+         *  @param[in] s
+         *          Sequential (std::vector of symbols) input.
+         *  @param[in] t
+         *          Sequential (std::vector of symbols) input.
+         *  @param[out] pkm
+         *          Reference to a matrix (Matrix) variable in which the prefix kernel values are stored.
+         */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void prefixes(const std::vector<SYM_TYPE> &s,const std::vector<SYM_TYPE> &t,Matrix<RET_TYPE> &pkm);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void prefixes(const std::vector<SYM_TYPE> &s,const std::vector<SYM_TYPE> &t,std::vector<std::vector<RET_TYPE> > &pkm);
+
+        /** @brief Evaluates the kernel function on all pairs of prefixes of the sequences in `slist` and `tlist`, and stores the results in reference matrix parameter km.
+         *
+         *  Rows enumerate the prefixes of `slist` sequence by sequence, and by increasing length within each sequence; columns do the same for `tlist`.
+         *  After evaluation, `km[os_i+p][ot_j+q]` is set to \f$ k_{PATH}(s_{i,1:p+1},t_{j,1:q+1}) \f$, where \f$ os_i \f$ (resp. \f$ ot_j \f$) is the sum of the lengths of the sequences preceding `slist[i]` (resp. `tlist[j]`).
+         *
+         *  Each pair of sequences is traversed once, as in prefixes(s,t,pkm).
+         *
+         *  @param[in] slist
+         *          List (std::vector) of sequential (std::vector of symbols) inputs.
+         *  @param[in] tlist
+         *          List (std::vector) of sequential (std::vector of symbols) inputs.
+         *  @param[out] km
+         *          Reference to a matrix (Matrix) variable in which the prefix kernel values are stored.
+         */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,Matrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,std::vector<std::vector<RET_TYPE> > &km);
+
+        /** @brief Evaluates the kernel function on all pairs of prefixes of the sequences in `slist`, and stores the results in reference matrix parameter km.
+         *
+         *  Equivalent, albeit optimised, to calling the more explicit version `prefixGram(slist,slist,km)`.
+         *
+         *  @param[in] slist
+         *          List (std::vector) of sequential (std::vector of symbols) inputs.
+         *  @param[out] km
+         *          Reference to a matrix (Matrix) variable in which the prefix kernel values are stored.
+         */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,Matrix<RET_TYPE> &km);
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename SYM_TYPE,typename RET_TYPE>
+        void prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<std::vector<RET_TYPE> > &km);
+
         /** @brief Updates the weight matrix to reach a specific dimension.
          *
          *  Does nothing if the weight matrix already has a dimension greater or equal to `dim`.
@@ -188,6 +339,16 @@ class PathKernel: public RefKernel<SK> {
          */
         void updateWMat(const size_t dim);
 
+        /** @brief Prepares the kernel for concurrent evaluations on the sequences in `slist`, see ktools::prepare.
+         *
+         *  Extends the weight matrix up to the length of the longest sequence, after which kernel evaluations on these sequences do not modify the instance.
+         *
+         *  @param[in] slist
+         *          List (std::vector) of sequential (std::vector of symbols) inputs.
+         */
+        template<typename SYM_TYPE>
+        void prepare(const std::vector<std::vector<SYM_TYPE> > &slist);
+
         /** @brief Returns a copy of the weight matrix.
          *
          *  @return
@@ -229,11 +390,71 @@ class PathKernel: public RefKernel<SK> {
          */
         bool loadWMat();
 
+        /** @brief Hash of the step weights and of the symbol kernel's fingerprint, which identifies the kernel function (see ktools::fingerprint). */
+        uint64_t fingerprint() const;
+
+        /** @brief Returns the instrumentation counters and timers of this instance, see PathKernelStats.
+         *
+         *  @return
+         *          Current values, all zero (and `enabled` false) unless compiled with `TKL_INSTRUMENT`.
+         */
+        PathKernelStats getStats() const;
+
+        /** @brief Resets the instrumentation counters and timers of this instance to zero. */
+        void resetStats();
+
     private:
         /** @brief Initializes the weight matrix to dimension 1x1.  */
         void initWMat();
+
+        /** @brief Current time in nanoseconds, or 0 without `TKL_INSTRUMENT`. */
+        static uint64_t tick();
+
+        /** @brief Records an evaluation with `ground` symbol kernel evaluations and `allocs` scratch buffers of `bytes` bytes in total,
+         *  whose symbol kernel phase spans `t0` to `t1` and weight phase spans `t1` to `t2` (no-op without `TKL_INSTRUMENT`).
+         */
+        void countEval(uint64_t ground,uint64_t allocs,uint64_t bytes,uint64_t t0,uint64_t t1,uint64_t t2);
+
+        /** @brief Records a weight matrix growth from dimension `from` to `to`, spanning `t0` to `t1` (no-op without `TKL_INSTRUMENT`). */
+        void countGrowth(size_t from,size_t to,uint64_t t0,uint64_t t1);
+
+        /** @brief Evaluates the kernel values on `slist` and `tlist` into `km`, given by its rows: a MatrixView, or a std::vector of row pointers (see ktools::detail::rowPointers). */
+        template<typename SYM_TYPE,typename ROWS>
+        void crossRows(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,const ROWS &km);
+
+        /** @brief Evaluates the kernel values on `slist` into `km`, given by its rows as in crossRows. */
+        template<typename SYM_TYPE,typename ROWS>
+        void gramRows(const std::vector<std::vector<SYM_TYPE> > &slist,const ROWS &km);
+
+        /** @brief Evaluates the prefix kernel values of `s` and `t` into the already sized `pkm`, given by its rows as in crossRows. */
+        template<typename RET_TYPE,typename SYM_TYPE,typename ROWS>
+        void prefixRows(const std::vector<SYM_TYPE> &s,const std::vector<SYM_TYPE> &t,const ROWS &pkm);
+
+        /** @brief Sets `os[i]` to the sum of the lengths of the sequences preceding `slist[i]`, for i up to `slist.size()`, and returns the total length. */
+        template<typename SYM_TYPE>
+        static size_t prefixOffsets(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<size_t> &os);
+
+        /** @brief Evaluates the prefix kernel values on `slist` and `tlist`, of prefix offsets `os` and `ot`, into `km`, given by its rows as in crossRows. */
+        template<typename RET_TYPE,typename SYM_TYPE,typename ROWS>
+        void prefixCrossRows(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,const std::vector<size_t> &os,const std::vector<size_t> &ot,const ROWS &km);
+
+        /** @brief Evaluates the prefix kernel values on `slist`, of prefix offsets `os`, into `km`, given by its rows as in crossRows. */
+        template<typename RET_TYPE,typename SYM_TYPE,typename ROWS>
+        void prefixGramRows(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<size_t> &os,const ROWS &km);
 }; 
 
+/** @brief Kernel Traits of the PathKernel.
+ *
+ *  The PathKernel is symmetric and positive semi-definite whenever the symbol kernel is.
+ */
+template<typename SK>
+struct KernelTraits<PathKernel<SK> > {
+    static const bool unitDiagonal=false;
+    static const bool stationary=false;
+    static const bool symmetric=KernelTraits<SK>::symmetric;
+    static const bool positive=KernelTraits<SK>::positive;
+};
+
 template<typename SK>
 const double PathKernel<SK>::_CHV_def   = 0.9/3.0;
 template<typename SK>
@@ -269,12 +490,14 @@ void PathKernel<SK>::operator()(const std::vector<SYM_TYPE> &s,const std::vector
     if(ls==0||lt==0)
         return;
     updateWMat(std::max(ls,lt));
-    std::vector<std::vector<RET_TYPE> > skm;
+    uint64_t t0=tick();
+    Matrix<RET_TYPE> skm;
     this->_sk(s,t,skm);
+    uint64_t t1=tick();
     k=RET_TYPE(0);
     for(size_t i=0;i<ls;i++)
-        for(size_t j=0;j<lt;j++)
-            k+=skm[i][j]*(wmat[i][j]+wmat[ls-i-1][lt-j-1])/2;
+        k+=RET_TYPE(ktools::detail::weightedSum(skm[i],wmat[i].data(),wmat[ls-i-1].data(),lt));
+    countEval(ls*lt,1,ls*lt*sizeof(RET_TYPE),t0,t1,tick());
 }
 
 template<typename SK>
@@ -284,48 +507,108 @@ void PathKernel<SK>::operator()(const std::vector<SYM_TYPE> &s,RET_TYPE &k) {
     if(ls==0)
         return;
     updateWMat(ls);
-    std::vector<std::vector<RET_TYPE> > skm;
+    uint64_t t0=tick();
+    Matrix<RET_TYPE> skm;
     this->_sk(s,skm);
+    uint64_t t1=tick();
     k=RET_TYPE(0);
-    for(size_t i=0;i<ls;i++) {
-        k+=skm[i][i]*wmat[i][i];
-        for(size_t j=i+1;j<ls;j++)
-            k+=2*skm[i][j]*(wmat[i][j]+wmat[ls-i-1][ls-j-1])/2;
+    // diagonal, and twice the upper triangle, whose row i mirrors row ls-i-1 of the weight matrix from column ls-i-2 down
+    for(size_t i=0;i<ls;i++)
+        k+=RET_TYPE(skm[i][i]*wmat[i][i]+2*ktools::detail::weightedSum(skm[i]+i+1,wmat[i].data()+i+1,wmat[ls-i-1].data(),ls-i-1));
+    countEval(ls*(ls+1)/2,1,ls*ls*sizeof(RET_TYPE),t0,t1,tick());
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename ROWS>
+void PathKernel<SK>::crossRows(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,const ROWS &km) {
+    for(size_t i=0;i<slist.size();i++)
+        for(size_t j=0;j<tlist.size();j++)
+            (*this)(slist[i],tlist[j],km[i][j]);
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename ROWS>
+void PathKernel<SK>::gramRows(const std::vector<std::vector<SYM_TYPE> > &slist,const ROWS &km) {
+    for(size_t i=0;i<slist.size();i++) {
+        (*this)(slist[i],km[i][i]);
+        for(size_t j=0;j<i;j++) {
+            (*this)(slist[i],slist[j],km[i][j]);
+            km[j][i]=km[i][j];
+        }
     }
 }
 
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,Matrix<RET_TYPE> &km) {
+    if(slist.empty()||tlist.empty())
+        throw "Empty sequence vector.";
+    km.resize(slist.size(),tlist.size());
+    crossRows(slist,tlist,km.view());
+}
+
 template<typename SK>
 template<typename SYM_TYPE,typename RET_TYPE>
 void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,std::vector<std::vector<RET_TYPE> > &km) {
-    size_t lsl=slist.size();
-    size_t ltl=tlist.size();
-    if(lsl==0||ltl==0)
+    if(slist.empty()||tlist.empty())
         throw "Empty sequence vector.";
-    km.resize(lsl);
-    for(size_t i=0;i<lsl;i++) {
-        km[i].resize(ltl);
-        for(size_t j=0;j<ltl;j++)
-            (*this)(slist[i],tlist[j],km[i][j]);
-    }
+    ktools::resizeMat(km,slist.size(),tlist.size());
+    std::vector<RET_TYPE*> rows;
+    ktools::detail::rowPointers(km,rows);
+    crossRows(slist,tlist,rows);
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,TiledMatrix<RET_TYPE> &km) {
+    if(slist.empty()||tlist.empty())
+        throw "Empty sequence vector.";
+    ktools::detail::gramTiles(*this,slist,tlist,km);
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,Matrix<RET_TYPE> &km) {
+    if(slist.empty())
+        throw "Empty sequence vector.";
+    km.resize(slist.size(),slist.size());
+    gramRows(slist,km.view());
 }
 
 template<typename SK>
 template<typename SYM_TYPE,typename RET_TYPE>
 void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<std::vector<RET_TYPE> > &km) {
+    if(slist.empty())
+        throw "Empty sequence vector.";
+    ktools::resizeMat(km,slist.size());
+    std::vector<RET_TYPE*> rows;
+    ktools::detail::rowPointers(km,rows);
+    gramRows(slist,rows);
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,PackedMatrix<RET_TYPE> &km) {
     size_t lsl=slist.size();
-    km.resize(lsl);
     if(lsl==0)
         throw "Empty sequence vector.";
+    km.resize(lsl);
     for(size_t i=0;i<lsl;i++) {
-        km[i].resize(lsl);
-        (*this)(slist[i],km[i][i]);
-        for(size_t j=0;j<i;j++) {
-            (*this)(slist[i],slist[j],km[i][j]);
-            km[j][i]=km[i][j];
-        }
+        RET_TYPE *ki=km.row(i);
+        (*this)(slist[i],ki[i]);
+        for(size_t j=0;j<i;j++)
+            (*this)(slist[i],slist[j],ki[j]);
     }
 }
 
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,TiledMatrix<RET_TYPE> &km) {
+    if(slist.empty())
+        throw "Empty sequence vector.";
+    ktools::detail::gramTiles(*this,slist,slist,km);
+}
+
 template<typename SK>
 template<typename SYM_TYPE,typename RET_TYPE>
 void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<RET_TYPE> &kv) {
@@ -335,9 +618,144 @@ void PathKernel<SK>::operator()(const std::vector<std::vector<SYM_TYPE> > &slist
         (*this)(slist[i],kv[i]);
 }
 
+template<typename SK>
+template<typename RET_TYPE,typename SYM_TYPE,typename ROWS>
+void PathKernel<SK>::prefixRows(const std::vector<SYM_TYPE> &s,const std::vector<SYM_TYPE> &t,const ROWS &pkm) {
+    size_t ls=s.size();
+    size_t lt=t.size();
+    if(ls==0||lt==0)
+        return;
+    updateWMat(std::max(ls,lt));
+    uint64_t t0=tick();
+    Matrix<RET_TYPE> skm;
+    this->_sk(s,t,skm);
+    uint64_t t1=tick();
+    // fw[q] holds the forward half of the current row, skm is overwritten by the backward half.
+    std::vector<RET_TYPE> fw(lt,RET_TYPE(0));
+    for(size_t p=0;p<ls;p++) {
+        RET_TYPE rowsum=RET_TYPE(0);
+        for(size_t q=0;q<lt;q++) {
+            rowsum+=skm[p][q]*wmat[p][q];
+            fw[q]+=rowsum;
+            if(p>0)
+                skm[p][q]+=_CHV*skm[p-1][q];
+            if(q>0)
+                skm[p][q]+=_CHV*skm[p][q-1];
+            if(p>0&&q>0)
+                skm[p][q]+=_CD*skm[p-1][q-1];
+            pkm[p][q]=(fw[q]+skm[p][q])/2;
+        }
+    }
+    countEval(ls*lt,2,(ls+1)*lt*sizeof(RET_TYPE),t0,t1,tick());
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::prefixes(const std::vector<SYM_TYPE> &s,const std::vector<SYM_TYPE> &t,Matrix<RET_TYPE> &pkm) {
+    pkm.resize(s.size(),t.size());
+    prefixRows<RET_TYPE>(s,t,pkm.view());
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::prefixes(const std::vector<SYM_TYPE> &s,const std::vector<SYM_TYPE> &t,std::vector<std::vector<RET_TYPE> > &pkm) {
+    ktools::resizeMat(pkm,s.size(),t.size());
+    std::vector<RET_TYPE*> rows;
+    ktools::detail::rowPointers(pkm,rows);
+    prefixRows<RET_TYPE>(s,t,rows);
+}
+
+template<typename SK>
+template<typename SYM_TYPE>
+size_t PathKernel<SK>::prefixOffsets(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<size_t> &os) {
+    os.assign(slist.size()+1,0);
+    for(size_t i=0;i<slist.size();i++)
+        os[i+1]=os[i]+slist[i].size();
+    return os.back();
+}
+
+template<typename SK>
+template<typename RET_TYPE,typename SYM_TYPE,typename ROWS>
+void PathKernel<SK>::prefixCrossRows(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,const std::vector<size_t> &os,const std::vector<size_t> &ot,const ROWS &km) {
+    std::vector<RET_TYPE*> sub;
+    for(size_t i=0;i<slist.size();i++) {
+        sub.resize(slist[i].size());
+        for(size_t j=0;j<tlist.size();j++) {
+            for(size_t p=0;p<sub.size();p++)
+                sub[p]=km[os[i]+p]+ot[j];
+            prefixRows<RET_TYPE>(slist[i],tlist[j],sub);
+        }
+    }
+}
+
+template<typename SK>
+template<typename RET_TYPE,typename SYM_TYPE,typename ROWS>
+void PathKernel<SK>::prefixGramRows(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<size_t> &os,const ROWS &km) {
+    std::vector<RET_TYPE*> sub;
+    for(size_t i=0;i<slist.size();i++) {
+        sub.resize(slist[i].size());
+        for(size_t j=0;j<=i;j++) {
+            for(size_t p=0;p<sub.size();p++)
+                sub[p]=km[os[i]+p]+os[j];
+            prefixRows<RET_TYPE>(slist[i],slist[j],sub);
+            // mirrors the block, or the lower half of a diagonal block
+            for(size_t p=0;p<sub.size();p++)
+                for(size_t q=0;q<(j<i?slist[j].size():p);q++)
+                    km[os[j]+q][os[i]+p]=sub[p][q];
+        }
+    }
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,Matrix<RET_TYPE> &km) {
+    if(slist.empty()||tlist.empty())
+        throw "Empty sequence vector.";
+    std::vector<size_t> os,ot;
+    km.resize(prefixOffsets(slist,os),prefixOffsets(tlist,ot));
+    prefixCrossRows<RET_TYPE>(slist,tlist,os,ot,km.view());
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,const std::vector<std::vector<SYM_TYPE> > &tlist,std::vector<std::vector<RET_TYPE> > &km) {
+    if(slist.empty()||tlist.empty())
+        throw "Empty sequence vector.";
+    std::vector<size_t> os,ot;
+    size_t rows=prefixOffsets(slist,os);
+    ktools::resizeMat(km,rows,prefixOffsets(tlist,ot));
+    std::vector<RET_TYPE*> kr;
+    ktools::detail::rowPointers(km,kr);
+    prefixCrossRows<RET_TYPE>(slist,tlist,os,ot,kr);
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,Matrix<RET_TYPE> &km) {
+    if(slist.empty())
+        throw "Empty sequence vector.";
+    std::vector<size_t> os;
+    size_t n=prefixOffsets(slist,os);
+    km.resize(n,n);
+    prefixGramRows<RET_TYPE>(slist,os,km.view());
+}
+
+template<typename SK>
+template<typename SYM_TYPE,typename RET_TYPE>
+void PathKernel<SK>::prefixGram(const std::vector<std::vector<SYM_TYPE> > &slist,std::vector<std::vector<RET_TYPE> > &km) {
+    if(slist.empty())
+        throw "Empty sequence vector.";
+    std::vector<size_t> os;
+    ktools::resizeMat(km,prefixOffsets(slist,os));
+    std::vector<RET_TYPE*> kr;
+    ktools::detail::rowPointers(km,kr);
+    prefixGramRows<RET_TYPE>(slist,os,kr);
+}
+
 template<typename SK>
 void PathKernel<SK>::updateWMat(const size_t dim) {
     if(dim>_DIM) {
+        uint64_t t0=tick();
         double temp;
         size_t old_dim=_DIM;
         _DIM=dim;
@@ -361,9 +779,19 @@ void PathKernel<SK>::updateWMat(const size_t dim) {
                 wmat[i][j]=wmat[j][i]=temp;
             }
         }
+        countGrowth(old_dim,_DIM,t0,tick());
     }
 }
 
+template<typename SK>
+template<typename SYM_TYPE>
+void PathKernel<SK>::prepare(const std::vector<std::vector<SYM_TYPE> > &slist) {
+    size_t maxlen=0;
+    for(size_t i=0;i<slist.size();i++)
+        maxlen=std::max(maxlen,slist[i].size());
+    updateWMat(maxlen);
+}
+
 template<typename SK>
 std::vector<std::vector<double> > PathKernel<SK>::getWMat() {
     return wmat;
@@ -417,6 +845,8 @@ bool PathKernel<SK>::loadWMat() {
             size_t N;
             ifs.read((char*)&N,sizeof(N));
             if(N>_DIM) {
+                uint64_t t0=tick();
+                size_t old_dim=_DIM;
                 loaded=true;
                 _DIM=N;
                 wmat.resize(_DIM);
@@ -425,6 +855,7 @@ bool PathKernel<SK>::loadWMat() {
                 for(size_t i=0;i<_DIM;i++)
                     for(size_t j=0;j<_DIM;j++)
                         ifs.read((char*)&wmat[i][j],sizeof(wmat[i][j]));
+                countGrowth(old_dim,_DIM,t0,tick());
             }
             ifs.close();
         }
@@ -432,5 +863,87 @@ bool PathKernel<SK>::loadWMat() {
     return loaded;
 }
 
+template<typename SK>
+uint64_t PathKernel<SK>::fingerprint() const {
+    return ktools::hash(_CD,ktools::hash(_CHV,ktools::fingerprint(this->_sk)));
+}
+
+#ifdef TKL_INSTRUMENT
+template<typename SK>
+PathKernel<SK>::Counters::Counters(): pairs(0),groundEvaluations(0),wmatGrowths(0),wmatBytes(0),scratchAllocations(0),scratchBytes(0),groundNanos(0),weightNanos(0),wmatNanos(0) {}
+
+template<typename SK>
+PathKernel<SK>::Counters::Counters(const Counters &c): pairs(c.pairs.load()),groundEvaluations(c.groundEvaluations.load()),wmatGrowths(c.wmatGrowths.load()),wmatBytes(c.wmatBytes.load()),
+    scratchAllocations(c.scratchAllocations.load()),scratchBytes(c.scratchBytes.load()),groundNanos(c.groundNanos.load()),weightNanos(c.weightNanos.load()),wmatNanos(c.wmatNanos.load()) {}
+#endif
+
+template<typename SK>
+inline uint64_t PathKernel<SK>::tick() {
+#ifdef TKL_INSTRUMENT
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#else
+    return 0;
+#endif
+}
+
+template<typename SK>
+inline void PathKernel<SK>::countEval(uint64_t ground,uint64_t allocs,uint64_t bytes,uint64_t t0,uint64_t t1,uint64_t t2) {
+#ifdef TKL_INSTRUMENT
+    // relaxed ordering: counters are only read as a whole by getStats, after the evaluations
+    _stats.pairs.fetch_add(1,std::memory_order_relaxed);
+    _stats.groundEvaluations.fetch_add(ground,std::memory_order_relaxed);
+    _stats.scratchAllocations.fetch_add(allocs,std::memory_order_relaxed);
+    _stats.scratchBytes.fetch_add(bytes,std::memory_order_relaxed);
+    _stats.groundNanos.fetch_add(t1-t0,std::memory_order_relaxed);
+    _stats.weightNanos.fetch_add(t2-t1,std::memory_order_relaxed);
+#else
+    (void)ground; (void)allocs; (void)bytes; (void)t0; (void)t1; (void)t2;
+#endif
+}
+
+template<typename SK>
+inline void PathKernel<SK>::countGrowth(size_t from,size_t to,uint64_t t0,uint64_t t1) {
+#ifdef TKL_INSTRUMENT
+    _stats.wmatGrowths.fetch_add(1,std::memory_order_relaxed);
+    _stats.wmatBytes.fetch_add((to*to-from*from)*sizeof(double),std::memory_order_relaxed);
+    _stats.wmatNanos.fetch_add(t1-t0,std::memory_order_relaxed);
+#else
+    (void)from; (void)to; (void)t0; (void)t1;
+#endif
+}
+
+template<typename SK>
+PathKernelStats PathKernel<SK>::getStats() const {
+    PathKernelStats st=PathKernelStats();
+#ifdef TKL_INSTRUMENT
+    st.enabled=true;
+    st.pairs=_stats.pairs.load();
+    st.groundEvaluations=_stats.groundEvaluations.load();
+    st.wmatGrowths=_stats.wmatGrowths.load();
+    st.wmatBytes=_stats.wmatBytes.load();
+    st.scratchAllocations=_stats.scratchAllocations.load();
+    st.scratchBytes=_stats.scratchBytes.load();
+    st.groundSeconds=_stats.groundNanos.load()*1e-9;
+    st.weightSeconds=_stats.weightNanos.load()*1e-9;
+    st.wmatSeconds=_stats.wmatNanos.load()*1e-9;
+#endif
+    return st;
+}
+
+template<typename SK>
+void PathKernel<SK>::resetStats() {
+#ifdef TKL_INSTRUMENT
+    _stats.pairs=0;
+    _stats.groundEvaluations=0;
+    _stats.wmatGrowths=0;
+    _stats.wmatBytes=0;
+    _stats.scratchAllocations=0;
+    _stats.scratchBytes=0;
+    _stats.groundNanos=0;
+    _stats.weightNanos=0;
+    _stats.wmatNanos=0;
+#endif
+}
+
 #endif // _PATH_KERNEL_HPP_
 
@@ -0,0 +1,225 @@
+#ifndef _QUANTILE_SKETCH_HPP_
+#define _QUANTILE_SKETCH_HPP_
+
+#include<algorithm>
+#include<cmath>
+#include<limits>
+#include<vector>
+#include<stdint.h>
+
+/** @brief Quantile Sketch class.
+ *
+ *  Streaming summary of a distribution of values, which answers quantile queries with a bounded relative error, in the style of DDSketch (Masson, Rim and Lee, 2019).
+ *
+ *  Values are counted in logarithmic buckets: a positive value \f$ x \f$ falls in bucket \f$ \lceil \log_\gamma x \rceil \f$, with \f$ \gamma = (1+a)/(1-a) \f$ for relative accuracy \f$ a \f$,
+ *  and any quantile is then estimated within a factor \f$ 1 \pm a \f$ of an actual value of the distribution of the corresponding rank.
+ *  Negative values are counted in mirrored buckets, and values of magnitude below MIN_VALUE are counted as zeros.
+ *
+ *  Memory depends on the range of the values, not on their number: a range of \f$ [x_{min},x_{max}] \f$ takes \f$ \log_\gamma (x_{max}/x_{min}) \f$ buckets, about 460 per decade at 1% accuracy.
+ *
+ *  Sketches with the same accuracy are mergeable, i.e. merging the sketches of two streams yields exactly the sketch of the joint stream.
+ *  Hence streams can be summarized in parallel, e.g. one sketch per thread, and merged afterwards.
+ */
+class QuantileSketch {
+    protected:
+        /** @brief Relative accuracy. */
+        double _accuracy;
+
+        /** @brief Logarithm of the bucket ratio \f$ \gamma \f$. */
+        double _logGamma;
+
+        /** @brief Bucket counts of positive values, from bucket _posOffset on. */
+        std::vector<uint64_t> _pos;
+
+        /** @brief Bucket counts of negative values (by magnitude), from bucket _negOffset on. */
+        std::vector<uint64_t> _neg;
+
+        /** @brief Index of the first bucket in _pos. */
+        int _posOffset;
+
+        /** @brief Index of the first bucket in _neg. */
+        int _negOffset;
+
+        /** @brief Number of zero values. */
+        uint64_t _zeros;
+
+        /** @brief Total number of values. */
+        uint64_t _count;
+
+        /** @brief Smallest value. */
+        double _min;
+
+        /** @brief Largest value. */
+        double _max;
+
+    public:
+        /** @brief Smallest magnitude of the values which are not counted as zeros. */
+        static constexpr double MIN_VALUE=1e-300;
+
+        /** @brief Initializes an empty sketch.
+         *
+         *  @param[in] accuracy
+         *          Relative accuracy of the quantiles, in \f$ (0,1) \f$ (defaults to 1%).
+         */
+        QuantileSketch(double accuracy=0.01);
+
+        /** @brief Adds value x, n times. */
+        void add(double x,uint64_t n=1);
+
+        /** @brief Adds all the values of another sketch with the same accuracy. */
+        void merge(const QuantileSketch &s);
+
+        /** @brief Estimates the q-quantile of the values.
+         *
+         *  @param[in] q
+         *          Quantile, in \f$ [0,1] \f$ (e.g. 0.5 for the median).
+         *  @returns
+         *          A value within relative accuracy of the value of rank \f$ \lfloor q(n-1) \rfloor \f$ among the n values, in increasing order.
+         */
+        double quantile(double q) const;
+
+        /** @brief Number of values. */
+        uint64_t count() const;
+
+        /** @brief Smallest value (exact). */
+        double min() const;
+
+        /** @brief Largest value (exact). */
+        double max() const;
+
+        /** @brief Relative accuracy. */
+        double accuracy() const;
+
+        /** @brief Removes all the values. */
+        void clear();
+
+    private:
+        /** @brief Adds n to bucket i of a store which starts at bucket offset. */
+        static void addBucket(std::vector<uint64_t> &store,int &offset,int i,uint64_t n);
+
+        /** @brief Bucket of magnitude x. */
+        int bucket(double x) const;
+
+        /** @brief Representative magnitude of bucket i. */
+        double value(int i) const;
+};
+
+constexpr double QuantileSketch::MIN_VALUE;
+
+inline QuantileSketch::QuantileSketch(double accuracy): _accuracy(accuracy),_posOffset(0),_negOffset(0),_zeros(0),_count(0) {
+    if(!(accuracy>0&&accuracy<1))
+        throw "Sketch accuracy must be in between 0 and 1.";
+    _logGamma=std::log((1+accuracy)/(1-accuracy));
+    clear();
+}
+
+inline int QuantileSketch::bucket(double x) const {
+    return int(std::ceil(std::log(x)/_logGamma));
+}
+
+inline double QuantileSketch::value(int i) const {
+    // midpoint, in relative terms, of (gamma^(i-1),gamma^i]
+    double gamma=std::exp(_logGamma);
+    return 2*std::exp(i*_logGamma)/(1+gamma);
+}
+
+inline void QuantileSketch::addBucket(std::vector<uint64_t> &store,int &offset,int i,uint64_t n) {
+    if(store.empty()) {
+        store.assign(1,0);
+        offset=i;
+    }
+    else if(i<offset) {
+        store.insert(store.begin(),size_t(offset-i),0);
+        offset=i;
+    }
+    else if(size_t(i-offset)>=store.size())
+        store.resize(size_t(i-offset)+1,0);
+    store[i-offset]+=n;
+}
+
+inline void QuantileSketch::add(double x,uint64_t n) {
+    if(n==0||std::isnan(x))
+        return;
+    if(x>MIN_VALUE)
+        addBucket(_pos,_posOffset,bucket(x),n);
+    else if(x<-MIN_VALUE)
+        addBucket(_neg,_negOffset,bucket(-x),n);
+    else
+        _zeros+=n;
+    _count+=n;
+    _min=std::min(_min,x);
+    _max=std::max(_max,x);
+}
+
+inline void QuantileSketch::merge(const QuantileSketch &s) {
+    if(s._accuracy!=_accuracy)
+        throw "Sketches have different accuracies.";
+    for(size_t b=0;b<s._pos.size();b++)
+        if(s._pos[b]>0)
+            addBucket(_pos,_posOffset,s._posOffset+int(b),s._pos[b]);
+    for(size_t b=0;b<s._neg.size();b++)
+        if(s._neg[b]>0)
+            addBucket(_neg,_negOffset,s._negOffset+int(b),s._neg[b]);
+    _zeros+=s._zeros;
+    _count+=s._count;
+    _min=std::min(_min,s._min);
+    _max=std::max(_max,s._max);
+}
+
+inline double QuantileSketch::quantile(double q) const {
+    if(_count==0)
+        throw "Sketch is empty.";
+    if(q<0||q>1)
+        throw "Quantile must be in between 0 and 1.";
+    uint64_t rank=uint64_t(q*double(_count-1));
+    uint64_t seen=0;
+    double v=0;
+    bool found=false;
+    // negative values, from the largest magnitude down
+    for(size_t b=_neg.size();b-->0&&!found;) {
+        seen+=_neg[b];
+        if(seen>rank) {
+            v=-value(_negOffset+int(b));
+            found=true;
+        }
+    }
+    if(!found) {
+        seen+=_zeros;
+        found=seen>rank;
+    }
+    for(size_t b=0;b<_pos.size()&&!found;b++) {
+        seen+=_pos[b];
+        if(seen>rank) {
+            v=value(_posOffset+int(b));
+            found=true;
+        }
+    }
+    return std::min(std::max(v,_min),_max);
+}
+
+inline uint64_t QuantileSketch::count() const {
+    return _count;
+}
+
+inline double QuantileSketch::min() const {
+    return _min;
+}
+
+inline double QuantileSketch::max() const {
+    return _max;
+}
+
+inline double QuantileSketch::accuracy() const {
+    return _accuracy;
+}
+
+inline void QuantileSketch::clear() {
+    _pos.clear();
+    _neg.clear();
+    _posOffset=_negOffset=0;
+    _zeros=_count=0;
+    _min=std::numeric_limits<double>::infinity();
+    _max=-std::numeric_limits<double>::infinity();
+}
+
+#endif // _QUANTILE_SKETCH_HPP_
@@ -3,6 +3,11 @@
 
 #include<cmath>
 #include<vector>
+#include"KernelTraits.hpp"
+#include"Matrix.hpp"
+#include"PackedMatrix.hpp"
+#include"TiledMatrix.hpp"
+#include"KTools.hpp"
 
 /** @brief Radial Basis Function Kernel class
  *
@@ -28,6 +33,18 @@ class RbfKernel {
          */
         const double tsigma;
 
+        /** @brief Verifies that `xlist` holds at least one vector, and that its vectors are non-empty and of equal size. */
+        template<typename VEC_TYPE>
+        static void checkList(const std::vector<std::vector<VEC_TYPE> > &xlist);
+
+        /** @brief Evaluates the kernel values on `xlist` and `ylist` into `km`, given by its rows: a MatrixView, or a std::vector of row pointers (see ktools::detail::rowPointers). */
+        template<typename VEC_TYPE,typename ROWS>
+        void crossRows(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,const ROWS &km) const;
+
+        /** @brief Evaluates the kernel values on `xlist` into `km`, given by its rows as in crossRows. */
+        template<typename VEC_TYPE,typename ROWS>
+        void gramRows(const std::vector<std::vector<VEC_TYPE> > &xlist,const ROWS &km) const;
+
     public:
         /** @brief Initiates tsigma to \f$ -\frac{1}{2\sigma^2} \f$.
          *
@@ -39,6 +56,9 @@ class RbfKernel {
         /** @brief Empty virtual Destructor. Good habit for base classes. */
         virtual ~RbfKernel();
 
+        /** @brief Hash of the parameter \f$\sigma\f$, which identifies the kernel function (see ktools::fingerprint). */
+        uint64_t fingerprint() const;
+
         /** @brief Evaluates the kernel function \f$ k_{RBF}(x,y) \f$ and stores the result in reference parameter k.
          *
          *  @param[in] x
@@ -73,11 +93,19 @@ class RbfKernel {
          *  @param[in] ylist
          *          List (std::vector) of vectorial inputs.
          *  @param[out] km
-         *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+         *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
          */
         template<typename VEC_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,Matrix<RET_TYPE> &km) const;
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename VEC_TYPE,typename RET_TYPE>
         void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,std::vector<std::vector<RET_TYPE> > &km) const;
 
+        /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads, on up to ktools::numThreads() threads. */
+        template<typename VEC_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,TiledMatrix<RET_TYPE> &km) const;
+
         /** @brief Evaluates the kernel function \f$ k_{RBF}(x_i,x_j) \f$ with \f$ x_i,x_j\in \f$ `xlist`, and stores the result in reference matrix parameter km.
          *
          *  After evaluation, `km[i][j]` is set to the kernel value computed on `xlist[i]` and `xlist[j]`.
@@ -87,11 +115,23 @@ class RbfKernel {
          *  @param[in] xlist
          *          List (std::vector) of vectorial inputs.
          *  @param[out] km
-         *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+         *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
          */
         template<typename VEC_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,Matrix<RET_TYPE> &km) const;
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename VEC_TYPE,typename RET_TYPE>
         void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,std::vector<std::vector<RET_TYPE> > &km) const;
 
+        /** @brief Same as the Matrix version, with the result stored in a packed symmetric matrix (PackedMatrix), which holds each value once. */
+        template<typename VEC_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,PackedMatrix<RET_TYPE> &km) const;
+
+        /** @brief Same as the Matrix version, with the result stored in a tiled out-of-core matrix (TiledMatrix) of matching size, filled tile by tile in tile row order, through the list overloads, on up to ktools::numThreads() threads. */
+        template<typename VEC_TYPE,typename RET_TYPE>
+        void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,TiledMatrix<RET_TYPE> &km) const;
+
         /** @brief Evaluates the kernel function \f$ k_{RBF}(x_i,x_i) \f$ with \f$ x_i\in \f$ `xlist`, and stores the result in reference vector parameter kv.
          *
          *  Equivalent to:
@@ -109,12 +149,28 @@ class RbfKernel {
         void operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,std::vector<RET_TYPE> &kv) const;
 };
 
-RbfKernel::RbfKernel(double sigma): tsigma(-1/(2*sigma*sigma)) {
+/** @brief Kernel Traits of the RbfKernel.
+ *
+ *  The RbfKernel is stationary, positive semi-definite and has unit diagonal.
+ */
+template<>
+struct KernelTraits<RbfKernel> {
+    static const bool unitDiagonal=true;
+    static const bool stationary=true;
+    static const bool symmetric=true;
+    static const bool positive=true;
+};
+
+inline RbfKernel::RbfKernel(double sigma): tsigma(-1/(2*sigma*sigma)) {
     if(sigma==0)
         throw "Input \"sigma\" is 0.";
 }
 
-RbfKernel::~RbfKernel() {
+inline RbfKernel::~RbfKernel() {
+}
+
+inline uint64_t RbfKernel::fingerprint() const {
+    return ktools::hash(tsigma);
 }
 
 template<typename VEC_TYPE,typename RET_TYPE>
@@ -123,9 +179,7 @@ void RbfKernel::operator()(const std::vector<VEC_TYPE> &x,const std::vector<VEC_
         throw "Input vector is empty.";
     if(x.size()!=y.size())
         throw "Input vectors do not have equal size.";
-    double sq_norm=0;
-    for(size_t i=0;i<x.size();i++)
-        sq_norm+=(x[i]-y[i])*(x[i]-y[i]);
+    double sq_norm=ktools::detail::sqDistance(x.data(),y.data(),x.size());
     k=RET_TYPE(exp(tsigma*sq_norm));
 }
 
@@ -142,29 +196,89 @@ void RbfKernel::operator()(const std::vector<VEC_TYPE> &x,RET_TYPE &k) const {
     }
 }
 
-template<typename VEC_TYPE,typename RET_TYPE>
-void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,std::vector<std::vector<RET_TYPE> > &km) const {
-    size_t lxl=xlist.size();
-    size_t lyl=ylist.size();
-    if(lxl==0||lyl==0)
+template<typename VEC_TYPE>
+void RbfKernel::checkList(const std::vector<std::vector<VEC_TYPE> > &xlist) {
+    if(xlist.empty())
         throw "Input set doesn't contain any vector.";
     size_t dim=xlist[0].size();
-    for(size_t i=0;i<lxl;i++) {
+    for(size_t i=0;i<xlist.size();i++) {
         if(xlist[i].empty())
             throw "Input vector is empty.";
         if(xlist[i].size()!=dim)
             throw "Input vectors do not have equal size.";
     }
-    km.resize(lxl);
-    for(size_t i=0;i<lxl;i++) {
-        km[i].resize(lyl);
-        for(size_t j=0;j<lyl;j++)
+}
+
+template<typename VEC_TYPE,typename ROWS>
+void RbfKernel::crossRows(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,const ROWS &km) const {
+    for(size_t i=0;i<xlist.size();i++)
+        for(size_t j=0;j<ylist.size();j++)
             (*this)(xlist[i],ylist[j],km[i][j]);
+}
+
+template<typename VEC_TYPE,typename ROWS>
+void RbfKernel::gramRows(const std::vector<std::vector<VEC_TYPE> > &xlist,const ROWS &km) const {
+    for(size_t i=0;i<xlist.size();i++) {
+        (*this)(xlist[i],km[i][i]);
+        for(size_t j=0;j<i;j++) {
+            (*this)(xlist[i],xlist[j],km[i][j]);
+            km[j][i]=km[i][j];
+        }
     }
 }
 
+template<typename VEC_TYPE,typename RET_TYPE>
+void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,Matrix<RET_TYPE> &km) const {
+    if(ylist.empty())
+        throw "Input set doesn't contain any vector.";
+    checkList(xlist);
+    km.resize(xlist.size(),ylist.size());
+    crossRows(xlist,ylist,km.view());
+}
+
+template<typename VEC_TYPE,typename RET_TYPE>
+void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,std::vector<std::vector<RET_TYPE> > &km) const {
+    if(ylist.empty())
+        throw "Input set doesn't contain any vector.";
+    checkList(xlist);
+    ktools::resizeMat(km,xlist.size(),ylist.size());
+    std::vector<RET_TYPE*> rows;
+    ktools::detail::rowPointers(km,rows);
+    crossRows(xlist,ylist,rows);
+}
+
+template<typename VEC_TYPE,typename RET_TYPE>
+void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,const std::vector<std::vector<VEC_TYPE> > &ylist,TiledMatrix<RET_TYPE> &km) const {
+    if(xlist.empty()||ylist.empty())
+        throw "Input set doesn't contain any vector.";
+    size_t dim=xlist[0].size();
+    for(size_t i=0;i<xlist.size();i++) {
+        if(xlist[i].empty())
+            throw "Input vector is empty.";
+        if(xlist[i].size()!=dim)
+            throw "Input vectors do not have equal size.";
+    }
+    ktools::detail::gramTiles(*this,xlist,ylist,km);
+}
+
+template<typename VEC_TYPE,typename RET_TYPE>
+void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,Matrix<RET_TYPE> &km) const {
+    checkList(xlist);
+    km.resize(xlist.size(),xlist.size());
+    gramRows(xlist,km.view());
+}
+
 template<typename VEC_TYPE,typename RET_TYPE>
 void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,std::vector<std::vector<RET_TYPE> > &km) const {
+    checkList(xlist);
+    ktools::resizeMat(km,xlist.size());
+    std::vector<RET_TYPE*> rows;
+    ktools::detail::rowPointers(km,rows);
+    gramRows(xlist,rows);
+}
+
+template<typename VEC_TYPE,typename RET_TYPE>
+void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,PackedMatrix<RET_TYPE> &km) const {
     size_t lxl=xlist.size();
     if(lxl==0)
         throw "Input set doesn't contain any vector.";
@@ -177,19 +291,32 @@ void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,std:
     }
     km.resize(lxl);
     for(size_t i=0;i<lxl;i++) {
-        km[i].resize(lxl);
-        (*this)(xlist[i],km[i][i]);
-        for(size_t j=0;j<i;j++) {
-            (*this)(xlist[i],xlist[j],km[i][j]);
-            km[j][i]=km[i][j];
-        }
+        RET_TYPE *ki=km.row(i);
+        (*this)(xlist[i],ki[i]);
+        for(size_t j=0;j<i;j++)
+            (*this)(xlist[i],xlist[j],ki[j]);
     }
 }
 
+template<typename VEC_TYPE,typename RET_TYPE>
+void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,TiledMatrix<RET_TYPE> &km) const {
+    size_t lxl=xlist.size();
+    if(lxl==0)
+        throw "Input set doesn't contain any vector.";
+    size_t dim=xlist[0].size();
+    for(size_t i=0;i<lxl;i++) {
+        if(xlist[i].size()==0)
+            throw "Input vector is empty.";
+        if(xlist[i].size()!=dim)
+            throw "Input vectors do not have equal size.";
+    }
+    ktools::detail::gramTiles(*this,xlist,xlist,km);
+}
+
 template<typename VEC_TYPE,typename RET_TYPE>
 void RbfKernel::operator()(const std::vector<std::vector<VEC_TYPE> > &xlist,std::vector<RET_TYPE> &kv) const {
     size_t lxl=xlist.size();
-    if(lxl!=0)
+    if(lxl==0)
         throw "Input set doesn't contain any vector.";
     size_t dim=xlist[0].size();
     for(size_t i=0;i<lxl;i++) {
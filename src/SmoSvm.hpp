@@ -0,0 +1,505 @@
+#ifndef _SMO_SVM_HPP_
+#define _SMO_SVM_HPP_
+
+#include<algorithm>
+#include<limits>
+#include<vector>
+#include"KernelRowCache.hpp"
+#include"RefKernel.hpp"
+#include"KTools.hpp"
+
+/** @brief SMO Support Vector Machine class.
+ *
+ *  Trains a binary C-SVM classifier with kernel \f$ SK \f$, i.e. solves the dual problem
+ *  \f[
+ *      \min_\alpha \frac{1}{2} \sum_{i,j} \alpha_i \alpha_j y_i y_j k_{SK}(x_i,x_j) - \sum_i \alpha_i \quad \textrm{s.t.} \quad 0 \leq \alpha_i \leq C, \quad \sum_i y_i \alpha_i = 0
+ *  \f]
+ *  by Sequential Minimal Optimization, with the second order working set selection of Fan, Chen and Lin (2005) and with shrinking, as in LIBSVM.
+ *  The decision function is then
+ *  \f[
+ *      f(x) = \sum_i \alpha_i y_i k_{SK}(x_i,x) - \rho \,.
+ *  \f]
+ *
+ *  The kernel matrix is never materialized: kernel rows are computed on demand, and kept in a KernelRowCache within a budget of bytes.
+ *  Training on large sets thus takes memory linear in the number of inputs, plus the cache budget.
+ *
+ *  This class extends RefKernel, and thus requires the specification of an internal kernel instance.
+ *
+ *  Data Inputs
+ *  -----------
+ *
+ *  The training set is held by reference, and must therefore outlive the class instance and not be modified.
+ *  Labels are binary: positive labels denote one class (\f$ y_i = +1 \f$), and all other labels the other class (\f$ y_i = -1 \f$).
+ */
+template<typename SK,typename DATA_TYPE>
+class SmoSvm: public RefKernel<SK> {
+    protected:
+        /** @brief The training set. */
+        const std::vector<DATA_TYPE> &_xlist;
+
+        /** @brief Binary labels of the training set, \f$ y_i = \pm 1 \f$. */
+        std::vector<double> _y;
+
+        /** @brief Upper bound of the dual variables. */
+        double _C;
+
+        /** @brief Tolerance of the stopping criterion. */
+        double _eps;
+
+        /** @brief Shrink the active set during training. */
+        bool _shrinking;
+
+        /** @brief Cache of kernel rows. */
+        KernelRowCache<SK,DATA_TYPE> _cache;
+
+        /** @brief Dual variables. */
+        std::vector<double> _alpha;
+
+        /** @brief Offset of the decision function. */
+        double _rho;
+
+        /** @brief Number of iterations of the last training. */
+        size_t _iterations;
+
+        /** @brief Gradient of the dual objective. */
+        std::vector<double> _G;
+
+        /** @brief Contribution of the dual variables at the upper bound to the gradient, used to reconstruct the gradient of shrunk variables. */
+        std::vector<double> _Gbar;
+
+        /** @brief Indexes of the active (non-shrunk) variables. */
+        std::vector<size_t> _active;
+
+    public:
+        /** @brief Curvature used in place of non-positive ones, in the working set selection and in the updates. */
+        static constexpr double TAU=1e-12;
+
+        /** @brief Initializes the internal kernel reference and the row cache.
+         *
+         *  @param[in] sk
+         *          Kernel instance.
+         *  @param[in] xlist
+         *          List (std::vector) of training inputs.
+         *  @param[in] labels
+         *          Labels of the training inputs.
+         *  @param[in] C
+         *          Upper bound of the dual variables, i.e. cost of misclassification.
+         *  @param[in] bytes
+         *          Budget of bytes for the cached kernel rows.
+         *  @param[in] eps
+         *          Tolerance of the stopping criterion, on the maximal violation of the optimality conditions.
+         *  @param[in] shrinking
+         *          If true, variables which are likely to stay at their bounds are temporarily removed from the optimization.
+         */
+        SmoSvm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<double> &labels,double C=1,size_t bytes=size_t(256)<<20,double eps=1e-3,bool shrinking=true);
+
+        /** @brief Trains the classifier.
+         *
+         *  @param[in] maxIterations
+         *          Maximum number of iterations, or 0 for no limit.
+         *  @return
+         *          The number of iterations.
+         */
+        size_t train(size_t maxIterations=0);
+
+        /** @brief Evaluates the decision function on query x.
+         *
+         *  @param[in] x
+         *          Query input.
+         *  @return
+         *          The value of the decision function, positive for the class of positive labels.
+         */
+        double decision(const DATA_TYPE &x) const;
+
+        /** @brief Evaluates the decision function on each query of qlist, in parallel, and stores the results in reference vector parameter f.
+         *
+         *  The kernel instance is prepared for qlist first (see ktools::prepare), then evaluated concurrently.
+         *
+         *  @param[in] qlist
+         *          List (std::vector) of query inputs.
+         *  @param[out] f
+         *          Reference to a vector (std::vector) variable in which the values of the decision function are stored.
+         */
+        void decision(const std::vector<DATA_TYPE> &qlist,std::vector<double> &f) const;
+
+        /** @brief Dual variables \f$ \alpha_i \f$. */
+        const std::vector<double>& alphas() const;
+
+        /** @brief Offset \f$ \rho \f$ of the decision function. */
+        double rho() const;
+
+        /** @brief Indexes of the support vectors, i.e. of the inputs with \f$ \alpha_i > 0 \f$.
+         *
+         *  @param[out] indexes
+         *          Reference to a vector (std::vector) variable in which the indexes are stored.
+         */
+        void supportVectors(std::vector<size_t> &indexes) const;
+
+        /** @brief Number of iterations of the last training. */
+        size_t iterations() const;
+
+        /** @brief Cache of kernel rows, e.g. for its statistics. */
+        const KernelRowCache<SK,DATA_TYPE>& cache() const;
+
+    private:
+        /** @brief Dual variable i is at its upper bound. */
+        bool isUpper(size_t i) const;
+
+        /** @brief Dual variable i is at its lower bound. */
+        bool isLower(size_t i) const;
+
+        /** @brief Selects the working set (i,j) among the active variables, and fetches the kernel row of i. Returns false if optimal within tolerance. */
+        bool select(size_t &i,size_t &j,typename KernelRowCache<SK,DATA_TYPE>::Row &ki);
+
+        /** @brief Removes the variables likely to stay at their bounds from the active set. */
+        void shrink(bool &unshrink);
+
+        /** @brief Recomputes the gradient of the shrunk variables, and makes all variables active. */
+        void reconstruct();
+
+        /** @brief Computes the offset of the decision function from the gradient. */
+        void computeRho();
+};
+
+template<typename SK,typename DATA_TYPE>
+constexpr double SmoSvm<SK,DATA_TYPE>::TAU;
+
+template<typename SK,typename DATA_TYPE>
+SmoSvm<SK,DATA_TYPE>::SmoSvm(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::vector<double> &labels,double C,size_t bytes,double eps,bool shrinking): RefKernel<SK>(sk),_xlist(xlist),_C(C),_eps(eps),_shrinking(shrinking),_cache(sk,xlist,bytes),_alpha(xlist.size(),0),_rho(0),_iterations(0) {
+    if(labels.size()!=xlist.size())
+        throw "Label vector size does not match the input set size.";
+    if(C<=0)
+        throw "Upper bound C must be positive.";
+    _y.resize(labels.size());
+    for(size_t i=0;i<labels.size();i++)
+        _y[i]=labels[i]>0?1:-1;
+}
+
+template<typename SK,typename DATA_TYPE>
+bool SmoSvm<SK,DATA_TYPE>::isUpper(size_t i) const {
+    return _alpha[i]>=_C;
+}
+
+template<typename SK,typename DATA_TYPE>
+bool SmoSvm<SK,DATA_TYPE>::isLower(size_t i) const {
+    return _alpha[i]<=0;
+}
+
+template<typename SK,typename DATA_TYPE>
+size_t SmoSvm<SK,DATA_TYPE>::train(size_t maxIterations) {
+    size_t N=_xlist.size();
+    const std::vector<double> &kd=_cache.diagonal();
+    _alpha.assign(N,0);
+    _G.assign(N,-1);
+    _Gbar.assign(N,0);
+    _active.resize(N);
+    for(size_t i=0;i<N;i++)
+        _active[i]=i;
+    _iterations=0;
+    size_t counter=std::min(N,size_t(1000))+1;
+    bool unshrink=false;
+    while(N>0&&(maxIterations==0||_iterations<maxIterations)) {
+        if(--counter==0) {
+            counter=std::min(N,size_t(1000));
+            if(_shrinking)
+                shrink(unshrink);
+        }
+        size_t i,j;
+        typename KernelRowCache<SK,DATA_TYPE>::Row ki;
+        if(!select(i,j,ki)) {
+            if(_active.size()==N)
+                break;
+            // optimal on the active set: verify on the whole set
+            reconstruct();
+            counter=1;
+            if(!select(i,j,ki))
+                break;
+        }
+        _iterations++;
+        typename KernelRowCache<SK,DATA_TYPE>::Row kj=_cache.row(j);
+        const std::vector<double> &Ki=*ki,&Kj=*kj;
+        double Qij=_y[i]*_y[j]*Ki[j];
+        double ai=_alpha[i],aj=_alpha[j];
+        bool ui=isUpper(i),uj=isUpper(j);
+        if(_y[i]!=_y[j]) {
+            double quad=std::max(kd[i]+kd[j]+2*Qij,TAU);
+            double delta=(-_G[i]-_G[j])/quad;
+            double diff=ai-aj;
+            ai+=delta;
+            aj+=delta;
+            if(diff>0) {
+                if(aj<0) {
+                    aj=0;
+                    ai=diff;
+                }
+            }
+            else if(ai<0) {
+                ai=0;
+                aj=-diff;
+            }
+            if(diff>0) {
+                if(ai>_C) {
+                    ai=_C;
+                    aj=_C-diff;
+                }
+            }
+            else if(aj>_C) {
+                aj=_C;
+                ai=_C+diff;
+            }
+        }
+        else {
+            double quad=std::max(kd[i]+kd[j]-2*Qij,TAU);
+            double delta=(_G[i]-_G[j])/quad;
+            double sum=ai+aj;
+            ai-=delta;
+            aj+=delta;
+            if(sum>_C) {
+                if(ai>_C) {
+                    ai=_C;
+                    aj=sum-_C;
+                }
+                if(aj>_C) {
+                    aj=_C;
+                    ai=sum-_C;
+                }
+            }
+            else {
+                if(aj<0) {
+                    aj=0;
+                    ai=sum;
+                }
+                if(ai<0) {
+                    ai=0;
+                    aj=sum;
+                }
+            }
+        }
+        double dai=(ai-_alpha[i])*_y[i],daj=(aj-_alpha[j])*_y[j];
+        _alpha[i]=ai;
+        _alpha[j]=aj;
+        for(size_t t=0;t<_active.size();t++) {
+            size_t k=_active[t];
+            _G[k]+=_y[k]*(Ki[k]*dai+Kj[k]*daj);
+        }
+        if(ui!=isUpper(i)) {
+            double c=ui?-_C*_y[i]:_C*_y[i];
+            for(size_t k=0;k<N;k++)
+                _Gbar[k]+=c*_y[k]*Ki[k];
+        }
+        if(uj!=isUpper(j)) {
+            double c=uj?-_C*_y[j]:_C*_y[j];
+            for(size_t k=0;k<N;k++)
+                _Gbar[k]+=c*_y[k]*Kj[k];
+        }
+    }
+    reconstruct();
+    computeRho();
+    _G.clear();
+    _Gbar.clear();
+    _active.clear();
+    return _iterations;
+}
+
+template<typename SK,typename DATA_TYPE>
+bool SmoSvm<SK,DATA_TYPE>::select(size_t &i,size_t &j,typename KernelRowCache<SK,DATA_TYPE>::Row &ki) {
+    const std::vector<double> &kd=_cache.diagonal();
+    double inf=std::numeric_limits<double>::infinity();
+    double Gmax=-inf,Gmax2=-inf,objMin=inf;
+    i=j=_xlist.size();
+    // i maximizes the violation -y_i G_i among the variables which may increase along y_i
+    for(size_t t=0;t<_active.size();t++) {
+        size_t k=_active[t];
+        if(_y[k]>0) {
+            if(!isUpper(k)&&-_G[k]>=Gmax) {
+                Gmax=-_G[k];
+                i=k;
+            }
+        }
+        else if(!isLower(k)&&_G[k]>=Gmax) {
+            Gmax=_G[k];
+            i=k;
+        }
+    }
+    if(i==_xlist.size())
+        return false;
+    ki=_cache.row(i);
+    const std::vector<double> &Ki=*ki;
+    // j minimizes the second order decrease of the objective
+    for(size_t t=0;t<_active.size();t++) {
+        size_t k=_active[t];
+        double gradDiff;
+        if(_y[k]>0) {
+            if(isLower(k))
+                continue;
+            Gmax2=std::max(Gmax2,_G[k]);
+            gradDiff=Gmax+_G[k];
+        }
+        else {
+            if(isUpper(k))
+                continue;
+            Gmax2=std::max(Gmax2,-_G[k]);
+            gradDiff=Gmax-_G[k];
+        }
+        if(gradDiff>0) {
+            double quad=kd[i]+kd[k]-2*Ki[k];
+            double obj=-gradDiff*gradDiff/(quad>0?quad:TAU);
+            if(obj<=objMin) {
+                objMin=obj;
+                j=k;
+            }
+        }
+    }
+    return Gmax+Gmax2>=_eps&&j!=_xlist.size();
+}
+
+template<typename SK,typename DATA_TYPE>
+void SmoSvm<SK,DATA_TYPE>::shrink(bool &unshrink) {
+    double inf=std::numeric_limits<double>::infinity();
+    double Gmax1=-inf,Gmax2=-inf;
+    for(size_t t=0;t<_active.size();t++) {
+        size_t k=_active[t];
+        if(_y[k]>0) {
+            if(!isUpper(k))
+                Gmax1=std::max(Gmax1,-_G[k]);
+            if(!isLower(k))
+                Gmax2=std::max(Gmax2,_G[k]);
+        }
+        else {
+            if(!isUpper(k))
+                Gmax2=std::max(Gmax2,-_G[k]);
+            if(!isLower(k))
+                Gmax1=std::max(Gmax1,_G[k]);
+        }
+    }
+    // close to optimal: shrink once more from the whole set
+    if(!unshrink&&Gmax1+Gmax2<=_eps*10) {
+        unshrink=true;
+        reconstruct();
+    }
+    size_t n=0;
+    for(size_t t=0;t<_active.size();t++) {
+        size_t k=_active[t];
+        bool out=false;
+        if(isUpper(k))
+            out=_y[k]>0?-_G[k]>Gmax1:-_G[k]>Gmax2;
+        else if(isLower(k))
+            out=_y[k]>0?_G[k]>Gmax2:_G[k]>Gmax1;
+        if(!out)
+            _active[n++]=k;
+    }
+    _active.resize(n);
+}
+
+template<typename SK,typename DATA_TYPE>
+void SmoSvm<SK,DATA_TYPE>::reconstruct() {
+    size_t N=_xlist.size();
+    if(_active.size()==N)
+        return;
+    std::vector<char> on(N,0);
+    for(size_t t=0;t<_active.size();t++)
+        on[_active[t]]=1;
+    std::vector<size_t> shrunk,free;
+    for(size_t k=0;k<N;k++) {
+        if(!on[k]) {
+            shrunk.push_back(k);
+            _G[k]=_Gbar[k]-1;
+        }
+        else if(!isUpper(k)&&!isLower(k))
+            free.push_back(k);
+    }
+    // shrunk variables are at their bounds, hence only the free variables are missing from _Gbar
+    size_t batch=std::max(ktools::numThreads(),size_t(1));
+    std::vector<typename KernelRowCache<SK,DATA_TYPE>::Row> rows;
+    for(size_t f0=0;f0<free.size();f0+=batch) {
+        std::vector<size_t> idx(free.begin()+f0,free.begin()+std::min(f0+batch,free.size()));
+        _cache.rows(idx,rows);
+        for(size_t r=0;r<idx.size();r++) {
+            double c=_alpha[idx[r]]*_y[idx[r]];
+            const std::vector<double> &K=*rows[r];
+            for(size_t s=0;s<shrunk.size();s++)
+                _G[shrunk[s]]+=c*_y[shrunk[s]]*K[shrunk[s]];
+        }
+    }
+    _active.resize(N);
+    for(size_t k=0;k<N;k++)
+        _active[k]=k;
+}
+
+template<typename SK,typename DATA_TYPE>
+void SmoSvm<SK,DATA_TYPE>::computeRho() {
+    double inf=std::numeric_limits<double>::infinity();
+    double ub=inf,lb=-inf,sum=0;
+    size_t nfree=0;
+    for(size_t k=0;k<_xlist.size();k++) {
+        double yG=_y[k]*_G[k];
+        if(isUpper(k)) {
+            if(_y[k]<0)
+                ub=std::min(ub,yG);
+            else
+                lb=std::max(lb,yG);
+        }
+        else if(isLower(k)) {
+            if(_y[k]>0)
+                ub=std::min(ub,yG);
+            else
+                lb=std::max(lb,yG);
+        }
+        else {
+            nfree++;
+            sum+=yG;
+        }
+    }
+    _rho=nfree>0?sum/nfree:(ub+lb)/2;
+}
+
+template<typename SK,typename DATA_TYPE>
+double SmoSvm<SK,DATA_TYPE>::decision(const DATA_TYPE &x) const {
+    double f=-_rho,k;
+    for(size_t i=0;i<_xlist.size();i++)
+        if(_alpha[i]>0) {
+            this->_sk(_xlist[i],x,k);
+            f+=_alpha[i]*_y[i]*k;
+        }
+    return f;
+}
+
+template<typename SK,typename DATA_TYPE>
+void SmoSvm<SK,DATA_TYPE>::decision(const std::vector<DATA_TYPE> &qlist,std::vector<double> &f) const {
+    f.resize(qlist.size());
+    // the kernel is held by reference, hence it can be prepared for the queries in a const method
+    ktools::prepare(this->_sk,qlist);
+    ktools::detail::parallelFor(qlist.size(),[&](size_t q,size_t) {
+        f[q]=decision(qlist[q]);
+    });
+}
+
+template<typename SK,typename DATA_TYPE>
+const std::vector<double>& SmoSvm<SK,DATA_TYPE>::alphas() const {
+    return _alpha;
+}
+
+template<typename SK,typename DATA_TYPE>
+double SmoSvm<SK,DATA_TYPE>::rho() const {
+    return _rho;
+}
+
+template<typename SK,typename DATA_TYPE>
+void SmoSvm<SK,DATA_TYPE>::supportVectors(std::vector<size_t> &indexes) const {
+    indexes.clear();
+    for(size_t i=0;i<_alpha.size();i++)
+        if(_alpha[i]>0)
+            indexes.push_back(i);
+}
+
+template<typename SK,typename DATA_TYPE>
+size_t SmoSvm<SK,DATA_TYPE>::iterations() const {
+    return _iterations;
+}
+
+template<typename SK,typename DATA_TYPE>
+const KernelRowCache<SK,DATA_TYPE>& SmoSvm<SK,DATA_TYPE>::cache() const {
+    return _cache;
+}
+
+#endif // _SMO_SVM_HPP_
@@ -2,6 +2,10 @@
 #define _SYM_KERNEL_HPP_
 
 #include<vector>
+#include"KernelTraits.hpp"
+#include"Matrix.hpp"
+#include"PackedMatrix.hpp"
+#include"KTools.hpp"
 
 /** @brief Symbolic Kernel class
  *
@@ -28,6 +32,17 @@ class SymKernel {
         /** @brief Dimension of the characteristic kernel matrix. */
         size_t _N;
 
+        /** @brief Verifies that `ilist` holds at least one index, and that its indexes are within the characteristic kernel matrix. */
+        void checkList(const std::vector<size_t> &ilist) const;
+
+        /** @brief Looks up the kernel values on `ilist` and `jlist` into `km`, given by its rows: a MatrixView, or a std::vector of row pointers (see ktools::detail::rowPointers). */
+        template<typename RET_TYPE,typename ROWS>
+        void crossRows(const std::vector<size_t> &ilist,const std::vector<size_t> &jlist,const ROWS &km) const;
+
+        /** @brief Looks up the kernel values on `ilist` into `km`, given by its rows as in crossRows. */
+        template<typename RET_TYPE,typename ROWS>
+        void gramRows(const std::vector<size_t> &ilist,const ROWS &km) const;
+
     public:
         /** @brief Initiates the characteristic kernel matrix
          *
@@ -47,6 +62,9 @@ class SymKernel {
         /** @brief Empty virtual Destructor. Good habit for base classes. */
         virtual ~SymKernel() {};
 
+        /** @brief Hash of the characteristic kernel matrix, which identifies the kernel function (see ktools::fingerprint). */
+        uint64_t fingerprint() const;
+
         /** @brief Evaluates the kernel function \f$ k_{SYM}(ii,jj) \f$ and stores the result in reference parameter k.
          *
          *  @param[in] ii
@@ -80,9 +98,13 @@ class SymKernel {
          *  @param[in] jlist
          *          List (std::vector) of indexing/labeled input.
          *  @param[out] km
-         *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+         *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
          */
         template<typename RET_TYPE>
+        void operator()(const std::vector<size_t> &ilist,const std::vector<size_t> &jlist,Matrix<RET_TYPE> &km) const;
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename RET_TYPE>
         void operator()(const std::vector<size_t> &ilist,const std::vector<size_t> &jlist,std::vector<std::vector<RET_TYPE> > &km) const;
 
         /** @brief Evaluates the kernel function \f$ k_{SYM}(ii,jj) \f$ with \f$ ii,jj\in \f$ `ilist`, and stores the result in reference matrix parameter km.
@@ -94,11 +116,19 @@ class SymKernel {
          *  @param[in] ilist
          *          List (std::vector) of indexing/labeled input.
          *  @param[out] km
-         *          Reference to a matrix (std::vector<std::vector>) variable in which the kernel values are stored.
+         *          Reference to a matrix (Matrix) variable in which the kernel values are stored.
          */
         template<typename RET_TYPE>
+        void operator()(const std::vector<size_t> &ilist,Matrix<RET_TYPE> &km) const;
+
+        /** @brief Same as the Matrix version, with the result stored in a nested std::vector matrix. */
+        template<typename RET_TYPE>
         void operator()(const std::vector<size_t> &ilist,std::vector<std::vector<RET_TYPE> > &km) const;
 
+        /** @brief Same as the Matrix version, with the result stored in a packed symmetric matrix (PackedMatrix), which holds each value once. */
+        template<typename RET_TYPE>
+        void operator()(const std::vector<size_t> &ilist,PackedMatrix<RET_TYPE> &km) const;
+
         /** @brief Evaluates the kernel function \f$ k_{SYM}(ii,ii) \f$ with \f$ ii\in \f$ `ilist`, and stores the result in reference vector parameter kv.
          *
          *  Equivalent to:
@@ -116,6 +146,22 @@ class SymKernel {
         void operator()(const std::vector<size_t> &ilist,std::vector<RET_TYPE> &kv) const;
 };
 
+/** @brief Kernel Traits of the SymKernel.
+ *
+ *  The characteristic kernel matrix is verified to be symmetric at construction, but it is not verified to be positive semi-definite, hence it is not assumed to be.
+ *  Nothing is assumed about its diagonal.
+ *
+ *  Programs whose characteristic matrix is known to be positive semi-definite (e.g. verified once with ktools::isPositiveSemiDefinite) may opt in,
+ *  by deriving a class from SymKernel and specializing KernelTraits for it with `positive=true`.
+ */
+template<>
+struct KernelTraits<SymKernel> {
+    static const bool unitDiagonal=false;
+    static const bool stationary=false;
+    static const bool symmetric=true;
+    static const bool positive=false;
+};
+
 template<typename VAL_TYPE>
 SymKernel::SymKernel(const std::vector<std::vector<VAL_TYPE> > &skm): _skm(skm) {
     _N=skm.size();
@@ -136,7 +182,7 @@ SymKernel::SymKernel(const std::vector<std::vector<VAL_TYPE> > &skm): _skm(skm)
     }
 }
 
-SymKernel::SymKernel(const size_t N): _N(N) {
+inline SymKernel::SymKernel(const size_t N): _N(N) {
     if(N==0)
         throw "Parameter \"N\" is not positive.";
     _skm.resize(N);
@@ -146,6 +192,10 @@ SymKernel::SymKernel(const size_t N): _N(N) {
     }
 }
 
+inline uint64_t SymKernel::fingerprint() const {
+    return ktools::hash(_skm);
+}
+
 template<typename RET_TYPE>
 void SymKernel::operator()(const size_t ii,const size_t jj,RET_TYPE &k) const {
     if(ii<0||jj<0)
@@ -164,49 +214,81 @@ void SymKernel::operator()(const size_t ii,RET_TYPE &k) const {
     k=RET_TYPE(_skm[ii][ii]);
 }
 
-template<typename RET_TYPE>
-void SymKernel::operator()(const std::vector<size_t> &ilist,const std::vector<size_t> &jlist,std::vector<std::vector<RET_TYPE> > &km) const {
-    size_t lil=ilist.size();
-    size_t ljl=jlist.size();
-    if(lil==0||ljl==0)
+inline void SymKernel::checkList(const std::vector<size_t> &ilist) const {
+    if(ilist.empty())
         throw "Empty kernel index vector.";
-    for(size_t i=0;i<lil;i++) {
-        if(ilist[i]<0)
-            throw "Input kernel index is negative.";
+    for(size_t i=0;i<ilist.size();i++)
         if(ilist[i]>=_N)
             throw "Input kernel index exceeds maximum value.";
-    }
-    for(size_t j=0;j<ljl;j++) {
-        if(jlist[j]<0)
-            throw "Input kernel index is negative.";
-        if(jlist[j]>=_N)
-            throw "Input kernel index exceeds maximum value.";
-    }
-    km.resize(lil);
-    for(size_t i=0;i<lil;i++) {
-        km[i].resize(ljl);
-        for(size_t j=0;j<ljl;j++)
+}
+
+template<typename RET_TYPE,typename ROWS>
+void SymKernel::crossRows(const std::vector<size_t> &ilist,const std::vector<size_t> &jlist,const ROWS &km) const {
+    for(size_t i=0;i<ilist.size();i++)
+        for(size_t j=0;j<jlist.size();j++)
             km[i][j]=RET_TYPE(_skm[ilist[i]][jlist[j]]);
+}
+
+template<typename RET_TYPE,typename ROWS>
+void SymKernel::gramRows(const std::vector<size_t> &ilist,const ROWS &km) const {
+    for(size_t i=0;i<ilist.size();i++) {
+        km[i][i]=RET_TYPE(_skm[ilist[i]][ilist[i]]);
+        for(size_t j=0;j<i;j++)
+            km[i][j]=km[j][i]=RET_TYPE(_skm[ilist[i]][ilist[j]]);
     }
 }
 
+template<typename RET_TYPE>
+void SymKernel::operator()(const std::vector<size_t> &ilist,const std::vector<size_t> &jlist,Matrix<RET_TYPE> &km) const {
+    if(jlist.empty())
+        throw "Empty kernel index vector.";
+    checkList(ilist);
+    checkList(jlist);
+    km.resize(ilist.size(),jlist.size());
+    crossRows<RET_TYPE>(ilist,jlist,km.view());
+}
+
+template<typename RET_TYPE>
+void SymKernel::operator()(const std::vector<size_t> &ilist,const std::vector<size_t> &jlist,std::vector<std::vector<RET_TYPE> > &km) const {
+    if(jlist.empty())
+        throw "Empty kernel index vector.";
+    checkList(ilist);
+    checkList(jlist);
+    ktools::resizeMat(km,ilist.size(),jlist.size());
+    std::vector<RET_TYPE*> rows;
+    ktools::detail::rowPointers(km,rows);
+    crossRows<RET_TYPE>(ilist,jlist,rows);
+}
+
+template<typename RET_TYPE>
+void SymKernel::operator()(const std::vector<size_t> &ilist,Matrix<RET_TYPE> &km) const {
+    checkList(ilist);
+    km.resize(ilist.size(),ilist.size());
+    gramRows<RET_TYPE>(ilist,km.view());
+}
+
 template<typename RET_TYPE>
 void SymKernel::operator()(const std::vector<size_t> &ilist,std::vector<std::vector<RET_TYPE> > &km) const {
+    checkList(ilist);
+    ktools::resizeMat(km,ilist.size());
+    std::vector<RET_TYPE*> rows;
+    ktools::detail::rowPointers(km,rows);
+    gramRows<RET_TYPE>(ilist,rows);
+}
+
+template<typename RET_TYPE>
+void SymKernel::operator()(const std::vector<size_t> &ilist,PackedMatrix<RET_TYPE> &km) const {
     size_t lil=ilist.size();
     if(lil==0)
         throw "Empty kernel index vector.";
-    for(size_t i=0;i<lil;i++) {
-        if(ilist[i]<0)
-            throw "Input kernel index is negative.";
+    for(size_t i=0;i<lil;i++)
         if(ilist[i]>=_N)
             throw "Input kernel index exceeds maximum value.";
-    }
     km.resize(lil);
     for(size_t i=0;i<lil;i++) {
-        km[i].resize(lil);
-        km[i][i]=RET_TYPE(_skm[ilist[i]][ilist[i]]);
-        for(size_t j=0;j<i;j++)
-            km[i][j]=km[j][i]=RET_TYPE(_skm[ilist[i]][ilist[j]]);
+        RET_TYPE *ki=km.row(i);
+        for(size_t j=0;j<=i;j++)
+            ki[j]=RET_TYPE(_skm[ilist[i]][ilist[j]]);
     }
 }
 
@@ -0,0 +1,324 @@
+#ifndef _TILED_MATRIX_HPP_
+#define _TILED_MATRIX_HPP_
+
+#include<algorithm>
+#include<string>
+#include<stdint.h>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#include"Matrix.hpp"
+
+/** @brief Tiled Matrix class.
+ *
+ *  Matrix of some basic numeric type (double, float, int..) stored out-of-core, in a file which is memory-mapped rather than read into memory.
+ *  Meant for kernel matrices which do not fit in memory, e.g. a \f$ 300k \times 300k \f$ Gram matrix of doubles takes 720 GB.
+ *
+ *  The matrix is split in square tiles of \f$ B \times B \f$ elements, each stored contiguously (row-major, with leading dimension B) and accessed as a MatrixView through tile().
+ *  Tiles are ordered by tile row; the tiles of the last tile row and column are padded up to the full tile size.
+ *  A symmetric matrix only stores the tiles on and below the diagonal, i.e. about half of the file.
+ *
+ *  Only the tiles being accessed are resident in memory, and the kernel classes and the ktools namespace fill and transform tiled matrices in tile row order, releasing each tile row as soon as all its tiles are done (see release()).
+ *  Memory usage is thus bounded by a few tile rows, regardless of the size of the matrix.
+ *
+ *  File format
+ *  -----------
+ *
+ *  A header of HEADER bytes (magic number, element size, number of rows and columns, tile size, symmetry), followed by the tiles.
+ *  The file is in the native byte order, and must be opened with the same element type it was created with.
+ *
+ *  Instances are not copyable, since each owns its mapping of the file. The file is only available on POSIX systems (mmap).
+ */
+template<typename T>
+class TiledMatrix {
+    protected:
+        /** @brief File descriptor. */
+        int _fd;
+
+        /** @brief Pointer to the mapped file. */
+        char *_map;
+
+        /** @brief Size of the mapped file, in bytes. */
+        size_t _bytes;
+
+        /** @brief Number of rows. */
+        size_t _NR;
+
+        /** @brief Number of columns. */
+        size_t _NC;
+
+        /** @brief Number of rows and columns of each tile. */
+        size_t _B;
+
+        /** @brief Only the tiles on and below the diagonal are stored. */
+        bool _sym;
+
+    public:
+        /** @brief Size of the file header, in bytes, so that tiles start on a page boundary. */
+        static const size_t HEADER=4096;
+
+        /** @brief Default number of rows and columns of each tile. */
+        static const size_t TILE=256;
+
+        /** @brief Magic number at the start of the file ("TKLTILED"). */
+        static const uint64_t MAGIC=0x44454C49544C4B54ULL;
+
+        /** @brief Creates (or overwrites) a file containing an \f$ NR \times NC \f$ matrix, with all elements set to 0.
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         *  @param[in] NR
+         *          Number of rows.
+         *  @param[in] NC
+         *          Number of columns.
+         *  @param[in] sym
+         *          If true, the matrix is symmetric (NR and NC must be equal), and only the tiles on and below the diagonal are stored.
+         *  @param[in] B
+         *          Number of rows and columns of each tile. Must be a multiple of 64, so that each tile spans whole memory pages.
+         */
+        TiledMatrix(const std::string &fname,size_t NR,size_t NC,bool sym=false,size_t B=TILE);
+
+        /** @brief Opens an existing file, for reading and writing.
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         */
+        TiledMatrix(const std::string &fname);
+
+        /** @brief Not copyable. */
+        TiledMatrix(const TiledMatrix&)=delete;
+
+        /** @brief Not copyable. */
+        TiledMatrix& operator=(const TiledMatrix&)=delete;
+
+        /** @brief Unmaps and closes the file, after which its contents are complete on disk. */
+        ~TiledMatrix();
+
+        /** @brief Number of rows. */
+        size_t rows() const;
+
+        /** @brief Number of columns. */
+        size_t cols() const;
+
+        /** @brief Number of rows and columns of each tile. */
+        size_t tileSize() const;
+
+        /** @brief Number of tile rows. */
+        size_t tileRows() const;
+
+        /** @brief Number of tile columns. */
+        size_t tileCols() const;
+
+        /** @brief Only the tiles on and below the diagonal are stored. */
+        bool isSymmetric() const;
+
+        /** @brief Tile (ti,tj) is stored, i.e. the matrix is not symmetric or \f$ tj \leq ti \f$. */
+        bool stored(size_t ti,size_t tj) const;
+
+        /** @brief View on tile (ti,tj), which covers rows \f$ [ti \cdot B,(ti+1) \cdot B) \f$ and columns \f$ [tj \cdot B,(tj+1) \cdot B) \f$, cut at the matrix dimensions.
+         *
+         *  The view remains valid as long as the instance exists.
+         *
+         *  @param[in] ti
+         *          Tile row.
+         *  @param[in] tj
+         *          Tile column. Must be stored (see stored()).
+         *  @return
+         *          The tile view.
+         */
+        MatrixView<T> tile(size_t ti,size_t tj) const;
+
+        /** @brief Element in row i and column j, mirrored through the diagonal if the matrix is symmetric and the element is not stored. */
+        T& operator()(size_t i,size_t j) const;
+
+        /** @brief Releases the memory holding tile row ti, whose contents are kept in the file.
+         *
+         *  @param[in] ti
+         *          Tile row.
+         */
+        void release(size_t ti) const;
+
+        /** @brief Releases the memory holding tile (ti,tj), if stored, whose contents are kept in the file.
+         *
+         *  @param[in] ti
+         *          Tile row.
+         *  @param[in] tj
+         *          Tile column.
+         */
+        void release(size_t ti,size_t tj) const;
+
+        /** @brief Writes the modified tiles to disk, and waits for completion. */
+        void flush() const;
+
+    private:
+        /** @brief Position of tile (ti,tj) within the sequence of stored tiles. */
+        size_t tileIndex(size_t ti,size_t tj) const;
+
+        /** @brief Size of the file, in bytes. */
+        size_t fileBytes() const;
+
+        /** @brief Maps the opened file. */
+        void map();
+};
+
+template<typename T>
+const size_t TiledMatrix<T>::HEADER;
+
+template<typename T>
+const size_t TiledMatrix<T>::TILE;
+
+template<typename T>
+const uint64_t TiledMatrix<T>::MAGIC;
+
+template<typename T>
+TiledMatrix<T>::TiledMatrix(const std::string &fname,size_t NR,size_t NC,bool sym,size_t B): _fd(-1),_map(0),_bytes(0),_NR(NR),_NC(NC),_B(B),_sym(sym) {
+    if(B==0||B%64!=0)
+        throw "Tile size is not a multiple of 64.";
+    if(sym&&NR!=NC)
+        throw "Symmetric tiled matrix is not square.";
+    _fd=::open(fname.c_str(),O_RDWR|O_CREAT|O_TRUNC,0644);
+    if(_fd<0)
+        throw "Tiled matrix file cannot be created.";
+    _bytes=fileBytes();
+    if(::ftruncate(_fd,off_t(_bytes))!=0) {
+        ::close(_fd);
+        throw "Tiled matrix file cannot be resized.";
+    }
+    map();
+    uint64_t *h=reinterpret_cast<uint64_t*>(_map);
+    h[0]=MAGIC;
+    h[1]=sizeof(T);
+    h[2]=NR;
+    h[3]=NC;
+    h[4]=B;
+    h[5]=sym;
+}
+
+template<typename T>
+TiledMatrix<T>::TiledMatrix(const std::string &fname): _fd(-1),_map(0),_bytes(0),_NR(0),_NC(0),_B(0),_sym(false) {
+    _fd=::open(fname.c_str(),O_RDWR);
+    if(_fd<0)
+        throw "Tiled matrix file cannot be opened.";
+    uint64_t h[6];
+    struct stat st;
+    if(::pread(_fd,h,sizeof(h),0)!=ssize_t(sizeof(h))||::fstat(_fd,&st)!=0||h[0]!=MAGIC||h[1]!=sizeof(T)||h[4]==0||h[4]%64!=0) {
+        ::close(_fd);
+        throw "Tiled matrix file is not valid.";
+    }
+    _NR=h[2];
+    _NC=h[3];
+    _B=h[4];
+    _sym=h[5]!=0;
+    _bytes=fileBytes();
+    if(size_t(st.st_size)!=_bytes) {
+        ::close(_fd);
+        throw "Tiled matrix file is not valid.";
+    }
+    map();
+}
+
+template<typename T>
+TiledMatrix<T>::~TiledMatrix() {
+    if(_map)
+        ::munmap(_map,_bytes);
+    if(_fd>=0)
+        ::close(_fd);
+}
+
+template<typename T>
+void TiledMatrix<T>::map() {
+    void *p=::mmap(0,_bytes,PROT_READ|PROT_WRITE,MAP_SHARED,_fd,0);
+    if(p==MAP_FAILED) {
+        ::close(_fd);
+        throw "Tiled matrix file cannot be mapped.";
+    }
+    _map=static_cast<char*>(p);
+}
+
+template<typename T>
+size_t TiledMatrix<T>::fileBytes() const {
+    size_t NT=_sym?tileRows()*(tileRows()+1)/2:tileRows()*tileCols();
+    return HEADER+NT*_B*_B*sizeof(T);
+}
+
+template<typename T>
+size_t TiledMatrix<T>::rows() const {
+    return _NR;
+}
+
+template<typename T>
+size_t TiledMatrix<T>::cols() const {
+    return _NC;
+}
+
+template<typename T>
+size_t TiledMatrix<T>::tileSize() const {
+    return _B;
+}
+
+template<typename T>
+size_t TiledMatrix<T>::tileRows() const {
+    return (_NR+_B-1)/_B;
+}
+
+template<typename T>
+size_t TiledMatrix<T>::tileCols() const {
+    return (_NC+_B-1)/_B;
+}
+
+template<typename T>
+bool TiledMatrix<T>::isSymmetric() const {
+    return _sym;
+}
+
+template<typename T>
+bool TiledMatrix<T>::stored(size_t ti,size_t tj) const {
+    return !_sym||tj<=ti;
+}
+
+template<typename T>
+size_t TiledMatrix<T>::tileIndex(size_t ti,size_t tj) const {
+    return _sym?ti*(ti+1)/2+tj:ti*tileCols()+tj;
+}
+
+template<typename T>
+MatrixView<T> TiledMatrix<T>::tile(size_t ti,size_t tj) const {
+    if(ti>=tileRows()||tj>=tileCols())
+        throw "Tile exceeds the matrix dimensions.";
+    if(!stored(ti,tj))
+        throw "Tile is not stored.";
+    T *p=reinterpret_cast<T*>(_map+HEADER+tileIndex(ti,tj)*_B*_B*sizeof(T));
+    return MatrixView<T>(p,std::min(_B,_NR-ti*_B),std::min(_B,_NC-tj*_B),_B);
+}
+
+template<typename T>
+T& TiledMatrix<T>::operator()(size_t i,size_t j) const {
+    if(_sym&&j>i)
+        std::swap(i,j);
+    return tile(i/_B,j/_B)(i%_B,j%_B);
+}
+
+template<typename T>
+void TiledMatrix<T>::release(size_t ti) const {
+    if(ti>=tileRows())
+        return;
+    size_t first=tileIndex(ti,0);
+    size_t count=_sym?ti+1:tileCols();
+    ::madvise(_map+HEADER+first*_B*_B*sizeof(T),count*_B*_B*sizeof(T),MADV_DONTNEED);
+}
+
+template<typename T>
+void TiledMatrix<T>::release(size_t ti,size_t tj) const {
+    if(ti>=tileRows()||tj>=tileCols()||!stored(ti,tj))
+        return;
+    ::madvise(_map+HEADER+tileIndex(ti,tj)*_B*_B*sizeof(T),_B*_B*sizeof(T),MADV_DONTNEED);
+}
+
+template<typename T>
+void TiledMatrix<T>::flush() const {
+    if(::msync(_map,_bytes,MS_SYNC)!=0)
+        throw "Tiled matrix file cannot be written.";
+}
+
+#endif // _TILED_MATRIX_HPP_
@@ -0,0 +1,38 @@
+#ifndef _TKL_HPP_
+#define _TKL_HPP_
+
+/** @file
+ *  @brief Includes the whole library.
+ *
+ *  Programs linked against libtkl (see the `libtkl` target of the Makefile) should include this header and define `TKL_LIBRARY` (e.g. `-DTKL_LIBRARY`):
+ *  the instantiations listed in TklInstances.hpp are then declared `extern template`, i.e. taken from the library rather than compiled again,
+ *  and the leaf kernels of ktools are taken from the library as well, where they are compiled for several instruction sets with dispatch at load time.
+ *  Without `TKL_LIBRARY`, the library remains header-only.
+ */
+
+#include"KernelTraits.hpp"
+#include"Matrix.hpp"
+#include"PackedMatrix.hpp"
+#include"TiledMatrix.hpp"
+#include"KTools.hpp"
+#include"RefKernel.hpp"
+#include"RbfKernel.hpp"
+#include"SymKernel.hpp"
+#include"PathKernel.hpp"
+#include"NormKernel.hpp"
+#include"NormRefSet.hpp"
+#include"VpTree.hpp"
+#include"LibsvmWriter.hpp"
+#include"BinaryWriter.hpp"
+#include"KernelRowCache.hpp"
+#include"SmoSvm.hpp"
+#include"QuantileSketch.hpp"
+#include"Baisero.hpp"
+
+#if defined(TKL_LIBRARY)&&!defined(TKL_LIBRARY_BUILD)
+#define TKL_TEMPLATE extern template
+#include"TklInstances.hpp"
+#undef TKL_TEMPLATE
+#endif
+
+#endif // _TKL_HPP_
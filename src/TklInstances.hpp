@@ -0,0 +1,61 @@
+// List of the explicit instantiations compiled into libtkl, for common types:
+// double and float results, on vectors (RbfKernel), labels (SymKernel), and sequences of either (PathKernel, NormKernel).
+//
+// Included with TKL_TEMPLATE defined as `template` by libtkl.cpp (definitions), and as `extern template` by Tkl.hpp (declarations),
+// hence deliberately without include guard.
+
+#ifndef TKL_TEMPLATE
+#error "TKL_TEMPLATE must be defined before including TklInstances.hpp."
+#endif
+
+// Pair, self, cross-Gram, Gram, packed Gram and diagonal evaluations of KERNEL on inputs of type DATA, with results of type RET.
+#define TKL_KERNEL_INSTANCES(KERNEL,DATA,RET,QUAL) \
+    TKL_TEMPLATE void KERNEL::operator()(const DATA &,const DATA &,RET &) QUAL; \
+    TKL_TEMPLATE void KERNEL::operator()(const DATA &,RET &) QUAL; \
+    TKL_KERNEL_LIST_INSTANCES(KERNEL,DATA,RET,QUAL)
+
+// Same as TKL_KERNEL_INSTANCES, without the pair and self evaluations.
+#define TKL_KERNEL_LIST_INSTANCES(KERNEL,DATA,RET,QUAL) \
+    TKL_TEMPLATE void KERNEL::operator()(const std::vector<DATA> &,const std::vector<DATA> &,Matrix<RET> &) QUAL; \
+    TKL_TEMPLATE void KERNEL::operator()(const std::vector<DATA> &,Matrix<RET> &) QUAL; \
+    TKL_TEMPLATE void KERNEL::operator()(const std::vector<DATA> &,PackedMatrix<RET> &) QUAL; \
+    TKL_TEMPLATE void KERNEL::operator()(const std::vector<DATA> &,std::vector<RET> &) QUAL;
+
+// Matrix transforms of ktools on results of type RET.
+#define TKL_KTOOLS_INSTANCES(RET) \
+    TKL_TEMPLATE void ktools::kern2norm(const MatrixView<RET> &); \
+    TKL_TEMPLATE void ktools::kern2norm(PackedMatrix<RET> &); \
+    TKL_TEMPLATE void ktools::kern2dist(const MatrixView<RET> &); \
+    TKL_TEMPLATE void ktools::kern2dist(PackedMatrix<RET> &); \
+    TKL_TEMPLATE void ktools::center(const MatrixView<RET> &,ktools::CenterStats &);
+
+TKL_TEMPLATE class PathKernel<RbfKernel>;
+TKL_TEMPLATE class PathKernel<SymKernel>;
+TKL_TEMPLATE class NormKernel<PathKernel<RbfKernel> >;
+TKL_TEMPLATE class NormKernel<PathKernel<SymKernel> >;
+
+TKL_KERNEL_INSTANCES(RbfKernel,std::vector<double>,double,const)
+TKL_KERNEL_INSTANCES(RbfKernel,std::vector<float>,float,const)
+
+// the pair and self evaluations of the SymKernel take labels by value
+TKL_TEMPLATE void SymKernel::operator()(size_t,size_t,double &) const;
+TKL_TEMPLATE void SymKernel::operator()(size_t,double &) const;
+TKL_TEMPLATE void SymKernel::operator()(size_t,size_t,float &) const;
+TKL_TEMPLATE void SymKernel::operator()(size_t,float &) const;
+TKL_KERNEL_LIST_INSTANCES(SymKernel,size_t,double,const)
+TKL_KERNEL_LIST_INSTANCES(SymKernel,size_t,float,const)
+
+TKL_KERNEL_INSTANCES(PathKernel<RbfKernel>,std::vector<std::vector<double> >,double,)
+TKL_KERNEL_INSTANCES(PathKernel<RbfKernel>,std::vector<std::vector<float> >,float,)
+TKL_KERNEL_INSTANCES(PathKernel<SymKernel>,std::vector<size_t>,double,)
+TKL_KERNEL_INSTANCES(PathKernel<SymKernel>,std::vector<size_t>,float,)
+
+TKL_KERNEL_INSTANCES(NormKernel<PathKernel<RbfKernel> >,std::vector<std::vector<double> >,double,)
+TKL_KERNEL_INSTANCES(NormKernel<PathKernel<SymKernel> >,std::vector<size_t>,double,)
+
+TKL_KTOOLS_INSTANCES(double)
+TKL_KTOOLS_INSTANCES(float)
+
+#undef TKL_KERNEL_INSTANCES
+#undef TKL_KERNEL_LIST_INSTANCES
+#undef TKL_KTOOLS_INSTANCES
@@ -0,0 +1,402 @@
+#ifndef _VP_TREE_HPP_
+#define _VP_TREE_HPP_
+
+#include<algorithm>
+#include<cmath>
+#include<fstream>
+#include<limits>
+#include<queue>
+#include<random>
+#include<string>
+#include<utility>
+#include<vector>
+#include<stdint.h>
+#include"KernelTraits.hpp"
+#include"RefKernel.hpp"
+#include"KTools.hpp"
+
+/** @brief Vantage-Point Tree class.
+ *
+ *  Indexes a fixed set of inputs under the distance induced by some other kernel \f$ SK \f$ (see ktools::dist),
+ *  \f[
+ *      d(x,y) = \sqrt{k_{SK}(x,x) + k_{SK}(y,y) - 2k_{SK}(x,y)},
+ *  \f]
+ *  and answers k-nearest-neighbour and range queries with far fewer distance evaluations than a linear scan.
+ *
+ *  Each node holds a vantage point and the median distance \f$ \mu \f$ from it to the other inputs of its subtree:
+ *  the inputs closer than \f$ \mu \f$ form the inside subtree, the others form the outside subtree.
+ *  Subtrees are pruned through the triangle inequality, hence results are exact as long as the distance is a metric, i.e. as long as the kernel is positive semi-definite.
+ *
+ *  The self-kernels of the indexed inputs are computed once, and the tree is stored in flat arrays (in pre-order), which may be saved on and loaded from disk.
+ *
+ *  This class extends RefKernel, and thus requires the specification of an internal kernel instance.
+ *
+ *  Data Inputs
+ *  -----------
+ *
+ *  The indexed set is held by reference, and must therefore outlive the class instance and not be modified.
+ *  Queries must be adequate for the supplied internal kernel instance.
+ */
+template<typename SK,typename DATA_TYPE>
+class VpTree: public RefKernel<SK> {
+    protected:
+        /** @brief The indexed set. */
+        const std::vector<DATA_TYPE> &_xlist;
+
+        /** @brief Self-kernels of the indexed set. */
+        std::vector<double> _kv;
+
+        /** @brief Index (in the indexed set) of the vantage point of the node at each position. */
+        std::vector<uint64_t> _index;
+
+        /** @brief Median distance of the node at each position. */
+        std::vector<double> _mu;
+
+        /** @brief End of the inside subtree of the node at each position, which is also the position of the outside subtree. */
+        std::vector<uint64_t> _mid;
+
+        /** @brief End of the subtree of the node at each position. */
+        std::vector<uint64_t> _end;
+
+        /** @brief Number of distance evaluations of the last query. */
+        size_t _evals;
+
+    public:
+        /** @brief Initializes the internal kernel reference and builds the tree.
+         *
+         *  @param[in] sk
+         *          Kernel instance.
+         *  @param[in] xlist
+         *          List (std::vector) of inputs to index.
+         *  @param[in] seed
+         *          Seed of the random choice of vantage points.
+         */
+        VpTree(SK &sk,const std::vector<DATA_TYPE> &xlist,uint64_t seed=5489);
+
+        /** @brief Initializes the internal kernel reference and loads the tree from file.
+         *
+         *  If the file does not exist or does not match the indexed set and the kernel, the tree is built and the file is (over)written.
+         *
+         *  @param[in] sk
+         *          Kernel instance.
+         *  @param[in] xlist
+         *          List (std::vector) of inputs to index.
+         *  @param[in] fname
+         *          Path to the file containing the tree.
+         *  @param[in] seed
+         *          Seed of the random choice of vantage points, if the tree is built.
+         */
+        VpTree(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::string &fname,uint64_t seed=5489);
+
+        /** @brief Finds the k nearest neighbours of query q.
+         *
+         *  @param[in] q
+         *          Query input.
+         *  @param[in] k
+         *          Number of neighbours.
+         *  @param[out] indexes
+         *          Indexes (in the indexed set) of the min(k,size()) nearest inputs, by increasing distance.
+         *  @param[out] dists
+         *          Corresponding distances.
+         */
+        void knn(const DATA_TYPE &q,size_t k,std::vector<size_t> &indexes,std::vector<double> &dists);
+
+        /** @brief Finds all the inputs within distance `radius` of query q.
+         *
+         *  @param[in] q
+         *          Query input.
+         *  @param[in] radius
+         *          Maximum distance (included).
+         *  @param[out] indexes
+         *          Indexes (in the indexed set) of the inputs within the radius, by increasing distance.
+         *  @param[out] dists
+         *          Corresponding distances.
+         */
+        void range(const DATA_TYPE &q,double radius,std::vector<size_t> &indexes,std::vector<double> &dists);
+
+        /** @brief Number of inputs in the indexed set.
+         *
+         *  @return
+         *          The size of the indexed set.
+         */
+        size_t size() const;
+
+        /** @brief Number of distance evaluations performed by the last query, as opposed to size() for a linear scan.
+         *
+         *  @return
+         *          The number of distance evaluations.
+         */
+        size_t evaluations() const;
+
+        /** @brief Saves the tree on disk.
+         *
+         *  The file also contains the size and a content hash (see ktools::hash) of the indexed set, and the fingerprint of the kernel (see ktools::fingerprint), which are verified on load.
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         *  @return
+         *          True if the file was completely written. False otherwise (e.g. if it could not be opened, or on a write error such as a full disk).
+         */
+        bool save(const std::string &fname) const;
+
+        /** @brief Loads the tree from disk.
+         *
+         *  Does nothing if the file does not exist, if it was saved for a different indexed set or with a different kernel function, or if it does not hold a well-formed tree (e.g. a truncated or corrupt file).
+         *
+         *  @param[in] fname
+         *          Path to the file.
+         *  @return
+         *          True if the tree was actually read from file. False otherwise.
+         */
+        bool load(const std::string &fname);
+
+    private:
+        /** @brief Computes the self-kernels and builds the tree. */
+        void build(uint64_t seed);
+
+        /** @brief Whether the flat arrays `index`, `mid` and `end` describe a well-formed tree on N inputs, i.e. one that searches can walk without leaving the arrays. */
+        static bool wellFormed(const std::vector<uint64_t> &index,const std::vector<uint64_t> &mid,const std::vector<uint64_t> &end);
+
+        /** @brief Distance between query q (with self-kernel kq) and the i-th indexed input. */
+        double distance(const DATA_TYPE &q,double kq,size_t i);
+
+        /** @brief Visits the subtree at position p, collecting in `heap` the inputs within distance `tau`; if `k` is not 0, `tau` shrinks to the k-th smallest distance found. */
+        void search(size_t p,const DATA_TYPE &q,double kq,size_t k,double &tau,std::priority_queue<std::pair<double,size_t> > &heap);
+
+        /** @brief Moves the contents of `heap` into `indexes` and `dists`, by increasing distance. */
+        static void collect(std::priority_queue<std::pair<double,size_t> > &heap,std::vector<size_t> &indexes,std::vector<double> &dists);
+};
+
+template<typename SK,typename DATA_TYPE>
+VpTree<SK,DATA_TYPE>::VpTree(SK &sk,const std::vector<DATA_TYPE> &xlist,uint64_t seed): RefKernel<SK>(sk),_xlist(xlist),_evals(0) {
+    build(seed);
+}
+
+template<typename SK,typename DATA_TYPE>
+VpTree<SK,DATA_TYPE>::VpTree(SK &sk,const std::vector<DATA_TYPE> &xlist,const std::string &fname,uint64_t seed): RefKernel<SK>(sk),_xlist(xlist),_evals(0) {
+    if(!load(fname)) {
+        build(seed);
+        save(fname);
+    }
+}
+
+template<typename SK,typename DATA_TYPE>
+void VpTree<SK,DATA_TYPE>::build(uint64_t seed) {
+    // Subtrees smaller than this compute the distances to their vantage point serially.
+    const size_t PARALLEL_MIN=1024;
+    size_t N=_xlist.size();
+    ktools::prepare(this->_sk,_xlist);
+    ktools::detail::selfKernels(this->_sk,_xlist,_kv);
+    _index.resize(N);
+    _mu.assign(N,0);
+    _mid.resize(N);
+    _end.resize(N);
+    for(size_t i=0;i<N;i++)
+        _index[i]=i;
+    std::mt19937_64 rng(seed);
+    std::vector<double> d(N);
+    std::vector<std::pair<size_t,size_t> > stack(1,std::make_pair(size_t(0),N));
+    while(!stack.empty()) {
+        size_t lo=stack.back().first,hi=stack.back().second;
+        stack.pop_back();
+        if(lo>=hi)
+            continue;
+        std::swap(_index[lo],_index[lo+std::uniform_int_distribution<size_t>(0,hi-lo-1)(rng)]);
+        _end[lo]=hi;
+        _mid[lo]=hi;
+        if(hi-lo==1)
+            continue;
+        const DATA_TYPE &v=_xlist[_index[lo]];
+        double kv=_kv[_index[lo]];
+        auto eval=[&](size_t i) {
+            d[_index[i]]=distance(v,kv,_index[i]);
+        };
+        if(hi-lo>=PARALLEL_MIN) {
+            const size_t B=64;
+            ktools::detail::parallelFor((hi-lo-1+B-1)/B,[&](size_t t,size_t) {
+                for(size_t i=lo+1+t*B;i<std::min(lo+1+t*B+B,hi);i++)
+                    eval(i);
+            });
+        }
+        else {
+            for(size_t i=lo+1;i<hi;i++)
+                eval(i);
+        }
+        size_t m=lo+1+(hi-lo-1)/2;
+        std::nth_element(_index.begin()+lo+1,_index.begin()+m,_index.begin()+hi,[&](uint64_t a,uint64_t b) { return d[a]<d[b]; });
+        _mu[lo]=d[_index[m]];
+        _mid[lo]=m;
+        stack.push_back(std::make_pair(lo+1,m));
+        stack.push_back(std::make_pair(m,hi));
+    }
+}
+
+template<typename SK,typename DATA_TYPE>
+bool VpTree<SK,DATA_TYPE>::wellFormed(const std::vector<uint64_t> &index,const std::vector<uint64_t> &mid,const std::vector<uint64_t> &end) {
+    size_t N=index.size();
+    // each input is the vantage point of exactly one node
+    std::vector<bool> seen(N,false);
+    for(size_t p=0;p<N;p++) {
+        if(index[p]>=N||seen[index[p]])
+            return false;
+        seen[index[p]]=true;
+    }
+    // the subtree at position p spans [p,end[p]), with the inside subtree at [p+1,mid[p]) and the outside one at [mid[p],end[p])
+    if(N==0)
+        return true;
+    std::vector<std::pair<size_t,size_t> > stack(1,std::make_pair(size_t(0),N));
+    size_t nodes=0;
+    while(!stack.empty()) {
+        size_t p=stack.back().first,hi=stack.back().second;
+        stack.pop_back();
+        if(end[p]!=hi||mid[p]<p+1||mid[p]>hi)
+            return false;
+        nodes++;
+        if(p+1<mid[p])
+            stack.push_back(std::make_pair(p+1,size_t(mid[p])));
+        if(mid[p]<hi)
+            stack.push_back(std::make_pair(size_t(mid[p]),hi));
+    }
+    return nodes==N;
+}
+
+template<typename SK,typename DATA_TYPE>
+double VpTree<SK,DATA_TYPE>::distance(const DATA_TYPE &q,double kq,size_t i) {
+    double k;
+    this->_sk(q,_xlist[i],k);
+    return ktools::detail::sqrtDist<SK>(kq+_kv[i]-2*k);
+}
+
+template<typename SK,typename DATA_TYPE>
+void VpTree<SK,DATA_TYPE>::search(size_t p,const DATA_TYPE &q,double kq,size_t k,double &tau,std::priority_queue<std::pair<double,size_t> > &heap) {
+    double d=distance(q,kq,_index[p]);
+    _evals++;
+    if(d<=tau) {
+        heap.push(std::make_pair(d,size_t(_index[p])));
+        if(k>0&&heap.size()>k)
+            heap.pop();
+        if(k>0&&heap.size()==k)
+            tau=heap.top().first;
+    }
+    size_t in=p+1,out=_mid[p];
+    bool hasIn=in<_mid[p],hasOut=out<_end[p];
+    // inside distances are <= mu, outside distances are >= mu
+    if(d<_mu[p]) {
+        if(hasIn&&d-tau<=_mu[p])
+            search(in,q,kq,k,tau,heap);
+        if(hasOut&&d+tau>=_mu[p])
+            search(out,q,kq,k,tau,heap);
+    }
+    else {
+        if(hasOut&&d+tau>=_mu[p])
+            search(out,q,kq,k,tau,heap);
+        if(hasIn&&d-tau<=_mu[p])
+            search(in,q,kq,k,tau,heap);
+    }
+}
+
+template<typename SK,typename DATA_TYPE>
+void VpTree<SK,DATA_TYPE>::collect(std::priority_queue<std::pair<double,size_t> > &heap,std::vector<size_t> &indexes,std::vector<double> &dists) {
+    size_t n=heap.size();
+    indexes.resize(n);
+    dists.resize(n);
+    for(size_t i=n;i-->0;heap.pop()) {
+        dists[i]=heap.top().first;
+        indexes[i]=heap.top().second;
+    }
+}
+
+template<typename SK,typename DATA_TYPE>
+void VpTree<SK,DATA_TYPE>::knn(const DATA_TYPE &q,size_t k,std::vector<size_t> &indexes,std::vector<double> &dists) {
+    std::priority_queue<std::pair<double,size_t> > heap;
+    double tau=std::numeric_limits<double>::infinity();
+    _evals=0;
+    if(k>0&&!_xlist.empty()) {
+        double kq=1;
+        if(!KernelTraits<SK>::unitDiagonal)
+            this->_sk(q,kq);
+        search(0,q,kq,k,tau,heap);
+    }
+    collect(heap,indexes,dists);
+}
+
+template<typename SK,typename DATA_TYPE>
+void VpTree<SK,DATA_TYPE>::range(const DATA_TYPE &q,double radius,std::vector<size_t> &indexes,std::vector<double> &dists) {
+    std::priority_queue<std::pair<double,size_t> > heap;
+    _evals=0;
+    if(!_xlist.empty()) {
+        double kq=1;
+        if(!KernelTraits<SK>::unitDiagonal)
+            this->_sk(q,kq);
+        search(0,q,kq,0,radius,heap);
+    }
+    collect(heap,indexes,dists);
+}
+
+template<typename SK,typename DATA_TYPE>
+size_t VpTree<SK,DATA_TYPE>::size() const {
+    return _xlist.size();
+}
+
+template<typename SK,typename DATA_TYPE>
+size_t VpTree<SK,DATA_TYPE>::evaluations() const {
+    return _evals;
+}
+
+template<typename SK,typename DATA_TYPE>
+bool VpTree<SK,DATA_TYPE>::save(const std::string &fname) const {
+    std::ofstream ofs(fname.c_str(),std::ios::out|std::ios::trunc|std::ios::binary);
+    if(!ofs.is_open())
+        return false;
+    uint64_t h=ktools::hash(_xlist);
+    uint64_t fp=ktools::fingerprint(this->_sk);
+    size_t N=_index.size();
+    ofs.write((char*)&h,sizeof(h));
+    ofs.write((char*)&fp,sizeof(fp));
+    ofs.write((char*)&N,sizeof(N));
+    if(N>0) {
+        ofs.write((char*)&_kv[0],N*sizeof(_kv[0]));
+        ofs.write((char*)&_index[0],N*sizeof(_index[0]));
+        ofs.write((char*)&_mu[0],N*sizeof(_mu[0]));
+        ofs.write((char*)&_mid[0],N*sizeof(_mid[0]));
+        ofs.write((char*)&_end[0],N*sizeof(_end[0]));
+    }
+    // a full disk or an I/O error may surface on the writes or only when the buffer is flushed by close()
+    if(!ofs.good())
+        return false;
+    ofs.close();
+    return ofs.good();
+}
+
+template<typename SK,typename DATA_TYPE>
+bool VpTree<SK,DATA_TYPE>::load(const std::string &fname) {
+    std::ifstream ifs(fname.c_str(),std::ios::in|std::ios::binary);
+    if(!ifs.is_open())
+        return false;
+    uint64_t h,fp;
+    size_t N;
+    ifs.read((char*)&h,sizeof(h));
+    ifs.read((char*)&fp,sizeof(fp));
+    ifs.read((char*)&N,sizeof(N));
+    if(!ifs||N!=_xlist.size()||h!=ktools::hash(_xlist)||fp!=ktools::fingerprint(this->_sk))
+        return false;
+    std::vector<double> kv(N),mu(N);
+    std::vector<uint64_t> index(N),mid(N),end(N);
+    if(N>0) {
+        ifs.read((char*)&kv[0],N*sizeof(kv[0]));
+        ifs.read((char*)&index[0],N*sizeof(index[0]));
+        ifs.read((char*)&mu[0],N*sizeof(mu[0]));
+        ifs.read((char*)&mid[0],N*sizeof(mid[0]));
+        ifs.read((char*)&end[0],N*sizeof(end[0]));
+    }
+    if(!ifs||!wellFormed(index,mid,end))
+        return false;
+    _kv.swap(kv);
+    _index.swap(index);
+    _mu.swap(mu);
+    _mid.swap(mid);
+    _end.swap(end);
+    return true;
+}
+
+#endif // _VP_TREE_HPP_
@@ -0,0 +1,275 @@
+#include<chrono>
+#include<cstdlib>
+#include<cstring>
+#include<iostream>
+#include<random>
+#include<string>
+#include<vector>
+#include"RbfKernel.hpp"
+#include"SymKernel.hpp"
+#include"PathKernel.hpp"
+#include"NormKernel.hpp"
+#include"KTools.hpp"
+
+// Only for the purpose of this benchmark file
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+typedef vector<double> InputType_Vector;
+typedef size_t InputType_Index;
+typedef vector<InputType_Vector> InputType_VectorSequence;
+typedef vector<InputType_Index> InputType_IndexSequence;
+
+void parse_args(int argc,char **argv);
+void init_data();
+void bench_rbf();
+void bench_sym();
+void bench_pathk();
+void bench_normk();
+void bench_kerntools();
+
+template<typename F>
+double best_of(F run);
+template<typename S,typename F>
+double best_of(S setup,F run);
+void record(const string &kernel,const string &op,double pairs,double flopsPerPair,double seconds);
+
+// benchmark configuration, see parse_args
+size_t nvec=1000;
+size_t dim=16;
+size_t nseq=200;
+size_t len=20;
+size_t alphabet=32;
+size_t reps=3;
+size_t threads=0;
+uint64_t seed=5489;
+
+// synthetic data (lists of vectors, of labels, of vector sequences and of label sequences)
+vector<InputType_Vector> vlist,vlistA,vlistB;
+vector<InputType_Index> ilist,ilistA,ilistB;
+vector<InputType_VectorSequence> vslist,vslistA,vslistB;
+vector<InputType_IndexSequence> islist,islistA,islistB;
+
+// sink for the benchmarked results, so that no evaluation is optimized away
+double sink=0;
+bool first=true;
+
+int main(int argc,char **argv) {
+    parse_args(argc,argv);
+    if(threads>0)
+        ktools::setNumThreads(threads);
+    init_data();
+
+    cout << "{" << endl;
+    cout << "  \"config\": {\"vectors\": " << nvec << ", \"dim\": " << dim << ", \"sequences\": " << nseq << ", \"length\": " << len
+         << ", \"alphabet\": " << alphabet << ", \"repetitions\": " << reps << ", \"threads\": " << ktools::numThreads() << ", \"seed\": " << seed << "}," << endl;
+    cout << "  \"results\": [" << endl;
+    try {
+        bench_rbf();
+        bench_sym();
+        bench_pathk();
+        bench_normk();
+        bench_kerntools();
+    }
+    catch(const char *e) {
+        cerr << "Error: " << e << endl;
+        return 1;
+    }
+    cout << endl << "  ]," << endl;
+    cout << "  \"sink\": " << (sink==sink?1:0) << endl;
+    cout << "}" << endl;
+    return 0;
+}
+
+void usage_exit(const char *prog) {
+    cerr << "Usage: " << prog << " [-n vectors] [-d dim] [-s sequences] [-l length] [-a alphabet] [-r repetitions] [-t threads] [-seed seed]" << endl;
+    exit(1);
+}
+
+void parse_args(int argc,char **argv) {
+    for(int i=1;i<argc;i++) {
+        if(i+1>=argc)
+            usage_exit(argv[0]);
+        size_t v=strtoull(argv[i+1],0,10);
+        if(!strcmp(argv[i],"-n"))
+            nvec=v;
+        else if(!strcmp(argv[i],"-d"))
+            dim=v;
+        else if(!strcmp(argv[i],"-s"))
+            nseq=v;
+        else if(!strcmp(argv[i],"-l"))
+            len=v;
+        else if(!strcmp(argv[i],"-a"))
+            alphabet=v;
+        else if(!strcmp(argv[i],"-r"))
+            reps=v;
+        else if(!strcmp(argv[i],"-t"))
+            threads=v;
+        else if(!strcmp(argv[i],"-seed"))
+            seed=v;
+        else
+            usage_exit(argv[0]);
+        i++;
+    }
+    if(nvec<2||dim==0||nseq<2||len==0||alphabet==0||reps==0)
+        usage_exit(argv[0]);
+}
+
+void init_data() {
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> gauss;
+    std::uniform_int_distribution<size_t> label(0,alphabet-1);
+
+    vlist.resize(nvec,InputType_Vector(dim));
+    ilist.resize(nvec);
+    for(size_t i=0;i<nvec;i++) {
+        for(size_t d=0;d<dim;d++)
+            vlist[i][d]=gauss(rng);
+        ilist[i]=label(rng);
+    }
+    vslist.resize(nseq,InputType_VectorSequence(len,InputType_Vector(dim)));
+    islist.resize(nseq,InputType_IndexSequence(len));
+    for(size_t i=0;i<nseq;i++)
+        for(size_t t=0;t<len;t++) {
+            for(size_t d=0;d<dim;d++)
+                vslist[i][t][d]=gauss(rng);
+            islist[i][t]=label(rng);
+        }
+
+    // halves, for the cross-Gram matrices
+    vlistA.assign(vlist.begin(),vlist.begin()+nvec/2);
+    vlistB.assign(vlist.begin()+nvec/2,vlist.end());
+    ilistA.assign(ilist.begin(),ilist.begin()+nvec/2);
+    ilistB.assign(ilist.begin()+nvec/2,ilist.end());
+    vslistA.assign(vslist.begin(),vslist.begin()+nseq/2);
+    vslistB.assign(vslist.begin()+nseq/2,vslist.end());
+    islistA.assign(islist.begin(),islist.begin()+nseq/2);
+    islistB.assign(islist.begin()+nseq/2,islist.end());
+}
+
+template<typename F>
+double best_of(F run) {
+    return best_of([]() {},run);
+}
+
+template<typename S,typename F>
+double best_of(S setup,F run) {
+    double best=0;
+    for(size_t r=0;r<reps;r++) {
+        setup();
+        std::chrono::steady_clock::time_point t0=std::chrono::steady_clock::now();
+        run();
+        double t=std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+        if(r==0||t<best)
+            best=t;
+    }
+    return best;
+}
+
+void record(const string &kernel,const string &op,double pairs,double flopsPerPair,double seconds) {
+    if(!first)
+        cout << "," << endl;
+    first=false;
+    cout << "    {\"kernel\": \"" << kernel << "\", \"op\": \"" << op << "\", \"pairs\": " << size_t(pairs) << ", \"seconds\": " << seconds
+         << ", \"pairs_per_s\": " << (seconds>0?pairs/seconds:0) << ", \"gflops\": " << (seconds>0?pairs*flopsPerPair/seconds*1e-9:0) << "}";
+}
+
+// Benchmarks the four operations of a kernel (pair, Gram, cross-Gram, diagonal) on a list of inputs and its halves.
+template<typename KERNEL,typename DATA_TYPE>
+void bench_kernel(const string &name,KERNEL &kern,const vector<DATA_TYPE> &list,const vector<DATA_TYPE> &listA,const vector<DATA_TYPE> &listB,double flopsPerPair) {
+    size_t N=list.size();
+    Matrix<double> km;
+    vector<double> kv;
+    double t=best_of([&]() {
+        double k;
+        for(size_t i=0;i<N;i++) {
+            kern(list[i],list[(i+1)%N],k);
+            sink+=k;
+        }
+    });
+    record(name,"pair",N,flopsPerPair,t);
+    t=best_of([&]() {
+        kern(list,km);
+        sink+=km[N-1][0];
+    });
+    record(name,"gram",N*(N+1)/2.0,flopsPerPair,t);
+    t=best_of([&]() {
+        kern(listA,listB,km);
+        sink+=km[0][0];
+    });
+    record(name,"cross",double(listA.size())*listB.size(),flopsPerPair,t);
+    t=best_of([&]() {
+        kern(list,kv);
+        sink+=kv[0];
+    });
+    record(name,"diag",N,flopsPerPair,t);
+}
+
+// Nominal floating point operations of each kernel evaluation
+double rbf_flops() {
+    // difference, square and sum per dimension, then scaling
+    return 3.0*dim+2;
+}
+
+double path_flops(double symbolFlops) {
+    // one symbol kernel and one weighted update (3 multiplications and 2 additions) per pair of positions
+    return double(len)*len*(symbolFlops+5);
+}
+
+void bench_rbf() {
+    RbfKernel rk(1.0);
+    bench_kernel("RbfKernel",rk,vlist,vlistA,vlistB,rbf_flops());
+}
+
+void bench_sym() {
+    SymKernel sk(alphabet);
+    bench_kernel("SymKernel",sk,ilist,ilistA,ilistB,0);
+}
+
+void bench_pathk() {
+    RbfKernel rk(1.0);
+    SymKernel sk(alphabet);
+    PathKernel<RbfKernel> prk(rk);
+    PathKernel<SymKernel> psk(sk);
+    bench_kernel("PathKernel<RbfKernel>",prk,vslist,vslistA,vslistB,path_flops(rbf_flops()));
+    bench_kernel("PathKernel<SymKernel>",psk,islist,islistA,islistB,path_flops(0));
+}
+
+void bench_normk() {
+    RbfKernel rk(1.0);
+    PathKernel<RbfKernel> prk(rk);
+    NormKernel<PathKernel<RbfKernel> > nprk(prk);
+    bench_kernel("NormKernel<PathKernel<RbfKernel>>",nprk,vslist,vslistA,vslistB,path_flops(rbf_flops()));
+}
+
+void bench_kerntools() {
+    RbfKernel rk(1.0);
+    Matrix<double> gram,km;
+    PackedMatrix<double> packed,pm;
+    ktools::CenterStats stats;
+    rk(vlist,gram);
+    ktools::copyMat(gram,packed);
+    double N=double(nvec);
+
+    // transforms, each on a fresh copy of the Gram matrix
+    double t=best_of([&]() { ktools::copyMat(gram,km); },[&]() { ktools::kern2norm(km); });
+    record("ktools","kern2norm",N*N,2,t);
+    t=best_of([&]() { ktools::copyMat(gram,km); },[&]() { ktools::kern2dist(km); });
+    record("ktools","kern2dist",N*N,4,t);
+    t=best_of([&]() { ktools::copyMat(gram,km); },[&]() { ktools::center(km,stats); });
+    record("ktools","center",N*N,3,t);
+    t=best_of([&]() { pm=packed; },[&]() { ktools::kern2norm(pm); });
+    record("ktools","kern2norm_packed",N*(N+1)/2,2,t);
+    t=best_of([&]() { pm=packed; },[&]() { ktools::kern2dist(pm); });
+    record("ktools","kern2dist_packed",N*(N+1)/2,4,t);
+
+    // kernel evaluation and transform in one call
+    t=best_of([&]() { ktools::norm(rk,vlist,km); });
+    record("ktools","norm<RbfKernel>",N*(N+1)/2,rbf_flops()+2,t);
+    t=best_of([&]() { ktools::dist(rk,vlist,km); });
+    record("ktools","dist<RbfKernel>",N*(N+1)/2,rbf_flops()+4,t);
+    sink+=km[0][0]+pm(0,0);
+}
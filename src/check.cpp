@@ -0,0 +1,545 @@
+#include<algorithm>
+#include<cmath>
+#include<cstdlib>
+#include<cstring>
+#include<iostream>
+#include<random>
+#include<string>
+#include<vector>
+#include"RbfKernel.hpp"
+#include"PathKernel.hpp"
+#include"NormKernel.hpp"
+#include"KTools.hpp"
+
+// Only for the purpose of this check file
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+typedef vector<double> InputType_Vector;
+typedef vector<InputType_Vector> InputType_VectorSequence;
+
+void parse_args(int argc,char **argv);
+void init_data();
+void check_kpca();
+void check_krr();
+void check_triangle();
+void check_extend();
+void check_kmedoids();
+void check_eigen();
+void check_lowrank();
+void check_stream();
+
+void report(const string &tool,const string &what,double err,double tol);
+void report(const string &tool,const string &what,bool ok);
+vector<double> eigenvalues(const Matrix<double> &a);
+void gram(const vector<InputType_Vector> &list,Matrix<double> &km);
+
+// check configuration, see parse_args
+size_t nvec=200;
+size_t dim=4;
+size_t threads=0;
+uint64_t seed=5489;
+
+// synthetic data, and the kernel all tools are checked with
+vector<InputType_Vector> vlist;
+RbfKernel rbfk(1.5);
+
+size_t failures=0;
+
+int main(int argc,char **argv) {
+    parse_args(argc,argv);
+    if(threads>0)
+        ktools::setNumThreads(threads);
+    init_data();
+
+    try {
+        check_kpca();
+        check_krr();
+        check_triangle();
+        check_extend();
+        check_kmedoids();
+        check_eigen();
+        check_lowrank();
+        check_stream();
+    }
+    catch(const char *e) {
+        cerr << "Error: " << e << endl;
+        return 1;
+    }
+    cout << (failures==0?"All checks passed.":"Some checks FAILED.") << endl;
+    return failures==0?0:1;
+}
+
+void usage_exit(const char *prog) {
+    cerr << "Usage: " << prog << " [-n vectors] [-d dim] [-t threads] [-seed seed]" << endl;
+    exit(1);
+}
+
+void parse_args(int argc,char **argv) {
+    for(int i=1;i<argc;i++) {
+        if(i+1>=argc)
+            usage_exit(argv[0]);
+        size_t v=strtoull(argv[i+1],0,10);
+        if(!strcmp(argv[i],"-n"))
+            nvec=v;
+        else if(!strcmp(argv[i],"-d"))
+            dim=v;
+        else if(!strcmp(argv[i],"-t"))
+            threads=v;
+        else if(!strcmp(argv[i],"-seed"))
+            seed=v;
+        else
+            usage_exit(argv[0]);
+        i++;
+    }
+    if(nvec<20||dim==0)
+        usage_exit(argv[0]);
+}
+
+void init_data() {
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> gauss;
+
+    vlist.resize(nvec,InputType_Vector(dim));
+    for(size_t i=0;i<nvec;i++)
+        for(size_t d=0;d<dim;d++)
+            vlist[i][d]=gauss(rng);
+}
+
+void report(const string &tool,const string &what,double err,double tol) {
+    bool ok=err<=tol;
+    if(!ok)
+        failures++;
+    cout << (ok?"ok      ":"FAILED  ") << tool << ": " << what << " (error " << err << ", tolerance " << tol << ")" << endl;
+}
+
+void report(const string &tool,const string &what,bool ok) {
+    if(!ok)
+        failures++;
+    cout << (ok?"ok      ":"FAILED  ") << tool << ": " << what << endl;
+}
+
+// Reference eigenvalues of a symmetric matrix, in decreasing order, by cyclic Jacobi rotations.
+vector<double> eigenvalues(const Matrix<double> &m) {
+    size_t N=m.rows();
+    vector<vector<double> > a(N,vector<double>(N));
+    for(size_t i=0;i<N;i++)
+        for(size_t j=0;j<N;j++)
+            a[i][j]=m[i][j];
+    for(size_t sweep=0;sweep<100;sweep++) {
+        double off=0,all=0;
+        for(size_t i=0;i<N;i++)
+            for(size_t j=0;j<N;j++) {
+                all+=a[i][j]*a[i][j];
+                if(i!=j)
+                    off+=a[i][j]*a[i][j];
+            }
+        if(off<=1e-30*all)
+            break;
+        for(size_t p=0;p<N;p++)
+            for(size_t q=p+1;q<N;q++) {
+                if(a[p][q]==0)
+                    continue;
+                double theta=(a[q][q]-a[p][p])/(2*a[p][q]);
+                double t=(theta>=0?1:-1)/(std::fabs(theta)+std::sqrt(theta*theta+1));
+                double c=1/std::sqrt(t*t+1),s=t*c;
+                for(size_t k=0;k<N;k++) {
+                    double akp=a[k][p],akq=a[k][q];
+                    a[k][p]=c*akp-s*akq;
+                    a[k][q]=s*akp+c*akq;
+                }
+                for(size_t k=0;k<N;k++) {
+                    double apk=a[p][k],aqk=a[q][k];
+                    a[p][k]=c*apk-s*aqk;
+                    a[q][k]=s*apk+c*aqk;
+                }
+            }
+    }
+    vector<double> ev(N);
+    for(size_t i=0;i<N;i++)
+        ev[i]=a[i][i];
+    std::sort(ev.rbegin(),ev.rend());
+    return ev;
+}
+
+// Reference kernel matrix, one kernel evaluation per entry.
+void gram(const vector<InputType_Vector> &list,Matrix<double> &km) {
+    size_t N=list.size();
+    km.resize(N,N);
+    for(size_t i=0;i<N;i++)
+        for(size_t j=0;j<N;j++)
+            rbfk(list[i],list[j],km[i][j]);
+}
+
+// kPCA eigenvalues against the full eigendecomposition of the explicitly centered kernel matrix.
+void check_kpca() {
+    const size_t N=std::min<size_t>(nvec,120),K=5;
+    vector<InputType_Vector> xlist(vlist.begin(),vlist.begin()+N);
+    Matrix<double> km;
+    gram(xlist,km);
+    vector<double> r(N,0);
+    double g=0;
+    for(size_t i=0;i<N;i++) {
+        for(size_t j=0;j<N;j++)
+            r[i]+=km[i][j]/N;
+        g+=r[i]/N;
+    }
+    for(size_t i=0;i<N;i++)
+        for(size_t j=0;j<N;j++)
+            km[i][j]+=g-r[i]-r[j];
+    vector<double> ref=eigenvalues(km);
+
+    ktools::KpcaModel model;
+    ktools::kpca(rbfk,xlist,K,model,0,8,10,seed);
+    double err=0;
+    for(size_t c=0;c<K;c++)
+        err=std::max(err,std::fabs(model.eigenvalues[c]-ref[c])/ref[0]);
+    report("kpca","leading eigenvalues vs full eigendecomposition",err,1e-6);
+
+    // eigenvectors: |K u - lambda u| relative to lambda_1
+    double res=0;
+    for(size_t c=0;c<K;c++)
+        for(size_t i=0;i<N;i++) {
+            double s=0;
+            for(size_t j=0;j<N;j++)
+                s+=km[i][j]*model.eigenvectors[c][j];
+            res=std::max(res,std::fabs(s-model.eigenvalues[c]*model.eigenvectors[c][i])/ref[0]);
+        }
+    report("kpca","eigenvector residuals",res,1e-4);
+}
+
+// KRR dual coefficients against a direct (Gaussian elimination) solve of (K + lambda I) alpha = y.
+void check_krr() {
+    const size_t N=std::min<size_t>(nvec,150);
+    const double lambda=0.1;
+    vector<InputType_Vector> xlist(vlist.begin(),vlist.begin()+N);
+    vector<double> y(N);
+    for(size_t i=0;i<N;i++)
+        y[i]=std::sin(xlist[i][0])+0.5*xlist[i][dim-1];
+    Matrix<double> km;
+    gram(xlist,km);
+    vector<vector<double> > a(N,vector<double>(N+1));
+    for(size_t i=0;i<N;i++) {
+        for(size_t j=0;j<N;j++)
+            a[i][j]=km[i][j]+(i==j?lambda:0);
+        a[i][N]=y[i];
+    }
+    for(size_t k=0;k<N;k++) {
+        size_t p=k;
+        for(size_t i=k+1;i<N;i++)
+            if(std::fabs(a[i][k])>std::fabs(a[p][k]))
+                p=i;
+        std::swap(a[k],a[p]);
+        for(size_t i=k+1;i<N;i++) {
+            double f=a[i][k]/a[k][k];
+            for(size_t j=k;j<=N;j++)
+                a[i][j]-=f*a[k][j];
+        }
+    }
+    vector<double> ref(N);
+    for(size_t i=N;i-->0;) {
+        double s=a[i][N];
+        for(size_t j=i+1;j<N;j++)
+            s-=a[i][j]*ref[j];
+        ref[i]=s/a[i][i];
+    }
+
+    const ktools::KrrPreconditioner precs[]={ktools::KRR_NONE,ktools::KRR_NYSTROM,ktools::KRR_CHOLESKY};
+    const char *names[]={"no preconditioner","Nystrom preconditioner","Cholesky preconditioner"};
+    double ynorm=0,rnorm=0;
+    for(size_t i=0;i<N;i++)
+        ynorm=std::max(ynorm,std::fabs(ref[i]));
+    for(size_t p=0;p<3;p++) {
+        vector<double> alpha;
+        ktools::krr(rbfk,xlist,y,lambda,alpha,precs[p],20,0,1e-10,1000,seed);
+        double err=0,res=0;
+        for(size_t i=0;i<N;i++) {
+            err=std::max(err,std::fabs(alpha[i]-ref[i])/ynorm);
+            double s=lambda*alpha[i];
+            for(size_t j=0;j<N;j++)
+                s+=km[i][j]*alpha[j];
+            res=std::max(res,std::fabs(s-y[i]));
+            rnorm=std::max(rnorm,std::fabs(y[i]));
+        }
+        report("krr",string("coefficients vs direct solve, ")+names[p],err,1e-6);
+        report("krr",string("residual, ")+names[p],res/rnorm,1e-8);
+    }
+}
+
+// Blocked min-plus triangle check against the O(N^3) check of all triples.
+void check_triangle() {
+    const size_t N=std::min<size_t>(nvec,300);
+    vector<InputType_Vector> xlist(vlist.begin(),vlist.begin()+N);
+    Matrix<double> dm;
+    ktools::dist(rbfk,xlist,dm);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0,N-1);
+    for(size_t c=0;c<4;c++) {
+        // first the actual kernel distance, then single entries moved around their tightest bound min_k d(i,k)+d(k,j)
+        string what="kernel distance";
+        if(c>0) {
+            size_t i=pick(rng),j=pick(rng);
+            if(i==j)
+                j=(i+1)%N;
+            double lo=2;
+            for(size_t k=0;k<N;k++)
+                if(k!=i&&k!=j)
+                    lo=std::min(lo,dm[i][k]+dm[k][j]);
+            dm[i][j]=dm[j][i]=lo*(c==1?2:(c==2?1+1e-6:1-1e-6));
+            what=c==1?"entry doubled past its tightest bound":(c==2?"entry just above its tightest bound":"entry just below its tightest bound");
+        }
+        bool ref=true;
+        for(size_t i=0;i<N&&ref;i++)
+            for(size_t j=0;j<N&&ref;j++)
+                for(size_t k=0;k<N&&ref;k++)
+                    ref=dm[i][j]<=dm[i][k]+dm[k][j];
+        bool got=ktools::respectsTriangleInequality(dm);
+        vector<vector<double> > ndm;
+        ktools::copyMat(dm,ndm);
+        bool ngot=ktools::respectsTriangleInequality(ndm);
+        report("respectsTriangleInequality",what+" vs all triples",got==ref&&ngot==ref);
+    }
+}
+
+// Incremental kernel matrices against the ones computed from scratch.
+void check_extend() {
+    const size_t N=std::min<size_t>(nvec,130),N0=N/2;
+    vector<InputType_Vector> xold(vlist.begin(),vlist.begin()+N0),xlist(vlist.begin(),vlist.begin()+N);
+    Matrix<double> km,nkm,ref,nref;
+    vector<double> kv;
+    rbfk(xold,km);
+    rbfk(xold,kv);
+    ktools::norm(rbfk,xold,nkm);
+    ktools::extend(rbfk,xlist,km,kv,nkm);
+    rbfk(xlist,ref);
+    ktools::norm(rbfk,xlist,nref);
+    double err=0,nerr=0;
+    for(size_t i=0;i<N;i++)
+        for(size_t j=0;j<N;j++) {
+            err=std::max(err,std::fabs(km[i][j]-ref[i][j]));
+            nerr=std::max(nerr,std::fabs(nkm[i][j]-nref[i][j]));
+        }
+    report("extend","Matrix vs full kernel matrix",km.rows()==N&&km.cols()==N?err:1,1e-12);
+    report("extend","normalized Matrix vs full normalized kernel matrix",nkm.rows()==N&&nkm.cols()==N?nerr:1,1e-12);
+
+    // one input at a time, the matrix should only move when its capacity is exceeded
+    Matrix<double> ikm;
+    vector<double> ikv;
+    size_t moves=0;
+    for(size_t n=1;n<=N;n++) {
+        const double *old=ikm.data();
+        bool fits=n<=ikm.capacity()&&Matrix<double>::leading(n)<=ikm.ld();
+        ktools::extend(rbfk,vector<InputType_Vector>(vlist.begin(),vlist.begin()+n),ikm,ikv);
+        if(ikm.data()!=old)
+            moves+=fits?N:1;
+    }
+    err=0;
+    for(size_t i=0;i<N;i++)
+        for(size_t j=0;j<N;j++)
+            err=std::max(err,std::fabs(ikm[i][j]-ref[i][j]));
+    report("extend","Matrix extended one input at a time vs full kernel matrix",ikm.rows()==N&&moves<N/4?err:1,1e-12);
+
+    PackedMatrix<double> pkm;
+    vector<double> pkv;
+    rbfk(xold,pkm);
+    rbfk(xold,pkv);
+    ktools::extend(rbfk,xlist,pkm,pkv);
+    err=0;
+    for(size_t i=0;i<N;i++)
+        for(size_t j=0;j<=i;j++)
+            err=std::max(err,std::fabs(pkm(i,j)-ref[i][j]));
+    report("extend","PackedMatrix vs full kernel matrix",err,1e-12);
+}
+
+// Total deviation of the medoids, one distance lookup per input.
+double deviation(const Matrix<double> &dm,const vector<size_t> &medoids) {
+    double loss=0;
+    for(size_t i=0;i<dm.rows();i++) {
+        double best=dm[i][medoids[0]];
+        for(size_t m=1;m<medoids.size();m++)
+            best=std::min(best,dm[i][medoids[m]]);
+        loss+=best;
+    }
+    return loss;
+}
+
+// FasterPAM against the exhaustive search over all medoid sets of a tiny problem.
+void check_kmedoids() {
+    const size_t N=14,K=3;
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> gauss;
+    for(size_t c=0;c<2;c++) {
+        // first well separated clusters, whose optimum FasterPAM must find, then unstructured data
+        vector<InputType_Vector> xlist(N,InputType_Vector(dim));
+        for(size_t i=0;i<N;i++)
+            for(size_t d=0;d<dim;d++)
+                xlist[i][d]=gauss(rng)*(c==0?0.05:1)+(c==0&&d==0?double(i%K)*10:0);
+        Matrix<double> dm;
+        ktools::dist(rbfk,xlist,dm);
+
+        double opt=-1;
+        vector<size_t> set(K);
+        for(set[0]=0;set[0]<N;set[0]++)
+            for(set[1]=set[0]+1;set[1]<N;set[1]++)
+                for(set[2]=set[1]+1;set[2]<N;set[2]++) {
+                    double loss=deviation(dm,set);
+                    if(opt<0||loss<opt)
+                        opt=loss;
+                }
+
+        vector<size_t> medoids,labels;
+        double loss=ktools::kmedoids(dm,K,medoids,labels,100,seed);
+        bool consistent=medoids.size()==K&&labels.size()==N&&std::fabs(loss-deviation(dm,medoids))<=1e-12*opt;
+        for(size_t i=0;i<N&&consistent;i++)
+            for(size_t m=0;m<K&&consistent;m++)
+                consistent=labels[i]<K&&dm[i][medoids[labels[i]]]<=dm[i][medoids[m]];
+        // no single swap improves a FasterPAM result
+        bool local=true;
+        for(size_t m=0;m<K&&local;m++)
+            for(size_t x=0;x<N&&local;x++) {
+                vector<size_t> swapped(medoids);
+                swapped[m]=x;
+                local=deviation(dm,swapped)>=loss-1e-12*opt;
+            }
+        string what=c==0?"separated clusters":"unstructured data";
+        report("kmedoids","loss of "+what+" vs recomputed loss and labels",consistent);
+        report("kmedoids","loss of "+what+" is a local optimum for swaps",local);
+        if(c==0)
+            report("kmedoids","loss of "+what+" vs exhaustive search",(loss-opt)/opt,1e-12);
+        else
+            report("kmedoids","loss of "+what+" vs exhaustive search lower bound",loss>=opt-1e-12*opt);
+    }
+}
+
+// PSD test, smallest eigenvalue and eigenvalue clipping against the full eigendecomposition.
+void check_eigen() {
+    const size_t N=std::min<size_t>(nvec,100);
+    vector<InputType_Vector> xlist(vlist.begin(),vlist.begin()+N);
+    Matrix<double> km;
+    gram(xlist,km);
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> gauss;
+    for(size_t c=0;c<3;c++) {
+        // the kernel matrix, then with a symmetric perturbation, then with a deflated leading direction (hence indefinite)
+        string what=c==0?"kernel matrix":(c==1?"perturbed kernel matrix":"indefinite matrix");
+        Matrix<double> m(km);
+        if(c==1)
+            for(size_t i=0;i<N;i++)
+                for(size_t j=0;j<=i;j++)
+                    m[i][j]=m[j][i]=m[i][j]+0.05*gauss(rng);
+        if(c==2)
+            for(size_t i=0;i<N;i++)
+                for(size_t j=0;j<N;j++)
+                    m[i][j]-=2.0/N*(N/4.0);
+        vector<double> ref=eigenvalues(m);
+        double scale=std::max(std::fabs(ref[0]),std::fabs(ref[N-1]));
+
+        bool psd=ref[N-1]>=-1e-8*scale;
+        if(c==0||ref[N-1]<-1e-6*scale)
+            report("isPositiveSemiDefinite",what+" vs full eigendecomposition",ktools::isPositiveSemiDefinite(m)==psd);
+
+        double se=ktools::smallestEigenvalue(m,N,1e-14,seed);
+        report("smallestEigenvalue",what+" vs full eigendecomposition",std::fabs(se-ref[N-1])/scale,1e-8);
+
+        const double minEig=c==0?1e-3:0;
+        size_t nclip=0;
+        for(size_t i=0;i<N;i++)
+            nclip+=ref[i]<minEig;
+        Matrix<double> clipped(m);
+        size_t got=ktools::clipEigenvalues(clipped,minEig);
+        vector<double> cref=eigenvalues(clipped);
+        double err=0;
+        for(size_t i=0;i<N;i++)
+            err=std::max(err,std::fabs(cref[i]-std::max(ref[i],minEig))/scale);
+        report("clipEigenvalues",what+" count vs full eigendecomposition",got==nclip);
+        report("clipEigenvalues",what+" spectrum vs clipped full eigendecomposition",err,1e-10);
+    }
+}
+
+// Full rank incomplete Cholesky against the kernel matrix.
+void check_lowrank() {
+    const size_t N=std::min<size_t>(nvec,60);
+    vector<InputType_Vector> xlist(vlist.begin(),vlist.begin()+N);
+    Matrix<double> km;
+    gram(xlist,km);
+    vector<double> kv(N);
+    for(size_t i=0;i<N;i++)
+        kv[i]=km[i][i];
+    for(size_t p=0;p<2;p++) {
+        Matrix<double> l;
+        ktools::detail::lowRankFactor(rbfk,xlist,kv,N,p==1,seed,l);
+        double err=0;
+        for(size_t i=0;i<N;i++)
+            for(size_t j=0;j<N;j++) {
+                double s=0;
+                for(size_t r=0;r<l.rows();r++)
+                    s+=l[r][i]*l[r][j];
+                err=std::max(err,std::fabs(s-km[i][j]));
+            }
+        report("lowRankFactor",string("full rank ")+(p==1?"pivoted":"random")+" factor vs kernel matrix",err,1e-8);
+    }
+}
+
+// Collects the streamed rows.
+struct CollectWriter {
+    Matrix<double> rows;
+    size_t next;
+
+    CollectWriter(size_t NR,size_t NC): rows(NR,NC),next(0) {
+    }
+
+    void write(const MatrixView<double> &block) {
+        for(size_t i=0;i<block.rows();i++,next++)
+            for(size_t j=0;j<block.cols();j++)
+                rows[next][j]=block[i][j];
+    }
+};
+
+// Streamed kernel matrix against the in-memory one.
+void check_stream() {
+    const size_t N=std::min<size_t>(nvec,150);
+    vector<InputType_Vector> xlist(vlist.begin(),vlist.begin()+N);
+    Matrix<double> ref;
+    gram(xlist,ref);
+    CollectWriter w(N,N);
+    ktools::stream(rbfk,xlist,w,N/3+1);
+    double err=0;
+    for(size_t i=0;i<N;i++)
+        for(size_t j=0;j<N;j++)
+            err=std::max(err,std::fabs(w.rows[i][j]-ref[i][j]));
+    report("stream","streamed rows vs kernel matrix",w.next==N?err:1,1e-12);
+
+    // normalized path kernel with a self-kernel cache by identity, over several blocks, i.e. several temporary copies of the inputs
+    const size_t NS=40;
+    vector<InputType_VectorSequence> slist(NS);
+    for(size_t i=0;i<NS;i++)
+        slist[i].assign(vlist.begin()+i%(nvec/2),vlist.begin()+i%(nvec/2)+1+i%7);
+    PathKernel<RbfKernel> pathk(rbfk);
+    NormKernel<PathKernel<RbfKernel> > normk(pathk),cnormk(pathk);
+    cnormk.cache(1000,false);
+    Matrix<double> sref;
+    normk(slist,sref);
+    CollectWriter sw(NS,NS);
+    ktools::stream(cnormk,slist,sw,NS/4);
+    err=0;
+    for(size_t i=0;i<NS;i++)
+        for(size_t j=0;j<NS;j++)
+            err=std::max(err,std::fabs(sw.rows[i][j]-sref[i][j]));
+    report("stream","streamed rows vs kernel matrix, with an identity self-kernel cache",sw.next==NS?err:1,1e-12);
+
+    Matrix<double> skm;
+    vector<double> skv;
+    vector<InputType_VectorSequence> sold(slist.begin(),slist.begin()+NS/2);
+    cnormk.cache(1000,false);
+    cnormk(sold,skm);
+    cnormk(sold,skv);
+    ktools::extend(cnormk,slist,skm,skv);
+    err=0;
+    for(size_t i=0;i<NS;i++)
+        for(size_t j=0;j<NS;j++)
+            err=std::max(err,std::fabs(skm[i][j]-sref[i][j]));
+    report("extend","Matrix vs full kernel matrix, with an identity self-kernel cache",err,1e-12);
+}
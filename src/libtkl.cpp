@@ -0,0 +1,14 @@
+// Translation unit of libtkl, built by the `libtkl` target of the Makefile with TKL_LIBRARY_BUILD defined.
+//
+// Contains the explicit instantiations listed in TklInstances.hpp, and the single definitions of the leaf kernels of ktools,
+// each compiled for several instruction sets with dispatch at load time (see TKL_LEAF in KTools.hpp).
+
+#ifndef TKL_LIBRARY_BUILD
+#error "libtkl.cpp must be compiled with TKL_LIBRARY_BUILD defined."
+#endif
+
+#include"Tkl.hpp"
+
+#define TKL_TEMPLATE template
+#include"TklInstances.hpp"
+#undef TKL_TEMPLATE
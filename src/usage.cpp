@@ -321,6 +321,12 @@ void usage_pathk() {
     pk(slist1,km); // equal to pk(slist1,slist1,km);
     show_km();
 
+    cout << "\t// Elaborates kernel values on all pairs of prefixes, in a single pass" << endl;
+    cout << "\tpk.prefixes(s1,s2,km); // km[p][q] equal to pk(s1[0..p],s2[0..q],k);" << endl;
+    // Elaborates kernel values on all pairs of prefixes, in a single pass
+    pk.prefixes(s1,s2,km); // km[p][q] equal to pk(s1[0..p],s2[0..q],k);
+    show_km();
+
     cout << "The PathKernel class also provides functionalities to save and load on file" << endl;
     cout << "intermediary results which may improve future performance. To activate the" << endl;
     cout << "functionality, you must provide the folder to use as storage, together with" << endl;